@@ -0,0 +1,67 @@
+"""
+Compare two result files written by `bench --json`.
+
+    python bench_compare.py baseline.json current.json [--threshold 10]
+
+Prints the change in median ns/op for every benchmark present in both
+files. A benchmark counts as a regression if its median slowed down by
+more than the threshold (in percent) and its fastest batch is slower
+than the baseline's 90th percentile batch, so run-to-run noise is not
+reported. Exits with status 1 if any regression is found.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(filename):
+    with open(filename, 'r') as f:
+        data = json.load(f)
+    return data, {b['name']: b for b in data['benchmarks']}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare benchmark results.')
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='percent slowdown that counts as a regression')
+    args = parser.parse_args()
+
+    base_info, base = load(args.baseline)
+    cur_info, cur = load(args.current)
+
+    if base_info.get('host') != cur_info.get('host'):
+        print('Warning: results come from different hosts ({} vs {})'.format(
+            base_info.get('host'), cur_info.get('host')))
+
+    regressions = []
+    print('{:<48} {:>12} {:>12} {:>9}'.format('benchmark', 'baseline', 'current', 'change'))
+    for name in sorted(set(base) | set(cur)):
+        if name not in base or name not in cur:
+            print('{:<48} {:>12} {:>12}'.format(
+                name,
+                '{:.1f}'.format(base[name]['ns_median']) if name in base else '-',
+                '{:.1f}'.format(cur[name]['ns_median']) if name in cur else '-'))
+            continue
+
+        b, c = base[name], cur[name]
+        change = 100.0 * (c['ns_median'] - b['ns_median']) / b['ns_median']
+        flag = ''
+        if change > args.threshold and c['ns_min'] > b['ns_p90']:
+            flag = '  REGRESSION'
+            regressions.append(name)
+        elif change < -args.threshold and c['ns_p90'] < b['ns_min']:
+            flag = '  improved'
+
+        print('{:<48} {:>12.1f} {:>12.1f} {:>+8.1f}%{}'.format(
+            name, b['ns_median'], c['ns_median'], change, flag))
+
+    if regressions:
+        print('\n{} regression(s): {}'.format(len(regressions), ', '.join(regressions)))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
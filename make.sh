@@ -4,4 +4,12 @@ cmake ..  &&
 make -j8 &&
 cp -rf iron_dome ../ &&
 cp -rf projectile_test ../ &&
+cp -rf bench ../ &&
+cp -rf reaction_latency ../ &&
+cp -rf tracker_scaling ../ &&
+cp -rf estimator_bench ../ &&
+cp -rf control_throughput ../ &&
+cp -rf replay ../ &&
+cp -rf viewer ../ &&
+cp -rf calibrate ../ &&
 cd ..
@@ -1,3 +1,6 @@
+% Superseded by the calibrate tool (src/calibration/calibrate.cpp), which fits
+% any number of points by least squares and writes a file iron_dome loads
+% with --calibration.
 clc;
 prompt = '1st point, Kinect frame: ';
 a1 = input(prompt);
@@ -0,0 +1,209 @@
+"""
+Replay-based regression gate. Runs the replay corpus through two builds
+of the app and reports whether the candidate is worse than the baseline.
+
+    python regression_gate.py baseline candidate [--corpus replay_corpus.txt]
+                              [--report report.txt] [--alpha 0.01]
+
+baseline and candidate are either replay executables, which are run on
+the corpus from the current directory, or result files they wrote with
+--json. Compared between the two:
+
+  intercept success  - intercepted tracks over all tracks, pooled over
+                       the corpus; one-sided two-proportion z-test
+  reaction latency   - virtual ms from first observation to selection;
+                       one-sided Mann-Whitney U test
+  CPU per tick       - sampled thread CPU time of control ticks;
+                       one-sided Mann-Whitney U test, and the median must
+                       also have grown by more than --cpu-threshold percent
+  allocations        - heap allocations inside the control tick; any
+                       increase is a regression (builds with allocation
+                       tracking only)
+
+Replay runs in virtual time, so the first two only change when the
+app's behaviour does. CPU time is measured on the host and is noisy,
+which is what the test and threshold are for. Exits with status 1 if
+any regression is found.
+"""
+
+import argparse
+import json
+import math
+import subprocess
+import sys
+import tempfile
+
+
+def load_results(source, corpus, label):
+    if source.endswith('.json'):
+        with open(source, 'r') as f:
+            return json.load(f)
+    with tempfile.NamedTemporaryFile(suffix='.json') as out:
+        subprocess.check_call([source, '--corpus', corpus, '--label', label,
+                               '--json', out.name], stdout=subprocess.DEVNULL)
+        with open(out.name, 'r') as f:
+            return json.load(f)
+
+
+def normal_sf(z):
+    """P(Z > z) for a standard normal Z."""
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def proportion_worse(k_base, n_base, k_cand, n_cand):
+    """One-sided p-value that the candidate's proportion is lower."""
+    if n_base == 0 or n_cand == 0:
+        return 1.0
+    pooled = (k_base + k_cand) / float(n_base + n_cand)
+    se = math.sqrt(pooled * (1 - pooled) * (1.0 / n_base + 1.0 / n_cand))
+    if se == 0:
+        return 1.0
+    z = (k_base / float(n_base) - k_cand / float(n_cand)) / se
+    return normal_sf(z)
+
+
+def mann_whitney_greater(base, cand):
+    """One-sided p-value that candidate values tend to be larger, using
+    the normal approximation with a tie correction."""
+    n1, n2 = len(base), len(cand)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+
+    values = sorted([(v, 0) for v in base] + [(v, 1) for v in cand])
+    ranks = [0.0] * len(values)
+    tie_term = 0.0
+    i = 0
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        t = j - i + 1
+        tie_term += t ** 3 - t
+        i = j + 1
+
+    rank_sum = sum(r for r, (_, group) in zip(ranks, values) if group == 1)
+    u = rank_sum - n2 * (n2 + 1) / 2.0
+    n = n1 + n2
+    variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (u - n1 * n2 / 2.0) / math.sqrt(variance)
+    return normal_sf(z)
+
+
+def median(values):
+    if not values:
+        return float('nan')
+    s = sorted(values)
+    mid = len(s) // 2
+    return s[mid] if len(s) % 2 else 0.5 * (s[mid - 1] + s[mid])
+
+
+def pooled(results, key):
+    return [v for e in results['entries'] for v in e[key]]
+
+
+def total(results, key):
+    return sum(e[key] for e in results['entries'])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare replay results of two builds.')
+    parser.add_argument('baseline', help='replay executable or result JSON')
+    parser.add_argument('candidate', help='replay executable or result JSON')
+    parser.add_argument('--corpus', default='replay_corpus.txt')
+    parser.add_argument('--report', help='also write the report to this file')
+    parser.add_argument('--alpha', type=float, default=0.01,
+                        help='significance level of the tests')
+    parser.add_argument('--cpu-threshold', type=float, default=5.0,
+                        help='percent growth in median CPU per tick that matters')
+    args = parser.parse_args()
+
+    base = load_results(args.baseline, args.corpus, 'baseline')
+    cand = load_results(args.candidate, args.corpus, 'candidate')
+
+    lines = []
+    regressions = []
+
+    def out(s=''):
+        lines.append(s)
+
+    out('Replay regression gate: {} vs {}'.format(args.baseline, args.candidate))
+    out()
+
+    # Per-entry outcomes, so a change can be traced to a scenario
+    base_entries = {e['name']: e for e in base['entries']}
+    cand_entries = {e['name']: e for e in cand['entries']}
+    out('{:<40} {:>16} {:>16} {:>12} {:>12}'.format(
+        'entry', 'intercepted', 'intercepted', 'CPU ns/tick', 'CPU ns/tick'))
+    out('{:<40} {:>16} {:>16} {:>12} {:>12}'.format(
+        '', 'baseline', 'candidate', 'baseline', 'candidate'))
+    for name in sorted(set(base_entries) | set(cand_entries)):
+        b, c = base_entries.get(name), cand_entries.get(name)
+        fmt = lambda e: '{}/{}'.format(e['intercepted'], e['tracks']) if e else '-'
+        cpu = lambda e: '{:.0f}'.format(e['cpu_mean_ns']) if e else '-'
+        changed = '  changed' if b and c and b['intercepted'] != c['intercepted'] else ''
+        out('{:<40} {:>16} {:>16} {:>12} {:>12}{}'.format(
+            name, fmt(b), fmt(c), cpu(b), cpu(c), changed))
+    out()
+
+    # Intercept success
+    kb, nb = total(base, 'intercepted'), total(base, 'tracks')
+    kc, nc = total(cand, 'intercepted'), total(cand, 'tracks')
+    p = proportion_worse(kb, nb, kc, nc)
+    verdict = 'REGRESSION' if p < args.alpha else 'ok'
+    out('Intercept success   {}/{} ({:.1f}%) -> {}/{} ({:.1f}%)   p = {:.4f}   {}'.format(
+        kb, nb, 100.0 * kb / max(nb, 1), kc, nc, 100.0 * kc / max(nc, 1), p, verdict))
+    if verdict != 'ok':
+        regressions.append('intercept success')
+
+    # Reaction latency
+    rb, rc = pooled(base, 'reaction_ms'), pooled(cand, 'reaction_ms')
+    p = mann_whitney_greater(rb, rc)
+    verdict = 'REGRESSION' if p < args.alpha else 'ok'
+    out('Reaction latency    median {:.1f} ms -> {:.1f} ms (n = {}, {})   p = {:.4f}   {}'.format(
+        median(rb), median(rc), len(rb), len(rc), p, verdict))
+    if verdict != 'ok':
+        regressions.append('reaction latency')
+
+    # CPU per tick
+    cb, cc = pooled(base, 'cpu_ns'), pooled(cand, 'cpu_ns')
+    p = mann_whitney_greater(cb, cc)
+    change = 100.0 * (median(cc) - median(cb)) / median(cb) if cb and cc and median(cb) else 0.0
+    verdict = 'REGRESSION' if p < args.alpha and change > args.cpu_threshold else 'ok'
+    out('CPU per tick        median {:.0f} ns -> {:.0f} ns ({:+.1f}%)   p = {:.4f}   {}'.format(
+        median(cb), median(cc), change, p, verdict))
+    if verdict != 'ok':
+        regressions.append('CPU per tick')
+
+    # Allocations
+    if base.get('allocation_tracking') and cand.get('allocation_tracking'):
+        ab, ac = total(base, 'rt_allocations'), total(cand, 'rt_allocations')
+        verdict = 'REGRESSION' if ac > ab else 'ok'
+        out('Control tick allocs {} -> {}   (total {} -> {})   {}'.format(
+            ab, ac, total(base, 'allocations'), total(cand, 'allocations'), verdict))
+        if verdict != 'ok':
+            regressions.append('allocations')
+    else:
+        out('Control tick allocs not compared; build both with -DIRON_DOME_ALLOC_TRACKING=ON')
+
+    out()
+    if regressions:
+        out('FAIL: {} regression(s): {}'.format(len(regressions), ', '.join(regressions)))
+    else:
+        out('PASS')
+
+    report = '\n'.join(lines)
+    print(report)
+    if args.report:
+        with open(args.report, 'w') as f:
+            f.write(report + '\n')
+
+    if regressions:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,36 @@
+/**
+* AppClock.cpp
+* ------------
+* Implementation of the AppClock class.
+*/
+
+#include <atomic>
+
+#include <sutil/CSystemClock.hpp>
+
+#include "AppClock.hpp"
+
+using namespace std;
+
+static atomic<bool> virtual_mode(false);
+static atomic<double> virtual_time(0);
+
+double AppClock::now() {
+  if(virtual_mode.load(memory_order_acquire))
+    return virtual_time.load(memory_order_acquire);
+  return sutil::CSystemClock::getSysTime();
+}
+
+void AppClock::setVirtual(double t0) {
+  virtual_time.store(t0, memory_order_release);
+  virtual_mode.store(true, memory_order_release);
+}
+
+void AppClock::advance(double dt) {
+  // Only the thread driving the replay writes the time
+  virtual_time.store(virtual_time.load(memory_order_relaxed) + dt, memory_order_release);
+}
+
+bool AppClock::isVirtual() {
+  return virtual_mode.load(memory_order_acquire);
+}
@@ -0,0 +1,38 @@
+/**
+* AppClock.hpp
+* ------------
+* The time source for the control loop and the projectile tracker.
+* Normally this is the system clock. Replay tools switch it to a virtual
+* clock that only moves when they advance it, so that a recorded session
+* produces the same ticks and decisions on every run and on any machine.
+*
+*   AppClock::setVirtual(0);
+*   for(...) {
+*     AppClock::advance(dt);
+*     ...
+*   }
+*/
+
+#pragma once
+
+class AppClock {
+
+public:
+
+  /**
+  * Current time in seconds.
+  */
+  static double now();
+
+  /**
+  * Switch to virtual time, starting at t0.
+  */
+  static void setVirtual(double t0);
+
+  /**
+  * Move virtual time forward by dt seconds.
+  */
+  static void advance(double dt);
+
+  static bool isVirtual();
+};
@@ -0,0 +1,103 @@
+/**
+* ControlCommand.cpp
+* ------------------
+* Text form of control commands.
+*/
+
+#include <sstream>
+
+#include "ControlCommand.hpp"
+
+using namespace std;
+
+static const char* TYPE_NAMES[] = {"none", "position", "translate", "orientation", "rotate",
+    "joints", "gains", "friction", "paused", "simulation", "joint_space"};
+static const int NUM_TYPES = sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]);
+
+const char* ControlCommand::typeName(Type type) {
+  return (type >= 0 && type < NUM_TYPES) ? TYPE_NAMES[type] : "unknown";
+}
+
+string formatCommandMessage(const ControlCommand& cmd) {
+
+  stringstream ss;
+  ss.precision(9);
+  ss << "cmd " << cmd.seq << " " << cmd.t << " " << ControlCommand::typeName(cmd.type);
+
+  switch(cmd.type) {
+    case ControlCommand::POSITION:
+    case ControlCommand::TRANSLATE:
+    case ControlCommand::ROTATE:
+      ss << " " << cmd.v(0) << " " << cmd.v(1) << " " << cmd.v(2);
+      break;
+    case ControlCommand::ORIENTATION:
+      for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+          ss << " " << cmd.R(i, j);
+      break;
+    case ControlCommand::JOINT_POSITION:
+      ss << " " << cmd.q.size();
+      for(int i = 0; i < cmd.q.size(); i++) ss << " " << cmd.q(i);
+      break;
+    case ControlCommand::GAINS:
+      for(int i = 0; i < 4; i++) ss << " " << cmd.gains[i];
+      break;
+    case ControlCommand::FRICTION:
+      ss << " " << cmd.value;
+      break;
+    case ControlCommand::PAUSED:
+    case ControlCommand::SIMULATION:
+    case ControlCommand::JOINT_SPACE:
+      ss << " " << (cmd.flag ? 1 : 0);
+      break;
+    default:
+      break;
+  }
+  return ss.str();
+}
+
+bool parseCommandMessage(const string& msg, ControlCommand& cmd) {
+
+  stringstream ss(msg);
+  string tag, name;
+  if(!(ss >> tag) || tag != "cmd") return false;
+  if(!(ss >> cmd.seq >> cmd.t >> name)) return false;
+
+  cmd.type = ControlCommand::NONE;
+  for(int i = 0; i < NUM_TYPES; i++)
+    if(name == TYPE_NAMES[i]) cmd.type = static_cast<ControlCommand::Type>(i);
+
+  int n;
+  switch(cmd.type) {
+    case ControlCommand::POSITION:
+    case ControlCommand::TRANSLATE:
+    case ControlCommand::ROTATE:
+      ss >> cmd.v(0) >> cmd.v(1) >> cmd.v(2);
+      break;
+    case ControlCommand::ORIENTATION:
+      for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+          ss >> cmd.R(i, j);
+      break;
+    case ControlCommand::JOINT_POSITION:
+      if(!(ss >> n) || n < 0 || n > MAX_DOF) return false;
+      cmd.q.resize(n);
+      for(int i = 0; i < n; i++) ss >> cmd.q(i);
+      break;
+    case ControlCommand::GAINS:
+      for(int i = 0; i < 4; i++) ss >> cmd.gains[i];
+      break;
+    case ControlCommand::FRICTION:
+      ss >> cmd.value;
+      break;
+    case ControlCommand::PAUSED:
+    case ControlCommand::SIMULATION:
+    case ControlCommand::JOINT_SPACE:
+      ss >> n;
+      cmd.flag = (n != 0);
+      break;
+    default:
+      return false;
+  }
+  return !ss.fail();
+}
@@ -0,0 +1,81 @@
+/**
+* ControlCommand.hpp
+* ------------------
+* Requests to the control loop from the shell and other threads. They
+* are posted to IronDomeApp's command mailbox, which stamps each with a
+* sequence number and the time of posting, and applied together at the
+* start of the next control tick.
+*
+* Commands have a text form, "cmd seq t type args...", in which they are
+* written to recorded sessions and read back by replay:
+*
+*   position x y z          translate x y z
+*   orientation r00 .. r22  rotate x y z      (XYZ euler angles)
+*   joints n q0 .. qn       gains kp_p kv_p kp_r kv_r
+*   friction kv             paused 0|1
+*   simulation 0|1          joint_space 0|1
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <Eigen/Dense>
+
+#include "RobotState.hpp"
+
+// Commands that can wait for the control loop at once
+static const size_t COMMAND_MAILBOX_SIZE = 256;
+
+class ControlCommand {
+
+public:
+
+  enum Type {
+    NONE,
+    POSITION,       // x_d = v
+    TRANSLATE,      // x_d += v
+    ORIENTATION,    // R_d = R
+    ROTATE,         // R_d = R_d * XYZ euler rotation v
+    JOINT_POSITION, // q_d = q
+    GAINS,          // Task-space gains from gains[]
+    FRICTION,       // Joint friction damping from value
+    PAUSED,         // Pause interception if flag
+    SIMULATION,     // Simulate if flag, else drive the robot
+    JOINT_SPACE     // Hold position in joint space if flag
+  };
+
+  ControlCommand() : type(NONE), seq(0), posted_ns(0), t(0), value(0), flag(false) {
+    v.setZero();
+    R.setIdentity();
+    for(int i = 0; i < 4; i++) gains[i] = 0;
+  }
+
+  explicit ControlCommand(Type type) : ControlCommand() { this->type = type; }
+
+  Type type;
+
+  uint64_t seq;      // Assigned when posted, increasing
+  int64_t posted_ns; // steady_clock time of posting, for latency
+  double t;          // AppClock time of posting
+
+  Eigen::Vector3d v;
+  Eigen::Matrix3d R;
+  JointVector q;
+  double gains[4];
+  double value;
+  bool flag;
+
+  static const char* typeName(Type type);
+};
+
+/**
+* Text form of a command, without a trailing newline.
+*/
+std::string formatCommandMessage(const ControlCommand& cmd);
+
+/**
+* Parse the text form of a command. Returns false if the message is not
+* a command or is malformed.
+*/
+bool parseCommandMessage(const std::string& msg, ControlCommand& cmd);
@@ -7,13 +7,29 @@
 #include <iostream>
 #include <string>
 #include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <thread>
 #include <math.h>
+#include <unistd.h>
 
 #include <sutil/CSystemClock.hpp>
 #include <scl/serialization/SerializationJSON.hpp>
 
 #include "ostreamlock.hpp"
 #include "IronDomeApp.hpp"
+#include "AppClock.hpp"
+#include "MessageParsing.hpp"
+#include "concurrency/StartupGraph.hpp"
+#include "RobotModelCache.hpp"
+#include "graphics/DetailGovernor.hpp"
+#include "graphics/ProjectileMarkers.hpp"
+#include "profiling/AllocationTracker.hpp"
+#include "metrics/Dashboard.hpp"
+#include "profiling/SamplingProfiler.hpp"
 
 using namespace std;
 
@@ -32,64 +48,44 @@ static const int STATE_IDLE = 0;
 static const int STATE_TARGETING = 1;
 static const int STATE_PAUSED = 2;
 
-// Choose one robot
-#define IIWA
-//#define KUKA
-//#define PUMA
+// Controllers selectable with IronDomeConfig::controller
+static const int CONTROLLER_FULL = 0;
+static const int CONTROLLER_INCREMENTAL = 1;
+static const int CONTROLLER_RMRC = 2;
+static const int CONTROLLER_JOINT = 3;
+static const vector<string> CONTROLLER_NAMES = {"full", "incremental", "rmrc", "joint"};
 
-#ifdef IIWA
-static const string robot_name("iiwaBot");
-static const string graphics_name("iiwaBotStdView");
-static const string config_file("./specs/iiwa/iiwaCfg.xml");
-
-static const Eigen::Vector3d READY_POSITION(0.556, 0, 1.076);
-static const Eigen::Quaterniond READY_ORIENTATION(0.92, 0, 0.38, 0);
-
-static const Eigen::Vector3d START_POSITION(0.6, 0, 0.58);
-//static const Eigen::Quaterniond START_ORIENTATION(.01, 1, 0, 0);
-
-Eigen::Matrix3d START_ROTATION;
-
-// Our sphere of interest for interceptions
-//static const Eigen::Vector3d COLLISION_SPHERE_POS(0, 0, 0.5);
-//static const double COLLISION_SPHERE_RADIUS = 0.75;
-static const Eigen::Vector3d COLLISION_SPHERE_POS(-.4, 0, 0.1);
-static const double COLLISION_SPHERE_RADIUS = 1.50;
-#endif
-
-#ifdef KUKA
-static const string robot_name("KukaBot");
-static const string graphics_name("KukaBotStdView");
-static const string config_file("./specs/Kuka/KukaCfg.xml");
+static const string VISION_ENDPOINT = "tcp://localhost:4242";
+//static const string VISION_ENDPOINT = "tcp://192.168.150.2:4242";
+static const string ROBOT_PORT = "tcp://*:3883";
+static const string ROBOT_ENDPOINT = "tcp://localhost:4244";
 
-static const Eigen::Vector3d START_POSITION(0, 0, 0);
-static const Eigen::Quaterniond START_ORIENTATION(1, 0, 1, 0);
+static const string REDIS_HOST = "localhost";
+static const string APP_NAME = "iron_dome";
+static const int REDIS_PORT = 6379;
 
-// Our sphere of interest for interceptions
-static const Eigen::Vector3d COLLISION_SPHERE_POS(0, 0, -0.54);
-static const double COLLISION_SPHERE_RADIUS = 0.7;
-#endif
+// Period of the app's active key refresh, which expires after twice this
+static const double ACTIVE_REFRESH_INTERVAL = 1.0;
 
-#ifdef PUMA
-static const string robot_name("PumaBot");
-static const string graphics_name("PumaBotStdView");
-static const string config_file("./specs/Puma/PumaCfg.xml");
+// Period of sampling the Redis queue lengths
+static const double QUEUE_SAMPLE_INTERVAL = 0.1;
 
-static const Eigen::Vector3d START_POSITION(0, 0, 0.9);
-static const Eigen::Quaterniond START_ORIENTATION(1, 0, 1, 0);
+// Period of publishing state to viewer processes
+static const double VIEWER_PUBLISH_INTERVAL = GRAPHICS_DT;
 
-// Our sphere of interest for interceptions
-static const Eigen::Vector3d COLLISION_SPHERE_POS(0, 0, 0.338);
-static const double COLLISION_SPHERE_RADIUS = 0.8;
-#endif
+// Period of checkpointing, and the oldest checkpoint worth resuming from
+static const double CHECKPOINT_INTERVAL = 0.1;
+static const double MAX_CHECKPOINT_AGE = 5.0;
 
-static const string VISION_ENDPOINT = "tcp://localhost:4242";
-//static const string VISION_ENDPOINT = "tcp://192.168.150.2:4242";
-static const string ROBOT_PORT = "tcp://*:3883";
-static const string ROBOT_ENDPOINT = "tcp://localhost:4244";
+// How long a standby waits for beats before taking over from a primary
+// whose process is gone, or from one that is still running but stuck,
+// and the period of mirroring state to it
+static const double FAILOVER_TIMEOUT = 10 * SIMULATION_DT;
+static const double FAILOVER_STALL_TIMEOUT = 0.1;
+static const double FAILOVER_MIRROR_INTERVAL = 0.01;
 
-static const string REDOX_HOST = "localhost";
-static const int REDOX_PORT = 6379;
+// Most shell input read at once
+static const size_t SHELL_READ_SIZE = 1024;
 
 static const double KP_P = 15000;
 static const double KV_P = 1000;
@@ -118,29 +114,111 @@ static const bool gravityCompEnabled = true;
 // Amount past the cutoffs to stop chasing active targets
 static const double CHASE_HYSTERESIS = 0.05;
 
-IronDomeApp::IronDomeApp() : t(0), t_sim(0), iter(0), finished(false),
-        op_pos(OP_POS), kp_p(KP_P), kv_p(KV_P), kp_r(KP_R), kv_r(KV_R),
-        state(STATE_UNINIT), paused(true), simulation(true), joint_space(false) {
+// Control ticks per published Diagnostics snapshot
+static const long DIAGNOSTICS_DECIMATION = 100;
+
+// Most commands applied in one control tick; the rest wait for the next
+static const int MAX_COMMANDS_PER_TICK = 64;
+
+// Longest the planner sleeps without a track update before checking for stop
+static const double PLANNER_IDLE_TIMEOUT = 0.05;
+
+static int64_t steadyNanos() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-  // Load robot spec
-  bool flag = parser.readRobotFromFile(config_file,"./specs/", robot_name, rds);
-  flag = flag && rgcm.init(rds);            //Simple way to set up dynamic tree...
-  flag = flag && dyn_tao.init(rds);         //Set up integrator object
-  flag = flag && dyn_scl.init(rds);         //Set up kinematics and dynamics object
-  flag = flag && rio.init(rds.name_,rds.dof_);
-  if(!flag) throw runtime_error("Could not initialize robot objects!");
+// Sampling profiler defaults; a prime rate avoids locking in step with the loops
+static const int DEFAULT_PROFILE_HZ = 997;
+static const string DEFAULT_PROFILE_FILE = "iron_dome.folded";
+
+// Wall clock time, comparable across runs of the program
+static int64_t wallNanos() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t nanosBetween(chrono::steady_clock::time_point a,
+                             chrono::steady_clock::time_point b) {
+  return chrono::duration_cast<chrono::nanoseconds>(b - a).count();
+}
+
+IronDomeApp::IronDomeApp() : IronDomeApp(IronDomeConfig()) {}
+
+IronDomeApp::IronDomeApp(const IronDomeConfig& config) :
+        rdx(io_loop, "main"), rdx_robot(io_loop, "robot"), rdx_vision(io_loop, "vision"),
+        shell_watcher(-1), active(!config.standby), publishing(false),
+        next_command_seq(0), applied_command_seq(0), t(0), t_sim(0), iter(0),
+        op_pos(OP_POS), kp_p(KP_P), kv_p(KV_P), kp_r(KP_R), kv_r(KV_R),
+        task_pool(config.task_workers, config.task_cpus),
+        salvo_evaluator(projectile_manager, task_pool), planner_running(false), salvo_count(0),
+        replan(true),
+        state(STATE_UNINIT), target(NULL), paused(true), simulation(true), joint_space(false),
+        config(config), robot(RobotProfile::get(config.robot)) {
+
+  // Select the controller
+  controller = -1;
+  for(size_t i = 0; i < CONTROLLER_NAMES.size(); i++)
+    if(CONTROLLER_NAMES[i] == config.controller) controller = i;
+  if(controller < 0) throw runtime_error("Unknown controller " + config.controller + "!");
+
+  // Startup steps run concurrently where they do not depend on each
+  // other; optional subsystems are only added when enabled
+  StartupGraph startup;
+
+  startup.add("robot_spec", {}, [this]() {
+    bool flag = parser.readRobotFromFile(robot.config_file, robot.spec_dir, robot.robot_name, rds);
+    flag = flag && rio.init(rds.name_,rds.dof_);
+    flag = flag && rio_graphics.init(rds.name_,rds.dof_);
+    if(!flag) throw runtime_error("Could not initialize robot objects!");
+    if(rds.dof_ > MAX_DOF) throw runtime_error("Robot has more than MAX_DOF joints!");
+  });
+
+  startup.add("dynamics", {"robot_spec"}, [this]() {
+    bool flag = rgcm.init(rds);        //Simple way to set up dynamic tree...
+    flag = flag && dyn_tao.init(rds);  //Set up integrator object
+    flag = flag && dyn_scl.init(rds);  //Set up kinematics and dynamics object
+    if(!flag) throw runtime_error("Could not initialize robot dynamics!");
+  });
 
   // Initialize graphics
-  int zero = 0;
-  glutInit(&zero, NULL);
-  flag = parser.readGraphicsFromFile(config_file, graphics_name, rgr);
-  flag = flag && rchai.initGraphics(&rgr);
-  flag = flag && rchai.addRobotToRender(&rds, &rio);
-  flag = flag && scl_chai_glut_interface::initializeGlutForChai(&rgr, &rchai);
-  if(!flag) throw runtime_error("Could not initialize graphics objects!");
+  graphics = NULL;
+  chai_world = NULL;
+  if(config.graphics) {
+    startup.add("graphics", {"robot_spec"}, [this]() {
+      int zero = 0;
+      glutInit(&zero, NULL);
+      bool flag = parser.readGraphicsFromFile(robot.config_file, robot.graphics_name, rgr);
+      flag = flag && rchai.initGraphics(&rgr);
+      flag = flag && rchai.addRobotToRender(&rds, &rio_graphics);
+      flag = flag && scl_chai_glut_interface::initializeGlutForChai(&rgr, &rchai);
+      if(!flag) throw runtime_error("Could not initialize graphics objects!");
+
+      graphics = rchai.getChaiData();
+      chai_world = graphics->chai_world_;
+    });
+  }
 
-  graphics = rchai.getChaiData();
-  chai_world = graphics->chai_world_;
+  if(!config.calibration_file.empty()) {
+    startup.add("calibration", {}, [this]() {
+      if(!calibration.load(this->config.calibration_file))
+        throw runtime_error("Could not load calibration " + this->config.calibration_file + "!");
+    });
+  }
+
+  if(config.redis) {
+    startup.add("redis", {}, [this]() { connectRedis(); });
+
+    // The model JSON needs the parsed graphics, if there are any
+    vector<string> deps = {"robot_spec", "redis"};
+    if(config.graphics) deps.push_back("graphics");
+    startup.add("model_json", deps, [this]() { publishModel(); });
+  }
+
+  startup.run();
+  cout << oslock;
+  startup.printReport(cout);
+  cout << osunlock;
 
   // Set default joint positions
   for(unsigned int i = 0; i < rds.dof_; ++i)
@@ -148,6 +226,7 @@ IronDomeApp::IronDomeApp() : t(0), t_sim(0), iter(0), finished(false),
 
   q_sensor = rio.sensors_.q_;
   q_d = rio.sensors_.q_;
+  rio_graphics.sensors_.q_ = rio.sensors_.q_;
 
   cout << fixed << setprecision(3);
 
@@ -169,123 +248,250 @@ IronDomeApp::IronDomeApp() : t(0), t_sim(0), iter(0), finished(false),
 
   ee = rgcm.rbdyn_tree_.at("end-effector");
 
-  ready_pos_joint = Eigen::VectorXd(dof);
-  ready_pos_joint << 0, 1.5, 0, -1.6, 0, .85, 0;
+  ready_pos_joint = rio.sensors_.q_;
+  if(robot.ready_joint_positions.size() == static_cast<size_t>(dof))
+    for(int i = 0; i < dof; i++) ready_pos_joint(i) = robot.ready_joint_positions[i];
 
-  START_ROTATION << -1, 0, 0, 0, 1, 0, 0, 0, -1;
+  x_d = robot.start_position;
+  R_d = robot.start_rotation;
 
-  setDesiredPosition(START_POSITION);
-  setDesiredOrientation(START_ROTATION);
+  InterceptEnvelope envelope;
+  envelope.sphere_pos = robot.collision_sphere_pos;
+  envelope.sphere_radius = robot.collision_sphere_radius;
+  envelope.t_min = T_INTERCEPT_MIN;
+  envelope.z_min = Z_INTERCEPT_MIN;
+  envelope.x_min = X_INTERCEPT_MIN;
+  envelope.y_width = Y_INTERCEPT_WIDTH;
+  salvo_evaluator.setEnvelope(envelope);
+  projectile_manager.setNotifier(&track_updates);
 
   // Start the clock
   sutil::CSystemClock::start();
 
   state = STATE_IDLE;
 
-  if(!rdx.connect(REDOX_HOST, REDOX_PORT)
-     || !rdx_vision.connect(REDOX_HOST, REDOX_PORT)
-     || !rdx_robot.connect(REDOX_HOST, REDOX_PORT)) {
-    cerr << "Failed to connect to Redis at " << REDOX_HOST << ":" << REDOX_PORT << endl;
+  if(config.standby) {
+    // Stand by for a primary; it owns the checkpoint file until then
+    string name = config.failover_shm.empty() ? DEFAULT_FAILOVER_SHM : config.failover_shm;
+    if(!failover.follow(name)) throw runtime_error("No primary to stand by for at " + name + "!");
+    cout << oslock << "Standing by for process " << failover.getLeaderPid() << "." << endl << osunlock;
+  } else {
+    // Resume an engagement cut short by a restart
+    if(!config.checkpoint_file.empty() && checkpoints.open(config.checkpoint_file))
+      restoreCheckpoint();
+    if(!config.failover_shm.empty() && !failover.lead(config.failover_shm))
+      throw runtime_error("Could not lead failover at " + config.failover_shm + "!");
+  }
+
+  // Record observations for replay, if asked to
+  const char* session_file = getenv("IRON_DOME_RECORD_SESSION");
+  if(session_file) {
+    session_log.open(session_file);
+    if(!session_log) throw runtime_error(string("Could not open ") + session_file + "!");
+    cout << oslock << "Recording observations to " << session_file << endl << osunlock;
+  }
+
+  cout << oslock << "Initialized IronDomeApp for " << robot.robot_name
+       << " with " << dof << " degrees of freedom"
+       << (config.redis ? "." : ", without Redis.") << endl << osunlock;
+}
+
+void IronDomeApp::connectRedis() {
+
+  if(!rdx.connect(REDIS_HOST, REDIS_PORT)
+     || !rdx_vision.connect(REDIS_HOST, REDIS_PORT)
+     || !rdx_robot.connect(REDIS_HOST, REDIS_PORT)) {
+    cerr << oslock << "Failed to connect to Redis at " << REDIS_HOST << ":" << REDIS_PORT
+         << endl << osunlock;
     return;
   }
 
-  // Declare this app on redis
-  const std::string app_name = "iron_dome";
-  cout << "Registering " << app_name << " in list of active applications." << endl;
-  rdx.commandSync({"SADD", "scl:apps", app_name});
+  // Declare this app on redis. These are sent once ioLoop starts.
+  cout << oslock << "Registering " << APP_NAME << " in list of active applications."
+       << endl << osunlock;
+  rdx.command({"SADD", "scl:apps", APP_NAME});
+  rdx.command({"SETEX", APP_NAME + ":active", "2", "1"});
+}
 
-  // Watchdog timer to keep app active
-  rdx.commandLoop<std::string>({"SETEX", app_name + ":active", "2", "1"}, nullptr, 1);
+void IronDomeApp::publishModel() {
 
-  // Useful for JSON serialization...
-  Json::FastWriter writer;
-  Json::Value json_val;
+  // Serializing the parsed model is slow, so reuse the JSON from the last
+  // run of the same spec
+  RobotModelCache model_cache(robot, config.graphics);
+  if(!model_cache.load()) {
+    Json::FastWriter writer;
+    Json::Value json_val;
 
-  // Set the parsed data for the Puma
-  flag = serializeToJSON(rds, json_val);
-  if (!flag) {  printf("\n JSON serialization error.. %s",json_val.toStyledString().c_str());  }
-  rdx.commandSync({"HSET", app_name, "spec", writer.write(json_val)});
-  json_val.clear();
+    // Set the parsed data for the Puma
+    bool flag = serializeToJSON(rds, json_val);
+    if (!flag) {  printf("\n JSON serialization error.. %s",json_val.toStyledString().c_str());  }
+    model_cache.spec_json = writer.write(json_val);
+    json_val.clear();
 
-  // Set the graphics data for the Puma
-  flag = serializeToJSON(rgr, json_val);
-  if (!flag) {  printf("\n JSON serialization error.. %s",json_val.toStyledString().c_str());  }
-  rdx.commandSync({"HSET", app_name, "graphics", writer.write(json_val)});
-  json_val.clear();
+    // Set the graphics data for the Puma
+    flag = serializeToJSON(rgr, json_val);
+    if (!flag) {  printf("\n JSON serialization error.. %s",json_val.toStyledString().c_str());  }
+    model_cache.graphics_json = writer.write(json_val);
 
-  cout << oslock << "Initialized IronDomeApp for " << robot_name
-       << " with " << dof << " degrees of freedom." << endl << osunlock;
+    if(!model_cache.store())
+      cerr << oslock << "Could not cache the serialized robot model." << endl << osunlock;
+  }
+  rdx.command({"HSET", APP_NAME, "spec", model_cache.spec_json});
+  rdx.command({"HSET", APP_NAME, "graphics", model_cache.graphics_json});
+}
+
+bool IronDomeApp::postCommand(ControlCommand cmd) {
+
+  cmd.seq = ++next_command_seq;
+  cmd.posted_ns = steadyNanos();
+  cmd.t = AppClock::now();
+
+  if(!commands.post(cmd)) {
+    metrics.commands_dropped.increment();
+    return false;
+  }
+
+  if(session_log.is_open()) {
+    lock_guard<mutex> lg(session_lock);
+    session_log << formatCommandMessage(cmd) << "\n";
+  }
+  return true;
 }
 
 void IronDomeApp::translate(double x, double y, double z) {
-  Eigen::Vector3d pos(x, y, z);
-  lock_guard<mutex> lg(data_lock);
-  x_d += pos;
+  ControlCommand cmd(ControlCommand::TRANSLATE);
+  cmd.v << x, y, z;
+  postCommand(cmd);
 }
 
 void IronDomeApp::rotate(double x, double y, double z) {
-
-  Eigen::Matrix3d temp = R_d * Eigen::AngleAxisd(x, Eigen::Vector3d::UnitX()) *
-         Eigen::AngleAxisd(y, Eigen::Vector3d::UnitY()) *
-         Eigen::AngleAxisd(z, Eigen::Vector3d::UnitZ());
-  lock_guard<mutex> lg(data_lock);
-  R_d = temp;
+  ControlCommand cmd(ControlCommand::ROTATE);
+  cmd.v << x, y, z;
+  postCommand(cmd);
 }
 
 void IronDomeApp::setDesiredJointPosition(const Eigen::VectorXd& q_new) {
-  lock_guard<mutex> lg(data_lock);
-  q_d = q_new;
+  ControlCommand cmd(ControlCommand::JOINT_POSITION);
+  cmd.q = q_new;
+  postCommand(cmd);
 }
 
 void IronDomeApp::setDesiredPosition(double x, double y, double z) {
-  lock_guard<mutex> lg(data_lock);
-  x_d << x, y, z;
+  setDesiredPosition(Eigen::Vector3d(x, y, z));
 }
 
 void IronDomeApp::setDesiredPosition(const Eigen::Vector3d& pos) {
-  lock_guard<mutex> lg(data_lock);
-  x_d = pos;
+  ControlCommand cmd(ControlCommand::POSITION);
+  cmd.v = pos;
+  postCommand(cmd);
 }
 
 void IronDomeApp::setDesiredOrientation(const Eigen::Matrix3d& R) {
-  lock_guard<mutex> lg(data_lock);
-  R_d = R;
+  ControlCommand cmd(ControlCommand::ORIENTATION);
+  cmd.R = R;
+  postCommand(cmd);
 }
 
 void IronDomeApp::setDesiredOrientation(const Eigen::Quaterniond& quat) {
-  Eigen::Matrix3d temp = quat.normalized().toRotationMatrix();
-  lock_guard<mutex> lg(data_lock);
-  R_d = temp;
+  setDesiredOrientation(quat.normalized().toRotationMatrix());
 }
 
 void IronDomeApp::setDesiredOrientation(double x, double y, double z) {
-  auto temp = Eigen::AngleAxisd(x, Eigen::Vector3d::UnitX()) *
+  Eigen::Matrix3d temp = (Eigen::AngleAxisd(x, Eigen::Vector3d::UnitX()) *
       Eigen::AngleAxisd(y, Eigen::Vector3d::UnitY()) *
-      Eigen::AngleAxisd(z, Eigen::Vector3d::UnitZ());
-  lock_guard<mutex> lg(data_lock);
-  R_d = temp;
+      Eigen::AngleAxisd(z, Eigen::Vector3d::UnitZ())).toRotationMatrix();
+  setDesiredOrientation(temp);
 }
 
 void IronDomeApp::setControlGains(double kp_p, double kv_p, double kp_r, double kv_r) {
-  lock_guard<mutex> lg(data_lock);
-  this->kp_p = kp_p;
-  this->kv_p = kv_p;
-  this->kp_r = kp_r;
-  this->kv_r = kv_r;
+  ControlCommand cmd(ControlCommand::GAINS);
+  cmd.gains[0] = kp_p;
+  cmd.gains[1] = kv_p;
+  cmd.gains[2] = kp_r;
+  cmd.gains[3] = kv_r;
+  postCommand(cmd);
 }
 
 void IronDomeApp::setJointFrictionDamping(double kv_friction) {
-  lock_guard<mutex> lg(data_lock);
-  for(int i = 0; i < dof; i++) {
-    rds.rb_tree_.at(i)->friction_gc_kv_ = kv_friction * 1.3;
+  ControlCommand cmd(ControlCommand::FRICTION);
+  cmd.value = kv_friction;
+  postCommand(cmd);
+}
+
+void IronDomeApp::applyCommands() {
+
+  ControlCommand cmd;
+  for(int n = 0; n < MAX_COMMANDS_PER_TICK && commands.take(cmd); n++) {
+    applyCommand(cmd);
+    applied_command_seq = cmd.seq;
+    metrics.commands.increment();
+    metrics.command_latency.record(steadyNanos() - cmd.posted_ns);
   }
 }
 
-void IronDomeApp::updateState() {
+void IronDomeApp::applyCommand(const ControlCommand& cmd) {
+
+  switch(cmd.type) {
+
+    case ControlCommand::POSITION:
+      x_d = cmd.v;
+      break;
+
+    case ControlCommand::TRANSLATE:
+      x_d += cmd.v;
+      break;
+
+    case ControlCommand::ORIENTATION:
+      R_d = cmd.R;
+      break;
 
-  lock_guard<mutex> lg(data_lock);
+    case ControlCommand::ROTATE:
+      R_d = R_d * (Eigen::AngleAxisd(cmd.v(0), Eigen::Vector3d::UnitX()) *
+          Eigen::AngleAxisd(cmd.v(1), Eigen::Vector3d::UnitY()) *
+          Eigen::AngleAxisd(cmd.v(2), Eigen::Vector3d::UnitZ())).toRotationMatrix();
+      break;
+
+    case ControlCommand::JOINT_POSITION:
+      if(cmd.q.size() == dof) q_d = cmd.q;
+      break;
+
+    case ControlCommand::GAINS:
+      kp_p = cmd.gains[0];
+      kv_p = cmd.gains[1];
+      kp_r = cmd.gains[2];
+      kv_r = cmd.gains[3];
+      break;
+
+    case ControlCommand::FRICTION:
+      for(int i = 0; i < dof; i++) {
+        rds.rb_tree_.at(i)->friction_gc_kv_ = cmd.value * 1.3;
+      }
+      break;
+
+    case ControlCommand::PAUSED:
+      paused = cmd.flag;
+      break;
+
+    case ControlCommand::SIMULATION:
+      if(simulation && !cmd.flag) q_sensor = q;
+      simulation = cmd.flag;
+      break;
+
+    case ControlCommand::JOINT_SPACE:
+      joint_space = cmd.flag;
+      // Hold the current pose in the new space
+      if(joint_space) q_d = q;
+      else x_d = x_c;
+      break;
+
+    default:
+      break;
+  }
+}
+
+void IronDomeApp::updateState() {
 
-  double t_new = sutil::CSystemClock::getSysTime();
+  double t_new = AppClock::now();
   double t_sim_new = sutil::CSystemClock::getSimTime();
   dt_sim = (t_sim_new - t_sim);
   dt_real = (t_new - t);
@@ -299,6 +505,8 @@ void IronDomeApp::updateState() {
   if(simulation) {
     q = rio.sensors_.q_;
   } else {
+    // Once the robot has reported its joint positions
+    if(robot_joints.version() > 1) robot_joints.read(q_sensor);
     q = rio.sensors_.q_;
     //q = q_sensor;
     //rio.sensors_.q_ = q;
@@ -340,14 +548,90 @@ void IronDomeApp::updateState() {
   omega = J.block(3, 0, 3, dof) * dq;
 }
 
+void IronDomeApp::publishState() {
+
+  SensedState sensed;
+  sensed.t = t;
+  sensed.iter = iter;
+  sensed.q = q;
+  sensed.dq = dq;
+  sensed.ddq = ddq;
+  sensed.x_c = x_c;
+  sensed.R_c = R_c;
+  sensed.v = v;
+  sensed.omega = omega;
+  sensed_buffer.write(sensed);
+
+  Setpoints setpoints;
+  setpoints.x_d = x_d;
+  setpoints.R_d = R_d;
+  setpoints.q_d = q_d;
+  setpoints.joint_space = joint_space;
+  setpoints.paused = paused;
+  setpoints.simulation = simulation;
+  setpoints.command_seq = applied_command_seq;
+  setpoints.state = state;
+  setpoints.target_id = target ? target->getID() : -1;
+  setpoint_buffer.write(setpoints);
+
+  ControllerOutput output;
+  output.F = F;
+  output.tau = tau;
+  output.tau_jlim = tau_jlim;
+  output.dx = dx;
+  output.dphi = dphi;
+  output_buffer.write(output);
+
+  if(iter % DIAGNOSTICS_DECIMATION == 0) {
+    Diagnostics diagnostics;
+    diagnostics.t = t;
+    diagnostics.t_sim = t_sim;
+    diagnostics.dt_real = dt_real;
+    diagnostics.dt_sim = dt_sim;
+    diagnostics.iter = iter;
+    diagnostics.M_gc = rgcm.M_gc_;
+    diagnostics.lambda = lambda;
+    diagnostics.J = J;
+    diagnostics.q_sat = q_sat;
+    diagnostics.x_inc = x_inc;
+    diagnostics_buffer.write(diagnostics);
+  }
+}
+
 void IronDomeApp::commandTorque(Eigen::VectorXd torque) {
-  lock_guard<mutex> lg(data_lock);
   rio.actuators_.force_gc_commanded_ = torque;
 }
 
 bool IronDomeApp::isPaused() {
-  lock_guard<mutex> lg(data_lock);
-  return paused;
+  return getSetpoints().paused;
+}
+
+void IronDomeApp::setPaused(bool paused) {
+  ControlCommand cmd(ControlCommand::PAUSED);
+  cmd.flag = paused;
+  postCommand(cmd);
+}
+
+IronDomeApp::~IronDomeApp() {
+  stop();
+}
+
+void IronDomeApp::stop() {
+  stop_token.requestStop();
+  joinDashboard();
+}
+
+void IronDomeApp::joinDashboard() {
+  lock_guard<mutex> lock(dashboard_lock);
+  if(dashboard_thread.joinable()) dashboard_thread.join();
+}
+
+vector<string> IronDomeApp::getControllerNames() {
+  return CONTROLLER_NAMES;
+}
+
+double IronDomeApp::getControlPeriod() {
+  return SIMULATION_DT;
 }
 
 void IronDomeApp::stateMachine() {
@@ -355,103 +639,115 @@ void IronDomeApp::stateMachine() {
   //cout << oslock << "State: " << state << endl << osunlock;
 
   // Pause if needed
-  if(isPaused() && (state != STATE_PAUSED)) {
+  if(paused && (state != STATE_PAUSED)) {
+    if(state == STATE_TARGETING) metrics.targets_paused.increment();
     state = STATE_PAUSED;
     target = NULL;
-    setDesiredPosition(START_POSITION);
-    setDesiredOrientation(START_ROTATION);
+    metrics.target_id.set(-1);
+    x_d = robot.start_position;
+    R_d = robot.start_rotation;
   }
 
   projectile_manager.updateActiveProjectiles();
   auto active_projectiles = projectile_manager.getActiveProjectiles();
 
+  metrics.tracks.set(projectile_manager.getNumTracked());
+  metrics.converged_tracks.set(active_projectiles.size());
+  metrics.state.set(state);
+
+  // Intercepts are evaluated by the planner as tracks change. Without
+  // one, do it here, but still only when they changed.
+  if(!planner_running.load(memory_order_acquire))
+    salvo_evaluator.evaluateIfChanged(AppClock::now());
+
+  uint64_t count = salvo_evaluator.getResultCount();
+  if(count != salvo_count) {
+    salvo_evaluator.getResult(salvo);
+    salvo_count = count;
+    metrics.dropped_tracks.set(salvo.dropped);
+    replan = true;
+  }
+
   if(state == STATE_PAUSED) {
 
-    if(!isPaused())
+    if(!paused) {
       state = STATE_IDLE;
+      replan = true;
+    }
 
   } if(state == STATE_IDLE) {
 
+    // First selectable track, by ID, that is still active. Nothing new
+    // can be selectable until the evaluation or the state changes.
+    // TODO compare tracks and pick the best one
     Projectile* best_target = NULL;
-    for(pair<const int, Projectile*>& p : active_projectiles) {
-
-      Projectile* proj = p.second;
-      if(!best_target) {
-
-        double tIntersect = proj->getIntersectionTime(
-            COLLISION_SPHERE_POS,
-            COLLISION_SPHERE_RADIUS
-        );
-
-        if(tIntersect >= T_INTERCEPT_MIN) {
-          Eigen::Vector3d collision_pos = proj->getPosition(tIntersect);
-          if((collision_pos[2] > Z_INTERCEPT_MIN) &&
-             (abs(collision_pos[1]) < Y_INTERCEPT_WIDTH) &&
-                 (collision_pos[0] > X_INTERCEPT_MIN)) {
-            best_target = proj;
-          }
-        }
-      } else {
-        // TODO compare proj to best_target
-        // if better target, best_target = proj
-        continue;
-      }
+    for(int i = 0; replan && i < salvo.count && !best_target; i++) {
+      if(!salvo.tracks[i].selectable) continue;
+      auto it = active_projectiles.find(salvo.tracks[i].id);
+      if(it != active_projectiles.end()) best_target = it->second;
     }
+    replan = false;
 
     if(best_target) {
       target = best_target;
       state = STATE_TARGETING;
+      metrics.targets_acquired.increment();
+      metrics.target_id.set(target->getID());
+      reaction_probe.selected_ns = steadyNanos();
+      reaction_probe.selected_id = target->getID();
       cout << oslock << "Now targeting projectile " << target->getID() << endl << osunlock;
     } else {
       state = STATE_IDLE;
     }
 
-    data_lock.lock();
     joint_space = true;
-    data_lock.unlock();
-
-    setDesiredJointPosition(ready_pos_joint);
-    setDesiredPosition(READY_POSITION);
-//    setDesiredOrientation(READY_ORIENTATION);
+    q_d = ready_pos_joint;
+    x_d = robot.ready_position;
+//    R_d = READY_ORIENTATION;
 
   } else if(state == STATE_TARGETING) {
 
-    data_lock.lock();
     joint_space = false;
-    data_lock.unlock();
 
     if(active_projectiles.find(target->getID()) == active_projectiles.end()) {
+      metrics.targets_expired.increment();
       target = NULL;
+      metrics.target_id.set(-1);
       state = STATE_IDLE;
+      replan = true;
       return;
     }
 
     double tIntersect = target->getIntersectionTime(
-        COLLISION_SPHERE_POS,
-        COLLISION_SPHERE_RADIUS
+        robot.collision_sphere_pos,
+        robot.collision_sphere_radius
     );
 
     if(tIntersect >= 0) {
       Eigen::Vector3d collision_pos = target->getPosition(tIntersect);
 
-      if((collision_pos[2] < Z_INTERCEPT_MIN - CHASE_HYSTERESIS) ||
-          (abs(collision_pos[1]) > Y_INTERCEPT_WIDTH + CHASE_HYSTERESIS) ||
-          (collision_pos[0] < X_INTERCEPT_MIN - CHASE_HYSTERESIS)) {
+      if(!salvo_evaluator.getEnvelope().contains(collision_pos, CHASE_HYSTERESIS)) {
+        metrics.targets_out_of_envelope.increment();
         target = NULL;
+        metrics.target_id.set(-1);
         state = STATE_IDLE;
+        replan = true;
         return;
       }
 
-      setDesiredPosition(collision_pos);
+      x_d = collision_pos;
+
+      if(reaction_probe.setpoint_id != target->getID()) {
+        reaction_probe.setpoint_ns = steadyNanos();
+        reaction_probe.setpoint_id = target->getID();
+      }
 
       Eigen::Vector3d desired_z_axis = -target->getVelocity(tIntersect);
       desired_z_axis.normalize();
 
-      setDesiredOrientation(
-          Eigen::Quaterniond::FromTwoVectors(
-              Eigen::Vector3d::UnitZ(), desired_z_axis
-          )
-      );
+      R_d = Eigen::Quaterniond::FromTwoVectors(
+          Eigen::Vector3d::UnitZ(), desired_z_axis
+      ).toRotationMatrix();
     }
   } else if(state == STATE_UNINIT) {
     throw std::runtime_error("Uninitialized!");
@@ -460,8 +756,6 @@ void IronDomeApp::stateMachine() {
 
 void IronDomeApp::fullTaskSpaceControl() {
 
-  lock_guard<mutex> lg(data_lock);
-
   // Position error vector
   dx = x_c - x_d;
 
@@ -494,8 +788,6 @@ _Matrix_Type_ pseudoInverse(const _Matrix_Type_ &a, double epsilon = std::numeri
 
 void IronDomeApp::incrementalTaskSpaceControl() {
 
-  lock_guard<mutex> lg(data_lock);
-
   // Position error vector
   dx = x_c - x_d;
 
@@ -528,8 +820,6 @@ void IronDomeApp::incrementalTaskSpaceControl() {
 
 void IronDomeApp::resolvedMotionRateControl() {
 
-  lock_guard<mutex> lg(data_lock);
-
   // Position error vector
   dx = x_c - x_d;
 
@@ -592,8 +882,6 @@ void IronDomeApp::resolvedMotionRateControl() {
 
 void IronDomeApp::jointSpaceControl() {
 
-  lock_guard<mutex> lg(data_lock);
-
   // Joint error vector
   q_diff = q - q_d;
 
@@ -637,15 +925,12 @@ void IronDomeApp::applyJointLimitPotential() {
 
 void IronDomeApp::integrate() {
 
-  lock_guard<mutex> lg(data_lock);
   dyn_tao.integrate(rio, SIMULATION_DT);
   iter++;
 }
 
 void IronDomeApp::sendToRobot() {
 
-  data_lock.lock();
-
   // Position error vector
   dx = x_c - x_d;
 
@@ -680,31 +965,56 @@ void IronDomeApp::sendToRobot() {
 //      to_string(R_d(1, 2)) + " " +
 //      to_string(R_d(2, 2));
 
-  data_lock.unlock();
-
-  rdx.command({"LPUSH", "iron_dome:robot_commands", msg.str()});
+  // Measure the round trip to Redis as the command transport latency
+  LatencyHistogram& latency = metrics.robot_command_latency;
+  chrono::steady_clock::time_point t_sent = chrono::steady_clock::now();
+  string robot_command = msg.str();
+  io_loop.post([this, &latency, t_sent, robot_command]() {
+    rdx.command({"LPUSH", "iron_dome:robot_commands", robot_command},
+        [&latency, t_sent](redisReply* reply) {
+          if(RedisClient::ok(reply)) latency.record(nanosBetween(t_sent, chrono::steady_clock::now()));
+        }
+    );
+  });
 }
 
-void IronDomeApp::controlsLoop() {
+void IronDomeApp::controlTick() {
 
-  while(!finished) {
+  // The control tick should never touch the heap
+  RealTimeSection rt("control tick");
 
-    data_lock.lock();
-    bool simulation_enabled = simulation;
-    bool joint_space_enabled = joint_space;
-    data_lock.unlock();
+  chrono::steady_clock::time_point tick_start = chrono::steady_clock::now();
+  if(metrics.control_ticks.value() > 0)
+    metrics.control_period.record(nanosBetween(last_tick_start, tick_start));
+  last_tick_start = tick_start;
 
+  applyCommands();
+  bool simulation_enabled = simulation;
+  bool joint_space_enabled = joint_space || (controller == CONTROLLER_JOINT);
+
+  {
+    ScopedTimer timer(metrics.stage_update_state);
     updateState();
+  }
 
-    if(!simulation_enabled) sendToRobot();
+  if(!simulation_enabled && active.load(memory_order_relaxed)) {
+    ScopedTimer timer(metrics.stage_send_to_robot);
+    sendToRobot();
+  }
 
+  {
+    ScopedTimer timer(metrics.stage_state_machine);
     stateMachine();
+  }
+
+  {
+    ScopedTimer timer(metrics.stage_controller);
 
     if(!joint_space_enabled) {
       // Compute the ideal joint torques based on some algorithm
-      //fullTaskSpaceControl();
-      incrementalTaskSpaceControl();
-      //resolvedMotionRateControl();
+      if(controller == CONTROLLER_FULL) fullTaskSpaceControl();
+      else if(controller == CONTROLLER_RMRC) resolvedMotionRateControl();
+      else incrementalTaskSpaceControl();
     } else {
       jointSpaceControl();
     }
@@ -720,11 +1030,39 @@ void IronDomeApp::controlsLoop() {
 
     // Clamp the commanded torques
     applyTorqueLimits();
+  }
 
+  {
+    ScopedTimer timer(metrics.stage_integrate);
     commandTorque(tau);
     integrate();
+  }
 
-    double t_new = sutil::CSystemClock::getSysTime();
+  publishState();
+
+  uint64_t tick_ns = nanosBetween(tick_start, chrono::steady_clock::now());
+  metrics.control_tick.record(tick_ns);
+  metrics.control_ticks.increment();
+  if(tick_ns > SIMULATION_DT * 1e9) metrics.control_deadline_misses.increment();
+}
+
+void IronDomeApp::controlsLoop() {
+
+  AllocationTracker::registerThread("control");
+
+  while(!stop_token.stopRequested()) {
+
+    // A standby takes over once the primary stops beating
+    if(!active.load(memory_order_relaxed)
+        && !failover.leaderAlive(FAILOVER_TIMEOUT, FAILOVER_STALL_TIMEOUT)) takeOver();
+
+    // Beat before the tick, so a primary replaced while it stalled finds
+    // out before it sends another command alongside its successor
+    if(failover.isLeader() && !failover.beat()) standDown();
+
+    controlTick();
+
+    double t_new = AppClock::now();
     double t_wait = SIMULATION_DT - (t_new - t);
 //    if(iter % 950 == 0) {
 //      cout << oslock << "t_wait: " << t_wait*1000 << endl << osunlock;
@@ -740,8 +1078,39 @@ void IronDomeApp::controlsLoop() {
   }
 }
 
+void IronDomeApp::plannerLoop() {
+
+  AllocationTracker::registerThread("planner");
+  planner_running.store(true, memory_order_release);
+  int dropped = 0;
+
+  while(!stop_token.stopRequested()) {
+
+    // Sleep until a track changes; the timeout only checks for stop
+    if(!track_updates.wait(PLANNER_IDLE_TIMEOUT)) continue;
+    metrics.planner_wakeups.increment();
+
+    {
+      ScopedTimer timer(metrics.planner_evaluation);
+      salvo_evaluator.evaluateIfChanged(AppClock::now());
+    }
+
+    // Tracks left out can never be selected, so say so when it starts
+    int now_dropped = salvo_evaluator.getDropped();
+    if(now_dropped > 0 && dropped == 0) {
+      cerr << oslock << "WARNING: More than " << MAX_SALVO_TRACKS
+           << " converged tracks; the newest are not evaluated." << endl << osunlock;
+    }
+    dropped = now_dropped;
+  }
+
+  planner_running.store(false, memory_order_release);
+}
+
 void IronDomeApp::graphicsLoop() {
 
+  AllocationTracker::registerThread("graphics");
+
   // Current position
   chai3d::cMaterial x_c_mat;
   x_c_mat.setBlueMediumSlate();
@@ -765,115 +1134,75 @@ void IronDomeApp::graphicsLoop() {
   chai3d::cMesh collision_sphere(&collision_sphere_mat);
   collision_sphere.setUseTransparency(true);
   collision_sphere.setTransparencyLevel(0.1);
-  chai3d::cCreateSphere(&collision_sphere, COLLISION_SPHERE_RADIUS);
+  chai3d::cCreateSphere(&collision_sphere, robot.collision_sphere_radius);
   //chai_world->addChild(&collision_sphere);
   collision_sphere.setLocalPos(
-      COLLISION_SPHERE_POS(0),
-      COLLISION_SPHERE_POS(1),
-      COLLISION_SPHERE_POS(2)
+      robot.collision_sphere_pos(0),
+      robot.collision_sphere_pos(1),
+      robot.collision_sphere_pos(2)
   );
 
   // Projectiles
-  map<int, chai3d::cMesh> projectile_spheres;
-  map<int, chai3d::cMesh> projectile_spheres_m;
-  map<int, chai3d::cMesh> projectile_spheres_c;
-  chai3d::cMaterial projectile_mat;
-  projectile_mat.setYellow();
-  chai3d::cMaterial projectile_mat_m;
-  projectile_mat_m.setGreen();
-  chai3d::cMaterial projectile_mat_c;
-  projectile_mat_c.setGray();
+  ProjectileMarkers projectile_markers(chai_world);
+
+  // Frame rate and detail, backing off when control or the CPUs are overloaded
+  DetailGovernor governor;
+  projectile_markers.setDetail(governor.getDetail());
+  metrics.graphics_detail_level.set(governor.getLevel());
 
   Json::FastWriter writer;
   Json::Value json_val;
 
-  long nanosec = static_cast<long>(GRAPHICS_DT * 1e9);
-  const timespec ts = {0, nanosec};
-  while(!finished) {
-
-    // Serialize the RIO object and publish to Redis
-    if (!serializeToJSON(rio, json_val)) {
-      cout << "JSON serialization error: " << json_val.toStyledString() << endl;
-      continue;
-    }
-    rdx.command({"HSET", "iron_dome", "io", writer.write(json_val)});
-
-    // Draw control points
-    x_c_sphere.setLocalPos(x_c[0], x_c[1], x_c[2]);
-    x_d_sphere.setLocalPos(x_d[0], x_d[1], x_d[2]);
-
-    auto active_projectiles = projectile_manager.getActiveProjectiles();
-
-    // Draw projectiles
-    for(pair<const int, Projectile*>& p : active_projectiles) {
-      Projectile* proj = p.second;
-      int id = proj->getID();
+  while(!stop_token.stopRequested()) {
 
-      // Create a new sphere if needed
-      if(projectile_spheres.find(id) == projectile_spheres.end()) {
+    chrono::steady_clock::time_point frame_start = chrono::steady_clock::now();
 
-        projectile_spheres[id] = chai3d::cMesh(&projectile_mat);
-        chai3d::cCreateSphere(&projectile_spheres[id], 0.04);
-        chai_world->addChild(&projectile_spheres[id]);
-
-        projectile_spheres_m[id] = chai3d::cMesh(&projectile_mat_m);
-        chai3d::cCreateSphere(&projectile_spheres_m[id], 0.04);
-        chai_world->addChild(&projectile_spheres_m[id]);
-
-        projectile_spheres_c[id] = chai3d::cMesh(&projectile_mat_c);
-        chai3d::cCreateSphere(&projectile_spheres_c[id], 0.04);
-        chai_world->addChild(&projectile_spheres_c[id]);
-      }
-
-      // Set sphere position
-      double now = sutil::CSystemClock::getSysTime();
-      Eigen::Vector3d pos = proj->getPosition(now);
-      projectile_spheres[id].setLocalPos(pos(0), pos(1), pos(2));
-      const Eigen::Vector3d& pObs = proj->getLastObservedPosition();
-      projectile_spheres_m[id].setLocalPos(pObs(0), pObs(1), pObs(2));
-
-      double tIntersect = proj->getIntersectionTime(COLLISION_SPHERE_POS, COLLISION_SPHERE_RADIUS);
-      if(tIntersect >= 0) {
-        Eigen::Vector3d collision_pos = proj->getPosition(tIntersect);
-        projectile_spheres_c[id].setLocalPos(collision_pos(0), collision_pos(1), collision_pos(2));
-//        cout << oslock << "Projectile " << proj.id << " will collide with sphere at t = "
-//             << tIntersect << " and position = " << collision_pos.transpose() << endl << osunlock;
-      }
+    // Take this frame's state from the control loop's snapshots
+    SensedState sensed = getSensedState();
+    Setpoints setpoints = getSetpoints();
+    if(sensed.q.size() == dof) {
+      rio_graphics.sensors_.q_ = sensed.q;
+      rio_graphics.sensors_.dq_ = sensed.dq;
+      rio_graphics.sensors_.ddq_ = sensed.ddq;
+      rio_graphics.actuators_.force_gc_commanded_ = getControllerOutput().tau;
     }
 
-    // Remove spheres that are no longer representing active projectiles
-    for(auto it = projectile_spheres.begin(); it != projectile_spheres.end();) {
-      if(active_projectiles.find((*it).first) == active_projectiles.end()) {
-        chai_world->removeChild(&(*it).second);
-        projectile_spheres.erase(it++);
-      } else {
-        ++it;
+    // Serialize the RIO object and publish to Redis, unless standing by
+    if(active.load(memory_order_relaxed)) {
+      if (!serializeToJSON(rio_graphics, json_val)) {
+        cout << "JSON serialization error: " << json_val.toStyledString() << endl;
+        continue;
       }
+      string io_json = writer.write(json_val);
+      io_loop.post([this, io_json]() { rdx.command({"HSET", APP_NAME, "io", io_json}); });
     }
 
-    for(auto it = projectile_spheres_m.begin(); it != projectile_spheres_m.end();) {
-      if(active_projectiles.find((*it).first) == active_projectiles.end()) {
-        chai_world->removeChild(&(*it).second);
-        projectile_spheres_m.erase(it++);
-      } else {
-        ++it;
-      }
-    }
+    // Draw control points
+    x_c_sphere.setLocalPos(sensed.x_c[0], sensed.x_c[1], sensed.x_c[2]);
+    x_d_sphere.setLocalPos(setpoints.x_d[0], setpoints.x_d[1], setpoints.x_d[2]);
 
-    for(auto it = projectile_spheres_c.begin(); it != projectile_spheres_c.end();) {
-      if(active_projectiles.find((*it).first) == active_projectiles.end()) {
-        chai_world->removeChild(&(*it).second);
-        projectile_spheres_c.erase(it++);
-      } else {
-        ++it;
-      }
-    }
+    // Draw projectiles, with intercepts from the planner's last evaluation
+    salvo_evaluator.getResult(graphics_salvo);
+    projectile_markers.update(projectile_manager, graphics_salvo, AppClock::now());
 
     glutMainLoopEvent();
-    nanosleep(&ts, NULL);
+
+    uint64_t frame_ns = nanosBetween(frame_start, chrono::steady_clock::now());
+    metrics.graphics_frame.record(frame_ns);
+    metrics.graphics_frames.increment();
+
+    if(governor.update(metrics.control_ticks.value(), metrics.control_deadline_misses.value(),
+                       frame_ns * 1e-9)) {
+      projectile_markers.setDetail(governor.getDetail());
+      metrics.graphics_detail_level.set(governor.getLevel());
+    }
+
+    // Sleep out the rest of the frame period
+    this_thread::sleep_until(frame_start + chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(governor.getDetail().frame_dt)));
 
     if(!scl_chai_glut_interface::CChaiGlobals::getData()->chai_glut_running)
-      finished = true;
+      stop_token.requestStop();
   }
 }
 
@@ -895,244 +1224,616 @@ void printHelp() {
       << "  [s]witch                           Switch between simulation and robot.\n"
       << "  [j]oint                            Toggle joint space control.\n"
       << "  jmo[v]e                            Command a position in joint space.\n"
+      << "  [l]ocks [on|off|reset]             Lock contention profiling report.\n"
+      << "  allo[c]s [off|count|assert|reset]  Heap allocation report.\n"
+      << "  dash[b]oard                        Live dashboard, q to return.\n"
+      << "  prof[i]le start [hz [n]]|stop|dump [f] CPU sampling profiler, folded stacks.\n"
       << endl << osunlock;
 }
 
 void IronDomeApp::printState() {
 
+  Diagnostics d = getDiagnostics();
+  SensedState sensed = getSensedState();
+  Setpoints setpoints = getSetpoints();
+  ControllerOutput output = getControllerOutput();
+
   cout << oslock;
 
-  cout << "======= Frame " << iter << " =======\n";
-  cout << "t = " << t << ", t_sim = " << t_sim << "\n";
-  cout << "dt_sim = " << dt_sim << ", " << "dt_real = " << dt_real << "\n\n";
+  cout << "======= Frame " << d.iter << " =======\n";
+  cout << "t = " << d.t << ", t_sim = " << d.t_sim << "\n";
+  cout << "dt_sim = " << d.dt_sim << ", " << "dt_real = " << d.dt_real << "\n\n";
 
-  cout << "M_gc = \n" << rgcm.M_gc_ << "\n\n";
-  //cout << "lambda_inv = \n" << lambda_inv << "\n\n";
-  cout << "lambda = \n" << lambda << "\n\n";
-  cout << "J = \n" << J << "\n\n";
+  cout << "M_gc = \n" << d.M_gc << "\n\n";
+  cout << "lambda = \n" << d.lambda << "\n\n";
+  cout << "J = \n" << d.J << "\n\n";
 
-  cout << "  F = " << F.transpose() << "\n";
-  cout << "tau = " << rio.actuators_.force_gc_commanded_.transpose() << "\n";
-  cout << "tau_jlim = " << tau_jlim.transpose() << "\n\n";
+  cout << "  F = " << output.F.transpose() << "\n";
+  cout << "tau = " << output.tau.transpose() << "\n";
+  cout << "tau_jlim = " << output.tau_jlim.transpose() << "\n\n";
 
-  cout << "  q = " <<   q.transpose() << "\n"
-       << " dq = " <<  dq.transpose() << "\n"
-       << "ddq = " << ddq.transpose() << "\n"
-       << "q_sat = " << q_sat.transpose() << "\n\n";
+  cout << "  q = " <<   sensed.q.transpose() << "\n"
+       << " dq = " <<  sensed.dq.transpose() << "\n"
+       << "ddq = " << sensed.ddq.transpose() << "\n"
+       << "q_sat = " << d.q_sat.transpose() << "\n\n";
 
-  cout << " x_c = " << x_c.transpose() << "\n"
-       << " x_d = " << x_d.transpose() << "\n"
-       << " x_inc = " << x_inc.transpose() << "\n"
-       << " R_c = \n" << R_c << "\n";
+  cout << " x_c = " << sensed.x_c.transpose() << "\n"
+       << " x_d = " << setpoints.x_d.transpose() << "\n"
+       << " x_inc = " << d.x_inc.transpose() << "\n"
+       << " R_c = \n" << sensed.R_c << "\n";
 
   cout << osunlock;
 }
 
-void IronDomeApp::visionLoop() {
-
-  rdx_vision.command<vector<string>>({"BLPOP", "iron_dome:projectiles", "0"},
-      [this](redox::Command<vector<string>>& c) {
+bool IronDomeApp::ingestObservation(const string& msg) {
 
-        if(!c.ok()) {
-          cerr << "Error reply for getting projectile observations: " << c.status() << endl;
+  ScopedTimer timer(metrics.observation_processing);
 
-        } else {
-
-          int id; // Unique ID number of projectile
-          double time, x, y, z; // Timestamp and measured position
+  ObservationMessage obs;
+  if(!parseObservationMessage(msg, obs)) {
+    metrics.invalid_observations.increment();
+    cerr << oslock << "ERROR: Invalid projectile measurement received: "
+        << msg << endl << osunlock;
+    return false;
+  }
 
-          const string& msg = c.reply()[1];
-          stringstream msg_stream(msg);
-          cout << "Message: " << oslock << msg << endl << osunlock;
+  metrics.observations.increment();
 
-          // Read the message into the variables
-          msg_stream >> id >> time >> x >> y >> z;
+  // The vision side sends raw sensor frame points once calibrated
+  bool calibrated = !config.calibration_file.empty();
+  if(calibrated) {
+    Eigen::Vector3d x = calibration.apply(Eigen::Vector3d(obs.x, obs.y, obs.z));
+    obs.x = x(0);
+    obs.y = x(1);
+    obs.z = x(2);
+  }
 
-          if(msg_stream.fail()) {
-            cerr << oslock << "ERROR: Invalid projectile measurement received: "
-                << msg << endl << osunlock;
-          } else {
-            projectile_manager.addObservation(id, time, x, y, z);
-          }
-        }
+  // Record what the tracker sees, so sessions replay without the calibration
+  if(session_log.is_open()) {
+    lock_guard<mutex> lg(session_lock);
+    session_log << (calibrated ? formatObservationMessage(obs) : msg) << "\n";
+  }
 
-        // Do another BLPOP until the next observation comes
-        this->visionLoop();
-      }
-  );
+  projectile_manager.addObservation(obs.id, obs.t, obs.x, obs.y, obs.z);
+  return true;
 }
 
-void IronDomeApp::shellLoop() {
+void IronDomeApp::ioLoop() {
 
-  // Pause so initial printout is after all threads launch.
-  long nanosec = static_cast<long>(0.1 * 1e9);
-  const timespec ts = {0, nanosec};
-  nanosleep(&ts, NULL);
+  AllocationTracker::registerThread("io");
 
-  cout << oslock << "\n"
-      << "*******************************\n"
-      << "* Iron Dome Interactive Shell *\n"
-      << "*******************************\n"
-      << endl << osunlock;
+  if(config.redis)
+    io_loop.addTimer(QUEUE_SAMPLE_INTERVAL, [this]() { sampleQueueDepths(); });
 
-  printHelp();
+  // A standby starts these when it takes over
+  if(active.load(memory_order_relaxed)) startPublishing();
 
-  while(!finished) {
-    cout << oslock << ">> " << osunlock;
+  if(config.shell) {
+    cout << oslock << "\n"
+        << "*******************************\n"
+        << "* Iron Dome Interactive Shell *\n"
+        << "*******************************\n"
+        << endl << osunlock;
 
-    string cmd;
-    cin >> cmd;
+    printHelp();
+    cout << oslock << ">> " << flush << osunlock;
+    shell_watcher = io_loop.watchReadable(STDIN_FILENO, [this]() { readShellInput(); });
+  }
 
-    if((cmd == "move") || (cmd == "m")) {
+  io_loop.run(stop_token);
+}
 
-      double x, y, z;
-      cin >> x >> y >> z;
-      cout << oslock << "Moving to "
-          << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
-      setDesiredPosition(x, y, z);
+void IronDomeApp::startPublishing() {
 
-    } else if((cmd == "translate") || (cmd == "t")) {
+  // A standby may take over before the loop first runs
+  if(publishing) return;
+  publishing = true;
 
-      double x, y, z;
-      cin >> x >> y >> z;
-      cout << oslock << "Translating by "
-           << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
-      translate(x, y, z);
+  if(config.redis) {
+    requestObservation();
+    requestRobotData();
 
-    } else if((cmd == "rotate") || (cmd == "r")) {
+    // Keep the app listed as active
+    io_loop.addTimer(ACTIVE_REFRESH_INTERVAL, [this]() {
+      rdx.command({"SETEX", "iron_dome:active", "2", "1"});
+    });
+  }
 
-      double x, y, z;
-      cin >> x >> y >> z;
-      cout << oslock << "Rotating by XYZ euler angles "
-           << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
-      rotate(x, y, z);
+  if(!checkpoints.isOpen() && !config.checkpoint_file.empty())
+    checkpoints.open(config.checkpoint_file);
+  if(checkpoints.isOpen())
+    io_loop.addTimer(CHECKPOINT_INTERVAL, [this]() { saveCheckpoint(); });
 
-    } else if((cmd == "orientation") || (cmd == "o")) {
+  if(failover.isLeader())
+    io_loop.addTimer(FAILOVER_MIRROR_INTERVAL, [this]() { mirrorState(); });
 
-      double x, y, z;
-      cin >> x >> y >> z;
-      cout << oslock << "Orienting to XYZ euler angles "
-          << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
-      setDesiredOrientation(x, y, z);
+  if(!config.viewer_shm.empty()) {
+    if(viewer_out.create(config.viewer_shm, VIEWER_STATE_LAYOUT)) {
+      io_loop.addTimer(VIEWER_PUBLISH_INTERVAL, [this]() { publishViewerState(); });
+    }
+  }
+}
 
-    } else if((cmd == "quaterion") || (cmd == "q")) {
+void IronDomeApp::requestObservation() {
 
-      double w, x, y, z;
-      cin >> w >> x >> y >> z;
-      cout << oslock << "Orienting to quaternion "
-          << "(" << w << ", " << x << ", " << y << ", " << z << ")" << endl << osunlock;
-      Eigen::Quaterniond quat(w, x, y, z);
-      setDesiredOrientation(quat);
+  rdx_vision.command({"BLPOP", "iron_dome:projectiles", "0"}, [this](redisReply* reply) {
 
-    } else if((cmd == "gains") || (cmd == "g")) {
+    // The connection is gone
+    if(!reply) return;
 
-      double kp_p, kv_p, kp_r, kv_r;
-      cin >> kp_p >> kv_p >> kp_r >> kv_r;
-      cout << oslock << "Setting control gains "
-           << "kp_p = " << kp_p << ", kp_v = " << kv_p
-           << ", kp_r = " << kp_r << ", kv_r = " << kv_r
+    string msg;
+    if(!RedisClient::popValue(reply, msg)) {
+      cerr << oslock << "Error reply for getting projectile observations: "
+           << (reply->type == REDIS_REPLY_ERROR ? reply->str : "unexpected reply")
            << endl << osunlock;
-      setControlGains(kp_p, kv_p, kp_r, kv_r);
+    } else {
+      cout << "Message: " << oslock << msg << endl << osunlock;
+      ingestObservation(msg);
+    }
+
+    // Do another BLPOP until the next observation comes
+    requestObservation();
+  });
+}
+
+void IronDomeApp::requestRobotData() {
+
+  rdx_robot.command({"BLPOP", "iron_dome:robot_data", "0"}, [this](redisReply* reply) {
 
-    } else if((cmd == "friction") || (cmd == "f")) {
+    // The connection is gone
+    if(!reply) return;
 
-      double kv_friction;
-      cin >> kv_friction;
-      cout << oslock << "Setting joint friction kv_friction = " << kv_friction
+    string msg;
+    if(!RedisClient::popValue(reply, msg)) {
+      cerr << oslock << "Error with robot data BLPOP: "
+           << (reply->type == REDIS_REPLY_ERROR ? reply->str : "unexpected reply")
            << endl << osunlock;
-      setJointFrictionDamping(kv_friction);
-
-    } else if((cmd == "activate") || (cmd == "a")) {
-      data_lock.lock();
-      paused = false;
-      data_lock.unlock();
-      cout << oslock << "Starting projecticle defense." << endl << osunlock;
-
-    } else if((cmd == "deactivate") || (cmd == "d")) {
-      data_lock.lock();
-      paused = true;
-      data_lock.unlock();
-      cout << oslock << "Stopping projecticle defense." << endl << osunlock;
-
-    } else if((cmd == "switch") || (cmd == "s")) {
-      data_lock.lock();
-      if(simulation) {
-        simulation = false;
-        q_sensor = q;
-        cout << oslock << "Now controlling physical robot!!" << endl << osunlock;
-      } else {
-        simulation = true;
-        cout << oslock << "Now simulating." << endl << osunlock;
-      }
-      data_lock.unlock();
-
-    } else if((cmd == "joint") || (cmd == "j")) {
-      data_lock.lock();
-      if(joint_space) {
-        joint_space = false;
-        x_d = x_c;
-        cout << oslock << "Now in task-space control." << endl << osunlock;
-      } else {
-        joint_space = true;
-        q_d = q;
-        cout << oslock << "Now in joint-space control." << endl << osunlock;
+    } else {
+      // Read the message into the variables
+      //cout << oslock << msg << endl << osunlock;
+      Eigen::VectorXd q_robot(dof);
+      if(parseJointMessage(msg, q_robot)) {
+        q_robot[3] = -q_robot[3];
+        robot_joints.write(q_robot);
       }
-      data_lock.unlock();
+      metrics.robot_messages.increment();
+    }
+
+    // Look for more data
+    requestRobotData();
+  });
+}
+
+void IronDomeApp::sampleQueueDepths() {
+
+  Gauge* queues[] = {&metrics.queue_projectiles, &metrics.queue_robot_data,
+                     &metrics.queue_robot_commands};
+  const char* queue_keys[] = {"iron_dome:projectiles", "iron_dome:robot_data",
+                              "iron_dome:robot_commands"};
+  for(int i = 0; i < 3; i++) {
+    Gauge* gauge = queues[i];
+    rdx.command({"LLEN", queue_keys[i]}, [gauge](redisReply* reply) {
+      if(RedisClient::ok(reply) && reply->type == REDIS_REPLY_INTEGER) gauge->set(reply->integer);
+    });
+  }
+}
 
-    } else if((cmd == "jmove") || (cmd == "v")) {
-      double q0, q1, q2, q3, q4, q5, q6;
-      cin >> q0 >> q1 >> q2 >> q3 >> q4 >> q5 >> q6;
-      Eigen::VectorXd q_new(dof);
-      q_new << q0, q1, q2, q3, q4, q5, q6;
-      cout << oslock << "Orienting to joint position "
-          << q_new.transpose() << endl << osunlock;
-      setDesiredJointPosition(q_new);
+void IronDomeApp::publishViewerState() {
+
+  SensedState sensed = getSensedState();
+  Setpoints setpoints = getSetpoints();
+  salvo_evaluator.getResult(viewer_salvo);
+  int n = projectile_manager.getConvergedSnapshots(viewer_tracks, MAX_SALVO_TRACKS);
+
+  ViewerState& vs = viewer_state;
+  vs.t = AppClock::now();
+  vs.iter = sensed.iter;
+  strncpy(vs.robot, robot.name.c_str(), sizeof(vs.robot) - 1);
+  vs.robot[sizeof(vs.robot) - 1] = '\0';
+  vs.dof = sensed.q.size();
+  vs.state = setpoints.state;
+  vs.target_id = setpoints.target_id;
+  for(int i = 0; i < vs.dof; i++) vs.q[i] = sensed.q(i);
+  for(int i = 0; i < 3; i++) {
+    vs.x_c[i] = sensed.x_c(i);
+    vs.x_d[i] = setpoints.x_d(i);
+  }
 
-    } else if((cmd == "print") || (cmd == "p")) {
-      printState();
+  vs.num_tracks = n;
+  for(int k = 0; k < n; k++) {
+    const ProjectileSnapshot& s = viewer_tracks[k];
+    const TrackEvaluation* eval = viewer_salvo.find(s.id);
+    ViewerTrack& vt = vs.tracks[k];
+    vt.id = s.id;
+    vt.t = s.t;
+    vt.intersects = eval && eval->intersects;
+    vt.t_intersect = vt.intersects ? eval->t_intersect : -1;
+    for(int i = 0; i < 3; i++) {
+      vt.p[i] = s.p(i);
+      vt.v[i] = s.v(i);
+      vt.a[i] = s.a(i);
+      vt.p_obs[i] = s.pObs(i);
+      vt.collision_pos[i] = vt.intersects ? eval->collision_pos(i) : 0;
+    }
+  }
 
-    } else if((cmd == "help") || (cmd == "h")) {
-      printHelp();
+  viewer_out.write(vs);
+}
 
-    } else if((cmd == "exit") || (cmd == "e")) {
-      finished = true;
+bool IronDomeApp::gatherCheckpoint(AppCheckpoint& c) {
 
-    } else {
-      cout << oslock << "Command not understood!" << endl << osunlock;
-      printHelp();
+  // Until the first control tick there is nothing worth saving, and a
+  // checkpoint not yet resumed from must not be overwritten
+  if(setpoint_buffer.version() < 2) return false;
+
+  // Nor must a primary that was replaced overwrite its successor's
+  if(!active.load(memory_order_relaxed)) return false;
+
+  Setpoints setpoints = getSetpoints();
+  SensedState sensed = getSensedState();
+
+  c.t = AppClock::now();
+  c.wall_ns = wallNanos();
+  strncpy(c.robot, robot.name.c_str(), sizeof(c.robot) - 1);
+  c.robot[sizeof(c.robot) - 1] = '\0';
+
+  c.state = setpoints.state;
+  c.target_id = setpoints.target_id;
+  c.paused = setpoints.paused;
+  c.simulation = setpoints.simulation;
+  c.joint_space = setpoints.joint_space;
+  for(int i = 0; i < 3; i++) {
+    c.x_d[i] = setpoints.x_d(i);
+    for(int j = 0; j < 3; j++) c.R_d[3 * i + j] = setpoints.R_d(i, j);
+  }
+
+  c.dof = sensed.q.size();
+  for(int i = 0; i < c.dof; i++) {
+    c.q_d[i] = (i < setpoints.q_d.size()) ? setpoints.q_d(i) : sensed.q(i);
+    c.q[i] = sensed.q(i);
+    c.dq[i] = sensed.dq(i);
+  }
+
+  c.num_tracks = projectile_manager.getCheckpoints(c.tracks, MAX_SALVO_TRACKS);
+  return true;
+}
+
+void IronDomeApp::saveCheckpoint() {
+  if(gatherCheckpoint(checkpoint)) checkpoints.write(checkpoint);
+}
+
+void IronDomeApp::mirrorState() {
+  if(gatherCheckpoint(checkpoint)) failover.publish(checkpoint);
+}
+
+bool IronDomeApp::restoreCheckpoint() {
+
+  if(!checkpoints.read(checkpoint) || !applyCheckpoint(checkpoint)) return false;
+  rio_graphics.sensors_.q_ = rio.sensors_.q_;
+  return true;
+}
+
+bool IronDomeApp::applyCheckpoint(const AppCheckpoint& c) {
+
+  // Another robot's joints and setpoints mean nothing to this one, even
+  // with as many joints
+  if(strncmp(c.robot, robot.name.c_str(), sizeof(c.robot) - 1) || c.dof != dof) {
+    cout << oslock << "Not resuming from a checkpoint of another robot." << endl << osunlock;
+    return false;
+  }
 
-      // Skip rest of the line
-      cin.ignore(10000, '\n');
+  double age = (wallNanos() - c.wall_ns) * 1e-9;
+  if(age < 0 || age > MAX_CHECKPOINT_AGE) {
+    cout << oslock << "Not resuming from a checkpoint " << age << " s old." << endl << osunlock;
+    return false;
+  }
+
+  // Our clock started over, so move the saved times onto it, as if the
+  // checkpoint had been taken age seconds ago
+  double time_shift = AppClock::now() - age - c.t;
+  projectile_manager.restoreCheckpoints(c.tracks, c.num_tracks, time_shift);
+
+  paused = c.paused;
+  simulation = c.simulation;
+  joint_space = c.joint_space;
+  x_d = Eigen::Map<const Eigen::Vector3d>(c.x_d);
+  R_d = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(c.R_d);
+  for(int i = 0; i < dof; i++) q_d(i) = c.q_d[i];
+
+  // The robot reports its own joints; the simulation has only these
+  if(simulation) {
+    for(int i = 0; i < dof; i++) {
+      rio.sensors_.q_(i) = c.q[i];
+      rio.sensors_.dq_(i) = c.dq[i];
     }
+  }
 
-    // Clear the error flag
-    cin.clear();
+  // Pick the target back up if it is still in flight
+  map<int, Projectile*>& active_projectiles = projectile_manager.getActiveProjectiles();
+  auto it = active_projectiles.find(c.target_id);
+  target = NULL;
+  if(c.state == STATE_TARGETING && it != active_projectiles.end()) {
+    target = it->second;
+    state = STATE_TARGETING;
+  } else {
+    state = (c.state == STATE_PAUSED) ? STATE_PAUSED : STATE_IDLE;
   }
+  replan = true;
+
+  cout << oslock << "Resumed from a checkpoint " << age * 1000 << " ms old with "
+       << c.num_tracks << " tracks" << (target ? ", targeting " + to_string(c.target_id) : "")
+       << "." << endl << osunlock;
+  return true;
 }
 
-void IronDomeApp::robotLoop(){
-
-  rdx_robot.command<vector<string>>({"BLPOP", "iron_dome:robot_data", "0"},
-      [this](redox::Command<vector<string>>& c) {
-
-        if(!c.ok()) {
-          cerr << "Error with robot data BLPOP: " << c.status() << endl;
-        } else {
-          const string& msg = c.reply()[1];
-          stringstream msg_stream(msg);
-          // Read the message into the variables
-          //cout << oslock << msg << endl << osunlock;
-          data_lock.lock();
-          msg_stream >> q_sensor[0] >> q_sensor[1] >> q_sensor[2] >> q_sensor[3]
-              >> q_sensor[4] >> q_sensor[5] >> q_sensor[6];
-          q_sensor[3] = -q_sensor[3];
-          data_lock.unlock();
-        }
+void IronDomeApp::standDown() {
 
-        // Look for more data
-        this->robotLoop();
-      }
-  );
+  active.store(false, memory_order_relaxed);
+  cout << oslock << "Process " << failover.getLeaderPid()
+       << " took over command publication; stopping." << endl << osunlock;
+
+  // BLPOPs issued before the stall are first in line for the next
+  // observation and robot joints, which belong to the new leader now
+  io_loop.post([this]() {
+    rdx_vision.disconnect();
+    rdx_robot.disconnect();
+  });
+  stop();
+}
+
+void IronDomeApp::takeOver() {
+
+  int pid = failover.getLeaderPid();
+  if(!failover.takeOver()) return; // Another standby did
+
+  cout << oslock << "Process " << pid << " stopped beating; taking over." << endl << osunlock;
+  if(!failover.read(failover_state) || !applyCheckpoint(failover_state))
+    cout << oslock << "No state to resume from; starting over." << endl << osunlock;
+
+  active.store(true, memory_order_relaxed);
+  io_loop.post([this]() { startPublishing(); });
+}
+
+void IronDomeApp::readShellInput() {
+
+  // The loop only calls this when stdin is readable, so this never blocks
+  char buf[SHELL_READ_SIZE];
+  ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+  if(n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+  if(n <= 0) {
+    // End of input, e.g. when not run from a terminal
+    io_loop.setEnabled(shell_watcher, false);
+    return;
+  }
+
+  shell_input.append(buf, n);
+  size_t end;
+  while((end = shell_input.find('\n')) != string::npos) {
+    string line = shell_input.substr(0, end);
+    shell_input.erase(0, end + 1);
+    runShellCommand(line);
+
+    // The dashboard prompts again once it gives stdin back
+    if(!stop_token.stopRequested() && io_loop.isEnabled(shell_watcher))
+      cout << oslock << ">> " << flush << osunlock;
+  }
+}
+
+void IronDomeApp::runShellCommand(const string& line) {
+
+  istringstream in(line);
+  string cmd;
+  if(!(in >> cmd)) return;
+
+  if((cmd == "move") || (cmd == "m")) {
+
+    double x, y, z;
+    in >> x >> y >> z;
+    cout << oslock << "Moving to "
+        << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
+    setDesiredPosition(x, y, z);
+
+  } else if((cmd == "translate") || (cmd == "t")) {
+
+    double x, y, z;
+    in >> x >> y >> z;
+    cout << oslock << "Translating by "
+         << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
+    translate(x, y, z);
+
+  } else if((cmd == "rotate") || (cmd == "r")) {
+
+    double x, y, z;
+    in >> x >> y >> z;
+    cout << oslock << "Rotating by XYZ euler angles "
+         << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
+    rotate(x, y, z);
+
+  } else if((cmd == "orientation") || (cmd == "o")) {
+
+    double x, y, z;
+    in >> x >> y >> z;
+    cout << oslock << "Orienting to XYZ euler angles "
+        << "(" << x << ", " << y << ", " << z << ")" << endl << osunlock;
+    setDesiredOrientation(x, y, z);
+
+  } else if((cmd == "quaterion") || (cmd == "q")) {
+
+    double w, x, y, z;
+    in >> w >> x >> y >> z;
+    cout << oslock << "Orienting to quaternion "
+        << "(" << w << ", " << x << ", " << y << ", " << z << ")" << endl << osunlock;
+    Eigen::Quaterniond quat(w, x, y, z);
+    setDesiredOrientation(quat);
+
+  } else if((cmd == "gains") || (cmd == "g")) {
+
+    double kp_p, kv_p, kp_r, kv_r;
+    in >> kp_p >> kv_p >> kp_r >> kv_r;
+    cout << oslock << "Setting control gains "
+         << "kp_p = " << kp_p << ", kp_v = " << kv_p
+         << ", kp_r = " << kp_r << ", kv_r = " << kv_r
+         << endl << osunlock;
+    setControlGains(kp_p, kv_p, kp_r, kv_r);
+
+  } else if((cmd == "friction") || (cmd == "f")) {
+
+    double kv_friction;
+    in >> kv_friction;
+    cout << oslock << "Setting joint friction kv_friction = " << kv_friction
+         << endl << osunlock;
+    setJointFrictionDamping(kv_friction);
+
+  } else if((cmd == "activate") || (cmd == "a")) {
+    setPaused(false);
+    cout << oslock << "Starting projecticle defense." << endl << osunlock;
+
+  } else if((cmd == "deactivate") || (cmd == "d")) {
+    setPaused(true);
+    cout << oslock << "Stopping projecticle defense." << endl << osunlock;
+
+  } else if((cmd == "switch") || (cmd == "s")) {
+    ControlCommand switch_cmd(ControlCommand::SIMULATION);
+    switch_cmd.flag = !getSetpoints().simulation;
+    postCommand(switch_cmd);
+
+    if(!switch_cmd.flag) {
+      cout << oslock << "Now controlling physical robot!!" << endl << osunlock;
+    } else {
+      cout << oslock << "Now simulating." << endl << osunlock;
+    }
+
+  } else if((cmd == "joint") || (cmd == "j")) {
+    ControlCommand joint_cmd(ControlCommand::JOINT_SPACE);
+    joint_cmd.flag = !getSetpoints().joint_space;
+    postCommand(joint_cmd);
+
+    if(!joint_cmd.flag) {
+      cout << oslock << "Now in task-space control." << endl << osunlock;
+    } else {
+      cout << oslock << "Now in joint-space control." << endl << osunlock;
+    }
+
+  } else if((cmd == "jmove") || (cmd == "v")) {
+    double q0, q1, q2, q3, q4, q5, q6;
+    in >> q0 >> q1 >> q2 >> q3 >> q4 >> q5 >> q6;
+    Eigen::VectorXd q_new(dof);
+    q_new << q0, q1, q2, q3, q4, q5, q6;
+    cout << oslock << "Orienting to joint position "
+        << q_new.transpose() << endl << osunlock;
+    setDesiredJointPosition(q_new);
+
+  } else if((cmd == "print") || (cmd == "p")) {
+    printState();
+
+  } else if((cmd == "locks") || (cmd == "l")) {
+
+    string arg;
+    in >> arg;
+
+    if(arg == "on") {
+      ProfiledMutex::setEnabled(true);
+      cout << oslock << "Lock profiling enabled." << endl << osunlock;
+    } else if(arg == "off") {
+      ProfiledMutex::setEnabled(false);
+      cout << oslock << "Lock profiling disabled." << endl << osunlock;
+    } else if(arg == "reset") {
+      ProfiledMutex::reset();
+      cout << oslock << "Lock statistics cleared." << endl << osunlock;
+    } else {
+      cout << oslock;
+      ProfiledMutex::report(cout);
+      cout << endl << osunlock;
+    }
+
+  } else if((cmd == "allocs") || (cmd == "c")) {
+
+    string arg;
+    in >> arg;
+
+    if(!AllocationTracker::isAvailable()) {
+      cout << oslock;
+      AllocationTracker::report(cout);
+      cout << osunlock;
+    } else if(arg == "off") {
+      AllocationTracker::setMode(AllocationTracker::MODE_OFF);
+      cout << oslock << "Allocation tracking disabled." << endl << osunlock;
+    } else if(arg == "count") {
+      AllocationTracker::setMode(AllocationTracker::MODE_COUNT);
+      cout << oslock << "Counting allocations." << endl << osunlock;
+    } else if(arg == "assert") {
+      AllocationTracker::setMode(AllocationTracker::MODE_ASSERT);
+      cout << oslock << "Aborting on real-time allocations." << endl << osunlock;
+    } else if(arg == "reset") {
+      AllocationTracker::reset();
+      cout << oslock << "Allocation counters cleared." << endl << osunlock;
+    } else {
+      cout << oslock;
+      AllocationTracker::report(cout);
+      cout << endl << osunlock;
+    }
+
+  } else if((cmd == "dashboard") || (cmd == "b")) {
+    // The dashboard reads the terminal until 'q' or a stop, so hand it
+    // stdin and keep the I/O loop serving Redis in the meantime. Any
+    // earlier dashboard gave stdin back to get here, so it has returned.
+    joinDashboard();
+    io_loop.setEnabled(shell_watcher, false);
+    lock_guard<mutex> lock(dashboard_lock);
+    dashboard_thread = thread([this]() {
+      ThreadSpec("dashboard").applyToThisThread();
+      Dashboard dashboard(projectile_manager, robot.collision_sphere_pos, robot.collision_sphere_radius);
+      dashboard.run(stop_token);
+      if(stop_token.stopRequested()) return;
+      io_loop.post([this]() {
+        io_loop.setEnabled(shell_watcher, true);
+        cout << oslock << ">> " << flush << osunlock;
+      });
+    });
+
+  } else if((cmd == "profile") || (cmd == "i")) {
+
+    string arg;
+    in >> arg;
+
+    if(arg == "start") {
+      int hz, max_samples;
+      if(!(in >> hz)) hz = DEFAULT_PROFILE_HZ;
+      if(!(in >> max_samples)) max_samples = SamplingProfiler::DEFAULT_MAX_SAMPLES;
+      if(SamplingProfiler::start(hz, max_samples))
+        cout << oslock << "Sampling at " << hz << " Hz, up to " << max_samples
+             << " samples." << endl << osunlock;
+      else
+        cout << oslock << "Could not start the profiler." << endl << osunlock;
+
+    } else if(arg == "stop") {
+      SamplingProfiler::stop();
+      cout << oslock << "Stopped profiling with " << SamplingProfiler::numSamples()
+           << " samples (" << SamplingProfiler::numDropped() << " dropped)."
+           << endl << osunlock;
+
+    } else if(arg == "dump") {
+      string filename;
+      if(!(in >> filename)) filename = DEFAULT_PROFILE_FILE;
+      ofstream out(filename);
+      SamplingProfiler::writeFolded(out);
+      cout << oslock << "Wrote " << SamplingProfiler::numSamples()
+           << " samples to " << filename << "." << endl << osunlock;
+
+    } else {
+      cout << oslock << "Usage: profile start [hz [samples]] | stop | dump [file]" << endl << osunlock;
+    }
+
+  } else if((cmd == "help") || (cmd == "h")) {
+    printHelp();
+
+  } else if((cmd == "exit") || (cmd == "e")) {
+    stop_token.requestStop();
+
+  } else {
+    cout << oslock << "Command not understood!" << endl << osunlock;
+    printHelp();
+  }
 }
 
 bool IronDomeApp::testJointLimit(int joint_num){
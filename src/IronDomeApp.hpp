@@ -8,8 +8,13 @@
 #pragma once
 
 #include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <fstream>
 #include <Eigen/Dense>
-#include "redox.hpp"
 
 #include <scl/DataTypes.hpp>
 #include <scl/data_structs/SGcModel.hpp>
@@ -22,13 +27,97 @@
 
 #include <GL/freeglut.h>
 
+#include "RobotProfile.hpp"
+#include "RobotState.hpp"
+#include "calibration/FrameCalibration.hpp"
+#include "ControlCommand.hpp"
+#include "checkpoint/CheckpointFile.hpp"
+#include "concurrency/DoubleBuffer.hpp"
+#include "concurrency/EventNotifier.hpp"
+#include "concurrency/Mailbox.hpp"
+#include "concurrency/TaskPool.hpp"
+#include "concurrency/ThreadSupervisor.hpp"
+#include "io/EventLoop.hpp"
+#include "io/RedisClient.hpp"
+#include "ipc/FailoverLink.hpp"
+#include "ipc/SharedSnapshot.hpp"
+#include "ipc/ViewerState.hpp"
 #include "projectile/projectile.hpp"
+#include "projectile/SalvoEvaluator.hpp"
+#include "profiling/ProfiledMutex.hpp"
+#include "metrics/AppMetrics.hpp"
+
+/**
+* Which subsystems an IronDomeApp brings up.
+*/
+class IronDomeConfig {
+public:
+  IronDomeConfig() : graphics(true), redis(true), shell(true), standby(false), robot("iiwa"),
+      controller("incremental"), task_workers(2) {}
+
+  bool graphics; // Open a window and render the scene
+  bool redis;    // Connect to Redis for vision, robot and publishing
+  bool shell;    // Read shell commands from stdin
+
+  // Shared memory object to publish a ViewerState to, or empty for none
+  std::string viewer_shm;
+
+  // File to checkpoint to and resume from, or empty for none
+  std::string checkpoint_file;
+
+  // Shared memory object to mirror state to for a standby, or empty for
+  // none. With standby set, this instance is that standby instead: it
+  // publishes nothing until the primary stops beating, then takes over.
+  std::string failover_shm;
+  bool standby;
+
+  // Transform of observations from the vision sensor's frame to the
+  // robot's, written by the calibrate tool, or empty if the vision side
+  // already sends robot frame points
+  std::string calibration_file;
+
+  std::string robot;      // Name of a RobotProfile
+  std::string controller; // One of IronDomeApp::getControllerNames()
+
+  int task_workers;           // Workers evaluating tracks, 0 for none
+  std::vector<int> task_cpus; // CPUs to pin them to, empty for any
+};
+
+/**
+* Timestamps of the app's reaction to a new target, for measuring
+* end-to-end latency. Times are steady_clock nanoseconds since epoch.
+*/
+class ReactionProbe {
+public:
+  ReactionProbe() : selected_id(-1), selected_ns(0), setpoint_id(-1), setpoint_ns(0) {}
+
+  std::atomic<int> selected_id;      // Last projectile the state machine selected
+  std::atomic<int64_t> selected_ns;  // When it was selected
+  std::atomic<int> setpoint_id;      // Last projectile x_d was aimed at
+  std::atomic<int64_t> setpoint_ns;  // When x_d first reflected its intercept
+};
 
 class IronDomeApp {
 
+// Benchmarks drive the private control stages directly
+friend class IronDomeAppBench;
+
 public:
   IronDomeApp();
 
+  /**
+  * Bring up only the subsystems enabled in config. An app without
+  * graphics and Redis can still run the control loop and accept
+  * observations through ingestObservation(), which is what benchmarks
+  * and offline tools use.
+  */
+  explicit IronDomeApp(const IronDomeConfig& config);
+
+  /**
+  * Stops and joins the dashboard if it is open.
+  */
+  ~IronDomeApp();
+
   /**
   * Loop to continuously update controls.
   * Call from a separate thread.
@@ -42,27 +131,32 @@ public:
   void graphicsLoop();
 
   /**
-  * Loop to continuously receive projectile position measurements
-  * and update trajectory estimates of them.
+  * Loop for all non-real-time I/O: receiving projectile observations
+  * and robot joint positions from Redis, sending robot commands and
+  * published state to it, reading shell commands and running timers.
   * Call from a separate thread.
   */
-  void visionLoop();
+  void ioLoop();
 
   /**
-  * Loop to continuously send desired robot joint positions
-  * and get actual robot joint positions back
+  * Loop to evaluate intercepts whenever a track changes, sleeping in
+  * between. While it runs, the control loop only picks up its results;
+  * without it, the control loop evaluates changed tracks itself.
   * Call from a separate thread.
   */
-  void robotLoop();
+  void plannerLoop();
 
   /**
-  * Loop to continuously get user input.
-  * Call from a separate thread.
+  * Post a command to the control loop. It is stamped with the next
+  * sequence number and the current time, and applied at the start of
+  * the next control tick, together with any others waiting. Safe to
+  * call from any thread; never blocks. Returns false if the mailbox is
+  * full and the command was dropped.
   */
-  void shellLoop();
+  bool postCommand(ControlCommand cmd);
 
   /**
-  * Command the robot to a desired state.
+  * Command the robot to a desired state. These post commands.
   */
   void setDesiredPosition(const Eigen::Vector3d& pos);
   void setDesiredPosition(double x, double y, double z);
@@ -83,17 +177,164 @@ public:
   void setControlGains(double kp_p, double kv_p, double kp_r, double kv_r);
   void setJointFrictionDamping(double kv_friction);
 
+  /**
+  * Parse an observation message ("id t x y z") and add it to its
+  * projectile's track. This is the ingest path used for observations
+  * from Redis.
+  * Returns false if the message is malformed.
+  */
+  bool ingestObservation(const std::string& msg);
+
   void printState();
 
+  /**
+  * Latest published snapshots of the control loop's state. Never
+  * block the control loop.
+  */
+  SensedState getSensedState() const { return sensed_buffer.read(); }
+  Setpoints getSetpoints() const { return setpoint_buffer.read(); }
+  ControllerOutput getControllerOutput() const { return output_buffer.read(); }
+  Diagnostics getDiagnostics() const { return diagnostics_buffer.read(); }
+
+  /**
+  * Whether interception is paused, as of the last control tick.
+  */
   bool isPaused();
+  void setPaused(bool paused);
+
+  /**
+  * Ask all loops to finish, and wait for the dashboard to give the
+  * terminal back.
+  */
+  void stop();
+
+  /**
+  * Set when the app should shut down, by stop(), the shell's exit
+  * command or closing the window. Loops started by a ThreadSupervisor
+  * share it.
+  */
+  StopToken& getStopToken() { return stop_token; }
+
+  const ReactionProbe& getReactionProbe() const { return reaction_probe; }
+
+  /**
+  * Controllers that IronDomeConfig::controller can name. "joint" stays
+  * in joint space; the others are task-space controllers used whenever
+  * the state machine is not holding the ready pose in joint space.
+  */
+  static std::vector<std::string> getControllerNames();
+
+  /**
+  * Seconds between control ticks, which the simulation integrates over.
+  */
+  static double getControlPeriod();
 
 private:
 
+  /**
+  * One iteration of the control loop: update the state, run the state
+  * machine and the controller, and integrate. Does not sleep.
+  */
+  void controlTick();
+
+  /**
+  * Startup steps: connect to Redis and register the app, and publish
+  * the robot spec and graphics. Only run with Redis enabled.
+  */
+  void connectRedis();
+  void publishModel();
+
+  /**
+  * Pop the next observation or robot joint message from Redis, and
+  * again each time one arrives. Call from the I/O loop.
+  */
+  void requestObservation();
+  void requestRobotData();
+
+  /**
+  * Read what stdin has and run each complete line as a shell command.
+  * Call from the I/O loop.
+  */
+  void readShellInput();
+  void runShellCommand(const std::string& line);
+
+  /**
+  * Sample the lengths of the Redis queues into the metrics.
+  */
+  void sampleQueueDepths();
+
+  /**
+  * Publish the robot and track state for viewer processes. Call from
+  * the I/O loop.
+  */
+  void publishViewerState();
+
+  /**
+  * Save the tracks and the controller's mode and setpoints to the
+  * checkpoint file. Call from the I/O loop.
+  */
+  void saveCheckpoint();
+
+  /**
+  * Resume from the checkpoint file if it holds a recent checkpoint of
+  * the same robot. Call from the constructor. Returns whether it did.
+  */
+  bool restoreCheckpoint();
+
+  /**
+  * Gather the tracks and the controller's mode and setpoints into c.
+  * Returns false before the first control tick, when there is nothing
+  * worth saving. Call from the I/O loop.
+  */
+  bool gatherCheckpoint(AppCheckpoint& c);
+
+  /**
+  * Resume from c if it is a recent checkpoint of the same robot. Call
+  * from the constructor or the control loop. Returns whether it did.
+  */
+  bool applyCheckpoint(const AppCheckpoint& c);
+
+  /**
+  * Mirror the state for standbys. Call from the I/O loop.
+  */
+  void mirrorState();
+
+  /**
+  * Take over from a primary that stopped beating, resuming from its
+  * mirrored state. Call from the control loop.
+  */
+  void takeOver();
+
+  /**
+  * Stop publishing anything and shut down, once another instance has
+  * taken over from this one. Call from the control loop.
+  */
+  void standDown();
+
+  /**
+  * Start the I/O only the instance publishing commands does: consuming
+  * observations and robot joints, staying listed as active, saving
+  * checkpoints and publishing to viewers and standbys. Call from the
+  * I/O loop.
+  */
+  void startPublishing();
+
+  /**
+  * Apply the commands waiting in the mailbox.
+  */
+  void applyCommands();
+  void applyCommand(const ControlCommand& cmd);
+
   /**
   * Update the member variables to reflect the state of the robot.
   */
   void updateState();
 
+  /**
+  * Publish this tick's state to the snapshot buffers.
+  */
+  void publishState();
+
   /**
   * Compute torque based on 6DOF task space PD control from the
   * position and velocity error vectors.
@@ -145,9 +386,38 @@ private:
   */
   void applyJointLimitPotential();
 
-  redox::Redox rdx;                // Communication via Redis
-  redox::Redox rdx_robot;          // Communication via Redis
-  redox::Redox rdx_vision;         // Communication via Redis
+  EventLoop io_loop;       // All Redis, shell and timer I/O, run by ioLoop
+  RedisClient rdx;         // Commands and published state
+  RedisClient rdx_robot;   // Blocking reads of robot joint positions
+  RedisClient rdx_vision;  // Blocking reads of projectile observations
+
+  // Shell input not yet ending in a newline, and its watcher
+  std::string shell_input;
+  int shell_watcher;
+
+  // Dashboard holding stdin while open, joined before the app goes away
+  std::thread dashboard_thread;
+  std::mutex dashboard_lock; // Guards dashboard_thread
+  void joinDashboard();
+
+  // State published to viewers, and the buffers it is gathered in
+  SharedSnapshot<ViewerState> viewer_out;
+  ViewerState viewer_state;
+  ProjectileSnapshot viewer_tracks[MAX_SALVO_TRACKS];
+  SalvoResult viewer_salvo;
+
+  // Checkpoints of the engagement, and the one being saved or restored
+  CheckpointFile checkpoints;
+  AppCheckpoint checkpoint;
+
+  // Link to the primary or standby instances, and the mirrored state a
+  // standby takes over from, owned by the control loop
+  FailoverLink failover;
+  AppCheckpoint failover_state;
+
+  // Whether this instance publishes commands, rather than standing by
+  std::atomic<bool> active;
+  bool publishing; // Whether startPublishing has run, owned by the I/O loop
 
   scl::SRobotParsed rds;     // Robot data structure
   scl::SGraphicsParsed rgr;  // Robot graphics data structure
@@ -161,14 +431,30 @@ private:
   scl::SGraphicsChai* graphics;
   chai3d::cWorld* chai_world;
 
-  std::mutex data_lock; // Mutex that assures thread safety to data resources
+  // Everything below is owned by the control loop unless noted. Other
+  // threads see it only through these snapshots.
+  DoubleBuffer<SensedState> sensed_buffer;
+  DoubleBuffer<Setpoints> setpoint_buffer;
+  DoubleBuffer<ControllerOutput> output_buffer;
+  DoubleBuffer<Diagnostics> diagnostics_buffer;
+
+  // Requests to the control loop, from any thread
+  Mailbox<ControlCommand, COMMAND_MAILBOX_SIZE> commands;
+  std::atomic<uint64_t> next_command_seq;
+  uint64_t applied_command_seq; // Last command applied
+
+  // Joint positions from the physical robot, written by the I/O loop
+  DoubleBuffer<JointVector> robot_joints;
+
+  // Copy of rio for rendering and publishing, owned by graphicsLoop
+  scl::SRobotIO rio_graphics;
 
   double t; // Run-time of program
   double t_sim; // Simulated time
   double dt_real, dt_sim; // Actual and simulated time between frames
 
   long iter; // Number of frames
-  bool finished; // Flag to shut down
+  StopToken stop_token; // Shared by all loops to shut down
 
   scl::SRigidBodyDyn* ee; // End effector link
   const Eigen::Vector3d op_pos; // Position of operational poin w.r.t. end-effector
@@ -199,15 +485,32 @@ private:
 
   Eigen::VectorXd kp_q, kv_q; // Gains in joint space control
 
-  Eigen::VectorXd q_sensor; // Joint position read from actual robot
+  JointVector q_sensor; // Joint position read from actual robot
 
   Eigen::Vector3d x_inc; // Incremental position towards goal
 
   Eigen::VectorXd ready_pos_joint; // Ready position, in joint space
 
+  // Signaled by projectile_manager whenever a track changes
+  EventNotifier track_updates;
+
   // Class for managing the current state of projectiles
   ProjectileManager projectile_manager;
 
+  // Moves observations into the robot's frame, if calibration_file is set
+  FrameCalibration calibration;
+
+  // Evaluates every track's intercept on the pool's workers
+  TaskPool task_pool;
+  SalvoEvaluator salvo_evaluator;
+  std::atomic<bool> planner_running; // Whether plannerLoop is evaluating
+  SalvoResult salvo;          // Latest evaluation, owned by the control loop
+  uint64_t salvo_count;       // salvo_evaluator.getResultCount() of salvo
+  SalvoResult graphics_salvo; // Latest evaluation, owned by graphicsLoop
+
+  // Whether target selection should run on the next idle tick
+  bool replan;
+
   // State of the robot
   int state;
 
@@ -222,4 +525,26 @@ private:
 
   // Whether we are controlling in joint space or task space
   bool joint_space;
+
+  // Enabled subsystems
+  IronDomeConfig config;
+
+  // Robot-specific poses and interception sphere
+  const RobotProfile robot;
+
+  // Controller selected by config, one of the CONTROLLER_* constants
+  int controller;
+
+  // Reaction timestamps for latency measurement
+  ReactionProbe reaction_probe;
+
+  // Exported loop, tracking and transport metrics
+  AppMetrics metrics;
+
+  // Observations and commands received, for replay (IRON_DOME_RECORD_SESSION)
+  std::ofstream session_log;
+  std::mutex session_lock;
+
+  // Start of the previous control tick, for measuring the loop period
+  std::chrono::steady_clock::time_point last_tick_start;
 };
@@ -0,0 +1,31 @@
+/**
+* MessageParsing.cpp
+* ------------------
+* Implementation of the message parsers.
+*/
+
+#include <sstream>
+
+#include "MessageParsing.hpp"
+
+using namespace std;
+
+bool parseObservationMessage(const string& msg, ObservationMessage& obs) {
+  stringstream msg_stream(msg);
+  msg_stream >> obs.id >> obs.t >> obs.x >> obs.y >> obs.z;
+  return !msg_stream.fail();
+}
+
+string formatObservationMessage(const ObservationMessage& obs) {
+  stringstream ss;
+  ss.precision(17);
+  ss << obs.id << " " << obs.t << " " << obs.x << " " << obs.y << " " << obs.z;
+  return ss.str();
+}
+
+bool parseJointMessage(const string& msg, Eigen::VectorXd& q) {
+  stringstream msg_stream(msg);
+  for(int i = 0; i < q.size(); i++)
+    msg_stream >> q[i];
+  return !msg_stream.fail();
+}
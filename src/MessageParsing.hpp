@@ -0,0 +1,39 @@
+/**
+* MessageParsing.hpp
+* ------------------
+* Parsers for the text messages exchanged with the vision system and the
+* robot over Redis.
+*/
+
+#pragma once
+
+#include <string>
+#include <Eigen/Dense>
+
+/**
+* One projectile observation: "id t x y z".
+*/
+class ObservationMessage {
+public:
+  int id;         // Unique ID number of projectile
+  double t;       // Timestamp, in the sender's clock
+  double x, y, z; // Measured position
+};
+
+/**
+* Parse a projectile observation. Returns false if the message is
+* malformed.
+*/
+bool parseObservationMessage(const std::string& msg, ObservationMessage& obs);
+
+/**
+* Text form of an observation, without a trailing newline. Precise
+* enough to parse back to the same values.
+*/
+std::string formatObservationMessage(const ObservationMessage& obs);
+
+/**
+* Parse a robot joint position message, "q0 q1 ... qn", into q.
+* Reads q.size() values. Returns false if the message is malformed.
+*/
+bool parseJointMessage(const std::string& msg, Eigen::VectorXd& q);
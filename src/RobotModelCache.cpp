@@ -0,0 +1,216 @@
+/**
+* RobotModelCache.cpp
+* -------------------
+* Implementation of the RobotModelCache class.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RobotModelCache.hpp"
+
+using namespace std;
+
+// Where entries are kept, relative to the working directory
+static const string CACHE_DIR = ".iron_dome_cache/";
+
+// Bump whenever the entry layout or the serialized JSON changes
+static const uint32_t CACHE_MAGIC = 0x49444d43; // "IDMC"
+static const uint32_t CACHE_LAYOUT = 1;
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+/**
+* Start of an entry, followed by the spec then the graphics JSON.
+*/
+class CacheHeader {
+public:
+  uint32_t magic;
+  uint32_t layout;
+  uint64_t key;
+  uint64_t spec_size;
+  uint64_t graphics_size;
+};
+
+static uint64_t fnv1a(uint64_t h, const char* data, size_t size) {
+  for(size_t i = 0; i < size; i++) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= FNV_PRIME;
+  }
+  return h;
+}
+
+static bool readFile(const string& path, string& contents) {
+  ifstream in(path, ios::binary);
+  if(!in) return false;
+  contents.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  return true;
+}
+
+/**
+* Trimmed text of every <tag> element in xml. Commented-out elements are
+* found too, which only makes the key depend on a little more.
+*/
+static vector<string> elementTexts(const string& xml, const string& tag) {
+
+  vector<string> texts;
+  string open = "<" + tag + ">", close = "</" + tag + ">";
+  size_t pos = 0;
+  while((pos = xml.find(open, pos)) != string::npos) {
+    pos += open.size();
+    size_t end = xml.find(close, pos);
+    if(end == string::npos) break;
+    string text = xml.substr(pos, end - pos);
+    size_t first = text.find_first_not_of(" \t\r\n");
+    size_t last = text.find_last_not_of(" \t\r\n");
+    if(first != string::npos) texts.push_back(text.substr(first, last - first + 1));
+    pos = end + close.size();
+  }
+  return texts;
+}
+
+/**
+* Materials an obj file names, relative to its directory.
+*/
+static vector<string> objMaterials(const string& obj_path, const string& obj) {
+
+  vector<string> materials;
+  size_t slash = obj_path.rfind('/');
+  string dir = (slash == string::npos) ? "" : obj_path.substr(0, slash + 1);
+
+  stringstream lines(obj);
+  string line, word;
+  while(getline(lines, line)) {
+    stringstream ss(line);
+    if(!(ss >> word) || word != "mtllib") continue;
+    while(ss >> word) materials.push_back(dir + word);
+  }
+  return materials;
+}
+
+static bool endsWith(const string& s, const string& suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+RobotModelCache::RobotModelCache(const RobotProfile& profile, bool with_graphics) :
+    profile(profile), with_graphics(with_graphics),
+    path(CACHE_DIR + profile.name + (with_graphics ? "" : "-nographics") + ".bin") {
+  key = computeKey();
+}
+
+uint64_t RobotModelCache::computeKey() const {
+
+  // Every file the parse reads, in the order they are found
+  vector<string> files = {profile.config_file};
+  set<string> seen(files.begin(), files.end());
+  auto add = [&](const string& path) {
+    if(seen.insert(path).second) files.push_back(path);
+  };
+
+  uint64_t h = FNV_OFFSET;
+  for(size_t i = 0; i < files.size(); i++) {
+
+    // A file that is missing hashes differently from any contents; only
+    // the spec file itself is required
+    string contents;
+    bool found = readFile(files[i], contents);
+    if(!found && i == 0) return 0;
+
+    h = fnv1a(h, files[i].c_str(), files[i].size() + 1);
+    char marker = found;
+    h = fnv1a(h, &marker, 1);
+    h = fnv1a(h, contents.data(), contents.size());
+    if(!found) continue;
+
+    if(endsWith(files[i], ".obj")) {
+      for(const string& mtl : objMaterials(files[i], contents)) add(mtl);
+      continue;
+    }
+
+    // Includes are relative to the working directory, meshes to the spec
+    // directory, as the parser resolves them
+    for(const string& include : elementTexts(contents, "file")) add(include);
+    if(with_graphics) {
+      for(const string& obj_file : elementTexts(contents, "obj_file"))
+        for(const string& mesh : elementTexts(obj_file, "name")) add(profile.spec_dir + mesh);
+    }
+  }
+
+  for(const string* s : {&profile.robot_name, &profile.graphics_name}) {
+    h = fnv1a(h, s->c_str(), s->size() + 1);
+  }
+  char g = with_graphics;
+  h = fnv1a(h, &g, 1);
+
+  // Keep 0 free to mean "no key"
+  return h ? h : 1;
+}
+
+bool RobotModelCache::load() {
+
+  if(!key) return false;
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+
+  struct stat st;
+  if(fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(CacheHeader)) {
+    close(fd);
+    return false;
+  }
+
+  void* mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mem == MAP_FAILED) return false;
+
+  CacheHeader header;
+  memcpy(&header, mem, sizeof(header));
+  bool valid = header.magic == CACHE_MAGIC && header.layout == CACHE_LAYOUT
+      && header.key == key
+      && sizeof(header) + header.spec_size + header.graphics_size == (uint64_t)st.st_size;
+  if(valid) {
+    const char* data = static_cast<const char*>(mem) + sizeof(header);
+    spec_json.assign(data, header.spec_size);
+    graphics_json.assign(data + header.spec_size, header.graphics_size);
+  }
+
+  munmap(mem, st.st_size);
+  return valid;
+}
+
+bool RobotModelCache::store() const {
+
+  if(!key) return false;
+  mkdir(CACHE_DIR.c_str(), 0755);
+
+  CacheHeader header;
+  header.magic = CACHE_MAGIC;
+  header.layout = CACHE_LAYOUT;
+  header.key = key;
+  header.spec_size = spec_json.size();
+  header.graphics_size = graphics_json.size();
+
+  // Write aside and rename, so a reader never maps a half-written entry
+  string tmp_path = path + ".tmp";
+  {
+    ofstream out(tmp_path, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(spec_json.data(), spec_json.size());
+    out.write(graphics_json.data(), graphics_json.size());
+    if(!out) {
+      unlink(tmp_path.c_str());
+      return false;
+    }
+  }
+  return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,66 @@
+/**
+* RobotModelCache.hpp
+* -------------------
+* On-disk cache of the JSON the app publishes for its robot spec and
+* graphics, so a restart does not serialize the parsed model again.
+* Entries are keyed by a hash of every file the parse reads and the
+* names read from them, and are mapped into memory when loaded.
+*
+*   RobotModelCache cache(profile, with_graphics);
+*   if(!cache.load()) {
+*     cache.spec_json = ...;
+*     cache.graphics_json = ...;
+*     cache.store();
+*   }
+*
+* A stale or corrupt entry is just a miss. The key follows the spec's
+* <file> includes and, with graphics, the <obj_file> meshes and the
+* mtllib materials they name. Textures the materials name are not
+* hashed; after changing only those, delete .iron_dome_cache/.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "RobotProfile.hpp"
+
+class RobotModelCache {
+
+public:
+
+  /**
+  * with_graphics says whether the graphics were parsed, since the
+  * graphics JSON differs without them.
+  */
+  RobotModelCache(const RobotProfile& profile, bool with_graphics);
+
+  /**
+  * Fill spec_json and graphics_json from the cache. Returns false if
+  * there is no entry for the current spec file.
+  */
+  bool load();
+
+  /**
+  * Save spec_json and graphics_json for the current spec file. Returns
+  * false if the entry could not be written.
+  */
+  bool store() const;
+
+  std::string spec_json;
+  std::string graphics_json;
+
+private:
+
+  /**
+  * FNV-1a hash of the spec file, the files it pulls in, the profile's
+  * names and with_graphics, or 0 if the spec file cannot be read.
+  */
+  uint64_t computeKey() const;
+
+  const RobotProfile& profile;
+  bool with_graphics;
+  std::string path;
+  uint64_t key;
+};
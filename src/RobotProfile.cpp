@@ -0,0 +1,76 @@
+/**
+* RobotProfile.cpp
+* ----------------
+* The known robot profiles.
+*/
+
+#include <stdexcept>
+
+#include "RobotProfile.hpp"
+
+using namespace std;
+
+static vector<RobotProfile> makeProfiles() {
+
+  vector<RobotProfile> profiles;
+  RobotProfile p;
+
+  p.name = "iiwa";
+  p.robot_name = "iiwaBot";
+  p.graphics_name = "iiwaBotStdView";
+  p.config_file = "./specs/iiwa/iiwaCfg.xml";
+  p.spec_dir = "./specs/";
+  p.start_position << 0.6, 0, 0.58;
+  p.start_rotation << -1, 0, 0, 0, 1, 0, 0, 0, -1;
+  p.ready_position << 0.556, 0, 1.076;
+  p.ready_joint_positions = {0, 1.5, 0, -1.6, 0, .85, 0};
+  p.collision_sphere_pos << -.4, 0, 0.1;
+  p.collision_sphere_radius = 1.50;
+  profiles.push_back(p);
+
+  p.name = "kuka";
+  p.robot_name = "KukaBot";
+  p.graphics_name = "KukaBotStdView";
+  p.config_file = "./specs/Kuka/KukaCfg.xml";
+  p.spec_dir = "./specs/";
+  p.start_position << 0, 0, 0;
+  p.start_rotation = Eigen::Quaterniond(1, 0, 1, 0).normalized().toRotationMatrix();
+  p.ready_position = p.start_position;
+  p.ready_joint_positions.clear();
+  p.collision_sphere_pos << 0, 0, -0.54;
+  p.collision_sphere_radius = 0.7;
+  profiles.push_back(p);
+
+  p.name = "puma";
+  p.robot_name = "PumaBot";
+  p.graphics_name = "PumaBotStdView";
+  p.config_file = "./specs/Puma/PumaCfg.xml";
+  p.spec_dir = "./specs/";
+  p.start_position << 0, 0, 0.9;
+  p.start_rotation = Eigen::Quaterniond(1, 0, 1, 0).normalized().toRotationMatrix();
+  p.ready_position = p.start_position;
+  p.ready_joint_positions.clear();
+  p.collision_sphere_pos << 0, 0, 0.338;
+  p.collision_sphere_radius = 0.8;
+  profiles.push_back(p);
+
+  return profiles;
+}
+
+static const vector<RobotProfile>& profiles() {
+  static const vector<RobotProfile> p = makeProfiles();
+  return p;
+}
+
+const RobotProfile& RobotProfile::get(const string& name) {
+  for(const RobotProfile& p : profiles())
+    if(p.name == name) return p;
+  throw runtime_error("Unknown robot " + name + "!");
+}
+
+vector<string> RobotProfile::getNames() {
+  vector<string> names;
+  for(const RobotProfile& p : profiles())
+    names.push_back(p.name);
+  return names;
+}
@@ -0,0 +1,44 @@
+/**
+* RobotProfile.hpp
+* ----------------
+* Per-robot settings of the Iron Dome app: which spec to load, where the
+* robot waits, and the sphere it defends. Selected by name at run time.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+class RobotProfile {
+
+public:
+
+  std::string name;          // Short name, e.g. "iiwa"
+  std::string robot_name;    // Robot in the spec file
+  std::string graphics_name; // Graphics view in the spec file
+  std::string config_file;   // Spec file, relative to the working directory
+  std::string spec_dir;      // Directory the spec's meshes are relative to
+
+  // Pose held while paused
+  Eigen::Vector3d start_position;
+  Eigen::Matrix3d start_rotation;
+
+  // Pose held while waiting for a target. If empty, the joint
+  // default positions from the spec are used.
+  Eigen::Vector3d ready_position;
+  std::vector<double> ready_joint_positions;
+
+  // Our sphere of interest for interceptions
+  Eigen::Vector3d collision_sphere_pos;
+  double collision_sphere_radius;
+
+  /**
+  * Look up a profile by name. Throws runtime_error if there is none.
+  */
+  static const RobotProfile& get(const std::string& name);
+
+  static std::vector<std::string> getNames();
+};
@@ -0,0 +1,94 @@
+/**
+* RobotState.hpp
+* --------------
+* State the control loop shares with the other threads. Each structure
+* has a single writer and is published through a DoubleBuffer, so that
+* readers get a consistent snapshot and the control tick never waits on
+* them:
+*
+*   SensedState      - control loop, every tick
+*   Setpoints        - control loop, every tick
+*   ControllerOutput - control loop, every tick
+*   Diagnostics      - control loop, every DIAGNOSTICS_DECIMATION ticks
+*
+* Requests go the other way as ControlCommands.
+*
+* Joint-space quantities use fixed-capacity Eigen types so the
+* structures hold no heap memory and can be copied as raw words.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <Eigen/Dense>
+
+// Most joints of any supported robot
+static const int MAX_DOF = 7;
+
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MAX_DOF, 1> JointVector;
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, MAX_DOF, MAX_DOF> JointMatrix;
+typedef Eigen::Matrix<double, 6, Eigen::Dynamic, 0, 6, MAX_DOF> JacobianMatrix;
+
+/**
+* Robot state as of the last updateState().
+*/
+class SensedState {
+public:
+  SensedState() : t(0), iter(0) {}
+
+  double t;   // Time of the update
+  long iter;  // Control tick it was made in
+
+  JointVector q, dq, ddq;     // Generalized position/velocity/acceleration
+  Eigen::Vector3d x_c;        // Position of the operational point
+  Eigen::Matrix3d R_c;        // End-effector orientation
+  Eigen::Vector3d v, omega;   // Linear and angular velocity
+};
+
+/**
+* What the controller is steering towards.
+*/
+class Setpoints {
+public:
+  Setpoints() : joint_space(false), paused(true), simulation(true),
+      state(-1), target_id(-1), command_seq(0) {}
+
+  Eigen::Vector3d x_d;  // Desired position
+  Eigen::Matrix3d R_d;  // Desired orientation
+  JointVector q_d;      // Desired joint position, in joint-space control
+  bool joint_space;     // Whether the joint-space controller is active
+  bool paused;          // Whether interception is paused
+  bool simulation;      // Whether simulating instead of driving the robot
+  int state;            // State machine state
+  int target_id;        // Projectile being intercepted, or -1
+  uint64_t command_seq; // Last ControlCommand applied
+};
+
+/**
+* What the controller commanded.
+*/
+class ControllerOutput {
+public:
+  Eigen::Matrix<double, 6, 1> F; // Task space force
+  JointVector tau;               // Commanded generalized force
+  JointVector tau_jlim;          // Restoring torque for joint limit avoidance
+  Eigen::Vector3d dx, dphi;      // Position and orientation errors
+};
+
+/**
+* Larger and less frequently needed quantities, for printState.
+*/
+class Diagnostics {
+public:
+  Diagnostics() : t(0), t_sim(0), dt_real(0), dt_sim(0), iter(0) {}
+
+  double t, t_sim;        // Run time and simulated time
+  double dt_real, dt_sim; // Time between the last two ticks
+  long iter;
+
+  JointMatrix M_gc;                      // Generalized mass matrix
+  Eigen::Matrix<double, 6, 6> lambda;    // Task space mass matrix
+  JacobianMatrix J;                      // Jacobian
+  JointVector q_sat;                     // Joint limit saturation
+  Eigen::Vector3d x_inc;                 // Incremental position towards goal
+};
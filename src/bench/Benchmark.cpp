@@ -0,0 +1,127 @@
+/**
+* Benchmark.cpp
+* -------------
+* Implementation of the BenchmarkSuite class.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+
+#include <unistd.h>
+
+#include "Benchmark.hpp"
+
+using namespace std;
+
+static const int DEFAULT_BATCHES = 15;
+static const double DEFAULT_BATCH_SECONDS = 0.02;
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static string jsonEscape(const string& s) {
+  string out;
+  for(char c : s) {
+    if(c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+BenchmarkSuite::BenchmarkSuite(const string& name, const string& filter) :
+    name(name), filter(filter),
+    batches(DEFAULT_BATCHES), batch_seconds(DEFAULT_BATCH_SECONDS) {}
+
+void BenchmarkSuite::setBatches(int batches, double batch_seconds) {
+  this->batches = batches;
+  this->batch_seconds = batch_seconds;
+}
+
+void BenchmarkSuite::run(const string& name, const function<void()>& fn) {
+  run(name, [](){}, fn);
+}
+
+void BenchmarkSuite::run(const string& name, const function<void()>& setup,
+    const function<void()>& fn) {
+
+  if(!filter.empty() && name.find(filter) == string::npos) return;
+
+  // Calibrate the batch size by doubling until a batch is long enough
+  long batch_size = 1;
+  while(true) {
+    setup();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(long i = 0; i < batch_size; i++) fn();
+    double elapsed = secondsSince(start);
+    if(elapsed >= batch_seconds / 4 || batch_size >= (1L << 30)) {
+      if(elapsed > 0) batch_size = max(1L, static_cast<long>(batch_size * batch_seconds / elapsed));
+      break;
+    }
+    batch_size *= 2;
+  }
+
+  vector<double> ns_per_op;
+  for(int b = 0; b < batches; b++) {
+    setup();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(long i = 0; i < batch_size; i++) fn();
+    ns_per_op.push_back(secondsSince(start) * 1e9 / batch_size);
+  }
+  sort(ns_per_op.begin(), ns_per_op.end());
+
+  double mean = 0;
+  for(double v : ns_per_op) mean += v;
+  mean /= ns_per_op.size();
+  double var = 0;
+  for(double v : ns_per_op) var += (v - mean) * (v - mean);
+
+  BenchmarkResult r;
+  r.name = name;
+  r.iterations = batch_size * batches;
+  r.ns_median = ns_per_op[ns_per_op.size() / 2];
+  r.ns_min = ns_per_op.front();
+  r.ns_max = ns_per_op.back();
+  r.ns_p90 = ns_per_op[static_cast<size_t>(0.9 * (ns_per_op.size() - 1))];
+  r.ns_stddev = sqrt(var / ns_per_op.size());
+  results.push_back(r);
+
+  char line[160];
+  snprintf(line, sizeof(line), "%-48s %12.1f ns/op  (min %.1f, p90 %.1f, %ld iterations)",
+      name.c_str(), r.ns_median, r.ns_min, r.ns_p90, r.iterations);
+  cout << line << endl;
+}
+
+void BenchmarkSuite::writeJson(ostream& os) const {
+
+  char host[256] = "unknown";
+  gethostname(host, sizeof(host) - 1);
+
+  char timestamp[32];
+  time_t now = time(NULL);
+  strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+  os << "{\n"
+     << "  \"suite\": \"" << jsonEscape(name) << "\",\n"
+     << "  \"host\": \"" << jsonEscape(host) << "\",\n"
+     << "  \"cpus\": " << sysconf(_SC_NPROCESSORS_ONLN) << ",\n"
+     << "  \"timestamp\": \"" << timestamp << "\",\n"
+     << "  \"benchmarks\": [\n";
+
+  for(size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult& r = results[i];
+    os << "    {\"name\": \"" << jsonEscape(r.name) << "\""
+       << ", \"iterations\": " << r.iterations
+       << ", \"ns_median\": " << r.ns_median
+       << ", \"ns_min\": " << r.ns_min
+       << ", \"ns_max\": " << r.ns_max
+       << ", \"ns_p90\": " << r.ns_p90
+       << ", \"ns_stddev\": " << r.ns_stddev
+       << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
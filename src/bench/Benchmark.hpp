@@ -0,0 +1,81 @@
+/**
+* Benchmark.hpp
+* -------------
+* Small microbenchmark harness. Each benchmark is a callable timed in
+* batches: the batch size is calibrated so one batch takes a few
+* milliseconds, then a number of batches are timed and summarized. The
+* per-operation times of the batches give the median and spread.
+*
+*   BenchmarkSuite suite("kernels");
+*   suite.run("lowestRealRoot", [&]() { doNotOptimize(lowestRealRoot(c)); });
+*   suite.writeJson(out);
+*/
+
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+* Keep the compiler from optimizing away a computed value.
+*/
+template<typename T>
+inline void doNotOptimize(const T& value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+class BenchmarkResult {
+public:
+  std::string name;
+  long iterations;   // Total operations timed
+  double ns_median;  // Median over batches of ns per operation
+  double ns_min;
+  double ns_max;
+  double ns_p90;
+  double ns_stddev;
+};
+
+class BenchmarkSuite {
+
+public:
+
+  /**
+  * Benchmarks whose names do not contain filter are skipped.
+  */
+  BenchmarkSuite(const std::string& name, const std::string& filter = "");
+
+  /**
+  * Time fn. Results are printed as they complete.
+  */
+  void run(const std::string& name, const std::function<void()>& fn);
+
+  /**
+  * Like run(), but setup is called before each batch and is not timed.
+  * Useful when fn consumes state that must be rebuilt.
+  */
+  void run(const std::string& name, const std::function<void()>& setup,
+      const std::function<void()>& fn);
+
+  /**
+  * Set the number of timed batches and the target duration of one batch.
+  */
+  void setBatches(int batches, double batch_seconds);
+
+  const std::vector<BenchmarkResult>& getResults() const { return results; }
+
+  /**
+  * Write all results as JSON, with enough host information to tell
+  * whether two result files are comparable.
+  */
+  void writeJson(std::ostream& os) const;
+
+private:
+
+  std::string name;
+  std::string filter;
+  int batches;
+  double batch_seconds;
+  std::vector<BenchmarkResult> results;
+};
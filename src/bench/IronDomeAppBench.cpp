@@ -0,0 +1,72 @@
+/**
+* IronDomeAppBench.cpp
+* --------------------
+* Implementation of the IronDomeAppBench class.
+*/
+
+#include "IronDomeAppBench.hpp"
+
+using namespace std;
+
+IronDomeAppBench::IronDomeAppBench(IronDomeApp& app) : app(app) {}
+
+void IronDomeAppBench::addBenchmarks(BenchmarkSuite& suite) {
+
+  IronDomeApp& a = app;
+
+  // Controllers read the state computed here, so run it once first
+  a.updateState();
+
+  suite.run("IronDomeApp::updateState", [&a]() { a.updateState(); });
+
+  suite.run("IronDomeApp::fullTaskSpaceControl", [&a]() {
+    a.fullTaskSpaceControl();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::incrementalTaskSpaceControl", [&a]() {
+    a.incrementalTaskSpaceControl();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::resolvedMotionRateControl", [&a]() {
+    a.resolvedMotionRateControl();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::jointSpaceControl", [&a]() {
+    a.jointSpaceControl();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::applyGravityCompensation", [&a]() {
+    a.applyGravityCompensation();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::applyJointLimitPotential", [&a]() {
+    a.applyJointLimitPotential();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::applyJointFriction", [&a]() {
+    a.applyJointFriction();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::applyTorqueLimits", [&a]() {
+    a.applyTorqueLimits();
+    doNotOptimize(a.tau);
+  });
+
+  suite.run("IronDomeApp::integrate", [&a]() { a.integrate(); });
+}
+
+void IronDomeAppBench::runControlTicks(long n) {
+  for(long i = 0; i < n; i++)
+    app.controlTick();
+}
+
+Eigen::Vector3d IronDomeAppBench::getOperationalPosition() {
+  return app.getSensedState().x_c;
+}
@@ -0,0 +1,37 @@
+/**
+* IronDomeAppBench.hpp
+* --------------------
+* Benchmarks of the control stages of a headless IronDomeApp. Declared
+* a friend of IronDomeApp so it can time the private stages one by one.
+*/
+
+#pragma once
+
+#include "../IronDomeApp.hpp"
+#include "Benchmark.hpp"
+
+class IronDomeAppBench {
+
+public:
+
+  explicit IronDomeAppBench(IronDomeApp& app);
+
+  /**
+  * Time updateState and each controller and torque stage.
+  */
+  void addBenchmarks(BenchmarkSuite& suite);
+
+  /**
+  * Run n complete control ticks back to back, without sleeping.
+  */
+  void runControlTicks(long n);
+
+  /**
+  * Current position of the operational point.
+  */
+  Eigen::Vector3d getOperationalPosition();
+
+private:
+
+  IronDomeApp& app;
+};
@@ -0,0 +1,150 @@
+/**
+* bench_main.cpp
+* --------------
+* Microbenchmarks for the hot kernels of the Iron Dome app. Run from the
+* repository root so the robot specs can be found:
+*
+*   ./bench --json bench.json [--filter name] [--no-app]
+*
+* Compare two result files with bench_compare.py.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <Eigen/Dense>
+
+#include "kalman.hpp"
+#include "Benchmark.hpp"
+#include "IronDomeAppBench.hpp"
+#include "../lowestRealRoot.hpp"
+#include "../MessageParsing.hpp"
+#include "../projectile/projectile.hpp"
+
+using namespace std;
+
+static const double DT = 1.0 / 30;
+static const double GRAVITY = -9.81;
+
+// A typical incoming trajectory, in the robot frame
+static const Eigen::Vector3d P0(4.2, 0.1, 0.7);
+static const Eigen::Vector3d V0(-4.6, 0.05, 4.6);
+
+static Eigen::Vector3d truePosition(double t) {
+  return P0 + V0 * t + 0.5 * Eigen::Vector3d(0, 0, GRAVITY) * t * t;
+}
+
+static void addKernelBenchmarks(BenchmarkSuite& suite) {
+
+  // Quartic from a sphere intersection, as built by getIntersectionTime
+  Eigen::VectorXd coeff(5);
+  coeff << -1.2, 2.1, 30.5, -45.1, 24.06;
+  suite.run("lowestRealRoot", [&coeff]() {
+    doNotOptimize(lowestRealRoot(coeff));
+  });
+
+  // Projectile with a converged estimate
+  Eigen::Vector3d p = truePosition(0);
+  Projectile proj(1, ProjectileMeasurement(0, p(0), p(1), p(2)));
+  for(int i = 1; i < 10; i++) {
+    p = truePosition(i * DT);
+    proj.addObservation(ProjectileMeasurement(i * DT, p(0), p(1), p(2)));
+  }
+  Projectile* pp = &proj;
+
+  Eigen::Vector3d origin(-0.4, 0, 0.1);
+  suite.run("Projectile::getIntersectionTime", [pp, &origin]() {
+    doNotOptimize(pp->getIntersectionTime(origin, 1.5));
+  });
+
+  ProjectileSnapshot snapshot = proj.getSnapshot();
+  suite.run("ProjectileSnapshot::getIntersectionTime", [&snapshot, &origin]() {
+    doNotOptimize(snapshot.getIntersectionTime(origin, 1.5));
+  });
+
+  suite.run("Projectile::getPosition", [pp]() {
+    doNotOptimize(pp->getPosition(0.5));
+  });
+
+  int step = 10;
+  suite.run("Projectile::addObservation", [pp, &step]() {
+    double t = (step++) * DT;
+    Eigen::Vector3d p = truePosition(t);
+    pp->addObservation(ProjectileMeasurement(t, p(0), p(1), p(2)));
+  });
+
+  // One axis estimator, configured as in Projectile
+  const int n = 3, m = 1;
+  Eigen::MatrixXd A(n, n), C(m, n), Q(n, n), R(m, m), P(n, n);
+  A << 1, DT, 0, 0, 1, DT, 0, 0, 1;
+  C << 1, 0, 0;
+  Q << .05, .05, .0, .05, .05, .0, .0, .0, .0;
+  R << 5;
+  P << .1, .1, .1, .1, 10000, 10, .1, 10, 100;
+  KalmanFilter kf(DT, A, C, Q, R, P);
+  kf.init(0, Eigen::Vector3d(P0(2), 0, GRAVITY));
+  Eigen::VectorXd y(m);
+  y << P0(2);
+  suite.run("KalmanFilter::update", [&kf, &y, &A]() {
+    kf.update(y, DT, A);
+  });
+
+  // Messages as produced by projectile_test and the robot driver
+  string observation = "12 1.733333 2.117052 0.088531 1.563020";
+  ObservationMessage obs;
+  suite.run("parseObservationMessage", [&observation, &obs]() {
+    parseObservationMessage(observation, obs);
+    doNotOptimize(obs);
+  });
+
+  string joints = "0.012300 1.500120 -0.001300 1.600040 0.000100 0.850020 0.000000";
+  Eigen::VectorXd q(7);
+  suite.run("parseJointMessage", [&joints, &q]() {
+    parseJointMessage(joints, q);
+    doNotOptimize(q);
+  });
+}
+
+int main(int argc, char* argv[]) {
+
+  string json_file;
+  string filter;
+  bool app_benchmarks = true;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--json") && i + 1 < argc) json_file = argv[++i];
+    else if(!strcmp(argv[i], "--filter") && i + 1 < argc) filter = argv[++i];
+    else if(!strcmp(argv[i], "--no-app")) app_benchmarks = false;
+    else {
+      cerr << "Usage: " << argv[0] << " [--json file] [--filter name] [--no-app]" << endl;
+      return 1;
+    }
+  }
+
+  BenchmarkSuite suite("iron_dome_kernels", filter);
+  addKernelBenchmarks(suite);
+
+  if(app_benchmarks) {
+    try {
+      IronDomeConfig config;
+      config.graphics = false;
+      config.redis = false;
+      IronDomeApp app(config);
+      IronDomeAppBench app_bench(app);
+      app_bench.addBenchmarks(suite);
+    } catch(const exception& e) {
+      cerr << "Skipping app benchmarks: " << e.what() << endl;
+    }
+  }
+
+  if(!json_file.empty()) {
+    ofstream out(json_file);
+    suite.writeJson(out);
+    cout << "Wrote " << suite.getResults().size() << " results to " << json_file << endl;
+  }
+
+  return 0;
+}
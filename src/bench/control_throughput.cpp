@@ -0,0 +1,225 @@
+/**
+* control_throughput.cpp
+* ----------------------
+* Headless throughput of the complete control tick. For every robot
+* profile and controller, an app without graphics or Redis runs
+* controlTick() back to back, as fast as it can, and the tick and stage
+* histograms that the control loop records are read back. Reported:
+*
+*   rate       - ticks per second reached; the headroom over the
+*                control rate (1 / SIMULATION_DT = 10 kHz)
+*   tick       - p50, p99, p99.9 and max tick times
+*   stages     - mean time per stage, and its share of the tick
+*
+* The app stays paused, so the state machine holds the start pose and
+* the selected controller runs on every tick.
+*
+* Usage, from the repository root so the robot specs can be found:
+*
+*   ./control_throughput [--robots iiwa,puma] [--controllers full,rmrc]
+*                        [--seconds S] [--json file]
+*/
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "IronDomeAppBench.hpp"
+#include "../metrics/AppMetrics.hpp"
+#include "../RobotProfile.hpp"
+
+using namespace std;
+
+// Ticks run before measuring, to settle caches and the allocator
+static const long WARMUP_TICKS = 2000;
+
+// Ticks per check of the elapsed time
+static const long TICKS_PER_BATCH = 1000;
+
+// Control rate the loop is paced to
+static const double CONTROL_HZ = 10000;
+
+static vector<string> parseList(const string& s) {
+  vector<string> values;
+  stringstream ss(s);
+  string item;
+  while(getline(ss, item, ','))
+    values.push_back(item);
+  return values;
+}
+
+class StageResult {
+public:
+  string name;
+  double mean_ns;
+  uint64_t p99_ns;
+};
+
+class ThroughputResult {
+public:
+  string robot;
+  string controller;
+  string error; // Why the configuration could not run, if it could not
+  long ticks;
+  double ticks_per_sec;
+  uint64_t tick_p50, tick_p99, tick_p999, tick_max;
+  vector<StageResult> stages;
+};
+
+static void resetControlMetrics(AppMetrics& m) {
+  m.control_tick.reset();
+  m.control_period.reset();
+  m.stage_update_state.reset();
+  m.stage_send_to_robot.reset();
+  m.stage_state_machine.reset();
+  m.stage_controller.reset();
+  m.stage_integrate.reset();
+}
+
+static StageResult stageOf(const string& name, const LatencyHistogram& h) {
+  StageResult s;
+  s.name = name;
+  s.mean_ns = h.count() > 0 ? static_cast<double>(h.sum()) / h.count() : 0;
+  s.p99_ns = h.percentile(0.99);
+  return s;
+}
+
+static ThroughputResult run(const string& robot, const string& controller, double seconds) {
+
+  ThroughputResult r;
+  r.robot = robot;
+  r.controller = controller;
+  r.ticks = 0;
+
+  IronDomeConfig config;
+  config.graphics = false;
+  config.redis = false;
+  config.robot = robot;
+  config.controller = controller;
+
+  try {
+    IronDomeApp app(config);
+    IronDomeAppBench bench(app);
+    AppMetrics metrics;
+
+    bench.runControlTicks(WARMUP_TICKS);
+    resetControlMetrics(metrics);
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    double elapsed = 0;
+    while(elapsed < seconds) {
+      bench.runControlTicks(TICKS_PER_BATCH);
+      r.ticks += TICKS_PER_BATCH;
+      elapsed = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    }
+
+    r.ticks_per_sec = r.ticks / elapsed;
+    r.tick_p50 = metrics.control_tick.percentile(0.50);
+    r.tick_p99 = metrics.control_tick.percentile(0.99);
+    r.tick_p999 = metrics.control_tick.percentile(0.999);
+    r.tick_max = metrics.control_tick.max();
+
+    r.stages.push_back(stageOf("update_state", metrics.stage_update_state));
+    r.stages.push_back(stageOf("state_machine", metrics.stage_state_machine));
+    r.stages.push_back(stageOf("controller", metrics.stage_controller));
+    r.stages.push_back(stageOf("integrate", metrics.stage_integrate));
+
+  } catch(const exception& e) {
+    r.error = e.what();
+  }
+
+  return r;
+}
+
+static void print(const ThroughputResult& r) {
+
+  char line[256];
+  if(!r.error.empty()) {
+    snprintf(line, sizeof(line), "%-6s %-12s skipped: %s",
+        r.robot.c_str(), r.controller.c_str(), r.error.c_str());
+    cout << line << endl;
+    return;
+  }
+
+  snprintf(line, sizeof(line),
+      "%-6s %-12s %8.0f ticks/s (%5.1fx)  tick p50 %-9s p99 %-9s p99.9 %-9s max %-9s",
+      r.robot.c_str(), r.controller.c_str(), r.ticks_per_sec, r.ticks_per_sec / CONTROL_HZ,
+      LatencyHistogram::formatDuration(r.tick_p50).c_str(),
+      LatencyHistogram::formatDuration(r.tick_p99).c_str(),
+      LatencyHistogram::formatDuration(r.tick_p999).c_str(),
+      LatencyHistogram::formatDuration(r.tick_max).c_str());
+  cout << line << "\n";
+
+  double total = 0;
+  for(const StageResult& s : r.stages) total += s.mean_ns;
+  for(const StageResult& s : r.stages) {
+    snprintf(line, sizeof(line), "    %-14s mean %9.0f ns  %5.1f%%  p99 %s",
+        s.name.c_str(), s.mean_ns, total > 0 ? 100 * s.mean_ns / total : 0,
+        LatencyHistogram::formatDuration(s.p99_ns).c_str());
+    cout << line << "\n";
+  }
+  cout << flush;
+}
+
+static void writeJson(ostream& os, const vector<ThroughputResult>& results) {
+  os << "{\n  \"suite\": \"control_throughput\",\n  \"control_hz\": " << CONTROL_HZ
+     << ",\n  \"results\": [\n";
+  for(size_t i = 0; i < results.size(); i++) {
+    const ThroughputResult& r = results[i];
+    os << "    {\"robot\": \"" << r.robot << "\", \"controller\": \"" << r.controller << "\"";
+    if(!r.error.empty()) {
+      os << ", \"skipped\": true";
+    } else {
+      os << ", \"ticks\": " << r.ticks
+         << ", \"ticks_per_sec\": " << r.ticks_per_sec
+         << ", \"tick_ns\": {\"p50\": " << r.tick_p50 << ", \"p99\": " << r.tick_p99
+         << ", \"p999\": " << r.tick_p999 << ", \"max\": " << r.tick_max << "}"
+         << ", \"stage_mean_ns\": {";
+      for(size_t j = 0; j < r.stages.size(); j++)
+        os << (j ? ", " : "") << "\"" << r.stages[j].name << "\": " << r.stages[j].mean_ns;
+      os << "}";
+    }
+    os << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+
+  vector<string> robots = RobotProfile::getNames();
+  vector<string> controllers = IronDomeApp::getControllerNames();
+  double seconds = 2.0;
+  string json_file;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--robots") && i + 1 < argc) robots = parseList(argv[++i]);
+    else if(!strcmp(argv[i], "--controllers") && i + 1 < argc) controllers = parseList(argv[++i]);
+    else if(!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--json") && i + 1 < argc) json_file = argv[++i];
+    else {
+      cerr << "Usage: " << argv[0] << " [--robots a,b] [--controllers a,b]"
+           << " [--seconds S] [--json file]" << endl;
+      return 1;
+    }
+  }
+
+  vector<ThroughputResult> results;
+  for(const string& robot : robots) {
+    for(const string& controller : controllers) {
+      results.push_back(run(robot, controller, seconds));
+      print(results.back());
+    }
+  }
+
+  if(!json_file.empty()) {
+    ofstream out(json_file);
+    writeJson(out, results);
+    cout << "Wrote " << results.size() << " results to " << json_file << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,410 @@
+/**
+* estimator_bench.cpp
+* -------------------
+* Accuracy versus cost of the trajectory estimator backends. Every backend
+* from getEstimatorNames() runs over the same tracks, and one table
+* reports for each backend and dataset:
+*
+*   rmse@L    - RMSE of the predicted intercept point, using the estimate
+*               available L seconds before the true intercept. The
+*               prediction is made the way the state machine makes it:
+*               the estimated trajectory is intersected with the sphere.
+*   miss      - fraction of those predictions with no intersection at all
+*   converge  - median time from the first observation until the
+*               predicted intercept point stays within CONVERGE_TOLERANCE
+*   ns/update - CPU cost of one update() call
+*
+* Datasets:
+*
+*   synthetic       - ballistic tracks with Gaussian measurement noise,
+*                     like ProjectileGenerator
+*   synthetic-drag  - the same with quadratic air drag, which none of the
+*                     backends model exactly
+*   recorded        - observations from a file of "id t x y z" lines, as
+*                     sent by the vision system. Ground truth is a
+*                     least-squares fit to the whole track, which is only
+*                     as good as the track is long.
+*
+* Usage:
+*
+*   ./estimator_bench [--tracks N] [--seed S] [--recorded file] [--json file]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "Benchmark.hpp"
+#include "../MessageParsing.hpp"
+#include "../projectile/projectile.hpp"
+#include "../projectile/TrajectoryEstimator.hpp"
+
+using namespace std;
+
+// Intercept sphere of the default robot
+static const Eigen::Vector3d SPHERE_POS(-.4, 0, 0.1);
+static const double SPHERE_RADIUS = 1.50;
+
+// Camera frame period and noise, as in ProjectileGenerator
+static const double DT = 1.0 / 30;
+static const double NOISE_STDDEV = 0.05;
+
+// Launch parameters, as in ProjectileGenerator and projectile_test
+static const Eigen::Vector3d P0_AVG(4.2, 0, .7);
+static const double V_AVG = 6.5;
+static const double THETA_AVG = M_PI / 4;
+static const double P0_STDDEV = 0.2;
+static const double V0_STDDEV = 0.2;
+static const Eigen::Vector3d GRAVITY(0, 0, -9.81);
+
+// Drag acceleration is -DRAG_COEFF * |v| * v; about a tennis ball's
+static const double DRAG_COEFF = 0.02;
+
+// Ground truth is sampled at this period
+static const double TRUTH_DT = 0.0005;
+
+static const double LEAD_TIMES[] = {0.1, 0.2, 0.3, 0.4};
+static const int NUM_LEAD_TIMES = sizeof(LEAD_TIMES) / sizeof(LEAD_TIMES[0]);
+
+static const double CONVERGE_TOLERANCE = 0.10;
+
+/**
+* Observations of one projectile, with its true trajectory.
+*/
+class Track {
+public:
+  vector<ProjectileMeasurement> observations;
+  vector<ProjectileMeasurement> truth;
+
+  // True intercept, or t_intercept < 0 if there is none
+  double t_intercept;
+  Eigen::Vector3d p_intercept;
+
+  void findIntercept() {
+    t_intercept = -1;
+    for(const ProjectileMeasurement& s : truth) {
+      Eigen::Vector3d p(s.x, s.y, s.z);
+      if(s.t > observations.front().t && (p - SPHERE_POS).norm() <= SPHERE_RADIUS) {
+        t_intercept = s.t;
+        p_intercept = p;
+        return;
+      }
+    }
+  }
+};
+
+class Dataset {
+public:
+  string name;
+  vector<Track> tracks;
+};
+
+// Tracks end where the app would expire them
+static bool expired(const Eigen::Vector3d& p) {
+  return p(0) < X_EXPIRATION || p(2) < Z_EXPIRATION;
+}
+
+static Dataset makeSynthetic(const string& name, int num_tracks, double drag, unsigned seed) {
+
+  default_random_engine generator(seed);
+  normal_distribution<double> normal(0.0, 1.0);
+
+  Dataset d;
+  d.name = name;
+
+  for(int i = 0; i < num_tracks; i++) {
+
+    Eigen::Vector3d p = P0_AVG;
+    Eigen::Vector3d v(-V_AVG * cos(THETA_AVG), 0, V_AVG * sin(THETA_AVG));
+    for(int j = 0; j < 3; j++) p(j) += normal(generator) * P0_STDDEV;
+    for(int j = 0; j < 3; j++) v(j) += normal(generator) * V0_STDDEV;
+
+    // Integrate the true trajectory, observing it every camera frame
+    Track track;
+    double next_observation = 0;
+    for(double t = 0; !expired(p); t += TRUTH_DT) {
+      track.truth.push_back(ProjectileMeasurement(t, p(0), p(1), p(2)));
+      if(t >= next_observation) {
+        Eigen::Vector3d noise(normal(generator), normal(generator), normal(generator));
+        Eigen::Vector3d m = p + noise * NOISE_STDDEV;
+        track.observations.push_back(ProjectileMeasurement(t, m(0), m(1), m(2)));
+        next_observation += DT;
+      }
+      Eigen::Vector3d acc = GRAVITY - drag * v.norm() * v;
+      p += v * TRUTH_DT + 0.5 * acc * TRUTH_DT * TRUTH_DT;
+      v += acc * TRUTH_DT;
+    }
+
+    track.findIntercept();
+    if(track.observations.size() >= 2) d.tracks.push_back(track);
+  }
+
+  return d;
+}
+
+static bool loadRecorded(const string& file, Dataset& d) {
+
+  ifstream in(file);
+  if(!in) return false;
+
+  d.name = "recorded";
+
+  map<int, vector<ProjectileMeasurement>> by_id;
+  string line;
+  ObservationMessage obs;
+  while(getline(in, line))
+    if(parseObservationMessage(line, obs))
+      by_id[obs.id].push_back(ProjectileMeasurement(obs.t, obs.x, obs.y, obs.z));
+
+  for(pair<const int, vector<ProjectileMeasurement>>& p : by_id) {
+
+    if(p.second.size() < 5) continue;
+
+    // Best estimate of the truth: a fit to every observation of the track
+    Track track;
+    track.observations = p.second;
+    LeastSquaresEstimator fit(track.observations.size(), true);
+    fit.init(track.observations.front());
+    for(size_t i = 1; i < track.observations.size(); i++)
+      fit.update(track.observations[i]);
+
+    ProjectileSnapshot s;
+    s.t = fit.getTime();
+    s.p = fit.getPosition();
+    s.v = fit.getVelocity();
+    s.a = fit.getAcceleration();
+    for(double t = track.observations.front().t; ; t += TRUTH_DT) {
+      Eigen::Vector3d pos = s.getPosition(t);
+      if(expired(pos) || t > s.t + 1.0) break;
+      track.truth.push_back(ProjectileMeasurement(t, pos(0), pos(1), pos(2)));
+    }
+
+    track.findIntercept();
+    d.tracks.push_back(track);
+  }
+
+  return true;
+}
+
+class EstimatorResult {
+public:
+  string estimator;
+  string dataset;
+  int tracks;
+  double rmse[NUM_LEAD_TIMES];
+  double miss[NUM_LEAD_TIMES];
+  double converge_ms;
+  double converged_fraction;
+  double ns_per_update;
+};
+
+static ProjectileSnapshot snapshotOf(const TrajectoryEstimator& e) {
+  ProjectileSnapshot s;
+  s.t = e.getTime();
+  s.p = e.getPosition();
+  s.v = e.getVelocity();
+  s.a = e.getAcceleration();
+  return s;
+}
+
+/**
+* Intercept point predicted from an estimate, or false if the estimated
+* trajectory misses the sphere.
+*/
+static bool predictIntercept(const ProjectileSnapshot& s, Eigen::Vector3d& p) {
+  double t = s.getIntersectionTime(SPHERE_POS, SPHERE_RADIUS);
+  if(t < 0) return false;
+  p = s.getPosition(t);
+  return true;
+}
+
+static EstimatorResult evaluate(const string& name, const Dataset& d) {
+
+  EstimatorResult r;
+  r.estimator = name;
+  r.dataset = d.name;
+  r.tracks = 0;
+
+  unique_ptr<TrajectoryEstimator> e(createEstimator(name));
+
+  // Cost: updates only, over the whole dataset
+  long updates = 0;
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+  for(const Track& track : d.tracks) {
+    e->init(track.observations[0]);
+    for(size_t i = 1; i < track.observations.size(); i++) {
+      e->update(track.observations[i]);
+      doNotOptimize(e->getPosition());
+    }
+    updates += track.observations.size() - 1;
+  }
+  r.ns_per_update = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count()
+      / max(updates, 1L);
+
+  // Accuracy: replay each track, keeping the estimate after every update
+  double sq_error[NUM_LEAD_TIMES] = {0};
+  int hits[NUM_LEAD_TIMES] = {0}, predictions[NUM_LEAD_TIMES] = {0};
+  vector<double> converge_times;
+
+  for(const Track& track : d.tracks) {
+
+    if(track.t_intercept < 0) continue;
+    r.tracks++;
+
+    vector<ProjectileSnapshot> estimates;
+    e->init(track.observations[0]);
+    estimates.push_back(snapshotOf(*e));
+    for(size_t i = 1; i < track.observations.size(); i++) {
+      if(track.observations[i].t > track.t_intercept) break;
+      e->update(track.observations[i]);
+      estimates.push_back(snapshotOf(*e));
+    }
+
+    for(int l = 0; l < NUM_LEAD_TIMES; l++) {
+
+      // Latest estimate available at the lead time
+      const ProjectileSnapshot* latest = NULL;
+      for(const ProjectileSnapshot& s : estimates)
+        if(s.t <= track.t_intercept - LEAD_TIMES[l]) latest = &s;
+      if(!latest) continue;
+
+      predictions[l]++;
+      Eigen::Vector3d p;
+      if(predictIntercept(*latest, p)) {
+        hits[l]++;
+        sq_error[l] += (p - track.p_intercept).squaredNorm();
+      }
+    }
+
+    // Converged from the first estimate after which all are within tolerance
+    double t_converged = -1;
+    for(const ProjectileSnapshot& s : estimates) {
+      Eigen::Vector3d p;
+      bool good = predictIntercept(s, p) && (p - track.p_intercept).norm() < CONVERGE_TOLERANCE;
+      if(!good) t_converged = -1;
+      else if(t_converged < 0) t_converged = s.t;
+    }
+    if(t_converged >= 0)
+      converge_times.push_back(t_converged - track.observations[0].t);
+  }
+
+  for(int l = 0; l < NUM_LEAD_TIMES; l++) {
+    r.rmse[l] = hits[l] > 0 ? sqrt(sq_error[l] / hits[l]) : NAN;
+    r.miss[l] = predictions[l] > 0 ? 1.0 - static_cast<double>(hits[l]) / predictions[l] : NAN;
+  }
+
+  r.converged_fraction = r.tracks > 0 ? static_cast<double>(converge_times.size()) / r.tracks : 0;
+  if(converge_times.empty()) {
+    r.converge_ms = NAN;
+  } else {
+    sort(converge_times.begin(), converge_times.end());
+    r.converge_ms = 1e3 * converge_times[converge_times.size() / 2];
+  }
+
+  return r;
+}
+
+static void printTable(const vector<EstimatorResult>& results) {
+
+  char line[256];
+  string header = "estimator       dataset          tracks";
+  for(int l = 0; l < NUM_LEAD_TIMES; l++) {
+    snprintf(line, sizeof(line), "  rmse@%.1fs", LEAD_TIMES[l]);
+    header += line;
+  }
+  header += "  miss@max  converge (ok)    ns/update";
+  cout << header << "\n" << string(header.size(), '-') << "\n";
+
+  for(const EstimatorResult& r : results) {
+    snprintf(line, sizeof(line), "%-15s %-15s %7d", r.estimator.c_str(), r.dataset.c_str(), r.tracks);
+    cout << line;
+    for(int l = 0; l < NUM_LEAD_TIMES; l++) {
+      snprintf(line, sizeof(line), "  %8.1fmm", 1e3 * r.rmse[l]);
+      cout << line;
+    }
+    snprintf(line, sizeof(line), "  %7.1f%%  %6.0fms (%3.0f%%)  %10.1f",
+        100 * r.miss[NUM_LEAD_TIMES - 1], r.converge_ms, 100 * r.converged_fraction,
+        r.ns_per_update);
+    cout << line << "\n";
+  }
+}
+
+static void writeJson(ostream& os, const vector<EstimatorResult>& results) {
+
+  // NaN is not valid JSON
+  auto number = [](double x) { return std::isnan(x) ? string("null") : to_string(x); };
+
+  os << "{\n  \"suite\": \"estimators\",\n  \"results\": [\n";
+  for(size_t i = 0; i < results.size(); i++) {
+    const EstimatorResult& r = results[i];
+    os << "    {\"estimator\": \"" << r.estimator << "\", \"dataset\": \"" << r.dataset
+       << "\", \"tracks\": " << r.tracks << ", \"rmse_m\": {";
+    for(int l = 0; l < NUM_LEAD_TIMES; l++)
+      os << (l ? ", " : "") << "\"" << LEAD_TIMES[l] << "\": " << number(r.rmse[l]);
+    os << "}, \"miss\": {";
+    for(int l = 0; l < NUM_LEAD_TIMES; l++)
+      os << (l ? ", " : "") << "\"" << LEAD_TIMES[l] << "\": " << number(r.miss[l]);
+    os << "}, \"converge_ms\": " << number(r.converge_ms)
+       << ", \"converged_fraction\": " << r.converged_fraction
+       << ", \"ns_per_update\": " << r.ns_per_update << "}"
+       << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+
+  int num_tracks = 500;
+  unsigned seed = 1;
+  string recorded_file;
+  string json_file;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--tracks") && i + 1 < argc) num_tracks = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--seed") && i + 1 < argc) seed = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--recorded") && i + 1 < argc) recorded_file = argv[++i];
+    else if(!strcmp(argv[i], "--json") && i + 1 < argc) json_file = argv[++i];
+    else {
+      cerr << "Usage: " << argv[0]
+           << " [--tracks N] [--seed S] [--recorded file] [--json file]" << endl;
+      return 1;
+    }
+  }
+
+  vector<Dataset> datasets;
+  datasets.push_back(makeSynthetic("synthetic", num_tracks, 0, seed));
+  datasets.push_back(makeSynthetic("synthetic-drag", num_tracks, DRAG_COEFF, seed));
+  if(!recorded_file.empty()) {
+    Dataset d;
+    if(!loadRecorded(recorded_file, d)) {
+      cerr << "Could not read " << recorded_file << endl;
+      return 1;
+    }
+    datasets.push_back(d);
+  }
+
+  vector<EstimatorResult> results;
+  for(const Dataset& d : datasets)
+    for(const string& name : getEstimatorNames())
+      results.push_back(evaluate(name, d));
+
+  printTable(results);
+
+  if(!json_file.empty()) {
+    ofstream out(json_file);
+    writeJson(out, results);
+    cout << "Wrote " << results.size() << " results to " << json_file << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+/**
+* reaction_latency.cpp
+* --------------------
+* End-to-end reaction latency harness. Runs the control loop of an app
+* without graphics, injects synthetic projectiles through the real
+* ingest path, and measures the time from the last observation injected
+* before the reaction until:
+*
+*   selected - the state machine selects the projectile as its target
+*   setpoint - x_d is first set to the projectile's intercept point
+*
+* Usage, from the repository root:
+*
+*   ./reaction_latency [--transport inproc|redis] [--trials N] [--json file]
+*                      [--no-planner]
+*
+* The redis transport pushes observations onto iron_dome:projectiles
+* like the vision system does, and needs a Redis server on localhost.
+* Intercepts are evaluated by the planner thread as observations arrive,
+* as in the app; --no-planner leaves them to the control loop instead.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+#include "redox.hpp"
+
+#include "../IronDomeApp.hpp"
+
+using namespace std;
+
+static const string REDIS_HOST = "localhost";
+static const int REDIS_PORT = 6379;
+
+// Camera frame period
+static const double DT = 1.0 / 30;
+
+// Give up on a trial if the app does not react within this time
+static const double TRIAL_TIMEOUT = 2.0;
+
+// Time for the previous projectile to expire between trials
+static const double TRIAL_GAP = 2.0;
+
+// Trajectory that passes through the intercept envelope
+static const Eigen::Vector3d P0(4.2, 0, 0.7);
+static const Eigen::Vector3d V0(-4.6, 0, 4.6);
+static const Eigen::Vector3d GRAVITY(0, 0, -9.81);
+
+static int64_t steadyNanos() {
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class LatencyStats {
+public:
+  vector<double> samples_us;
+
+  void add(int64_t ns) { samples_us.push_back(ns / 1e3); }
+
+  double percentile(double q) {
+    if(samples_us.empty()) return 0;
+    vector<double> sorted = samples_us;
+    sort(sorted.begin(), sorted.end());
+    return sorted[static_cast<size_t>(q * (sorted.size() - 1))];
+  }
+};
+
+int main(int argc, char* argv[]) {
+
+  string transport = "inproc";
+  string json_file;
+  int trials = 20;
+  bool use_planner = true;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--transport") && i + 1 < argc) transport = argv[++i];
+    else if(!strcmp(argv[i], "--trials") && i + 1 < argc) trials = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--json") && i + 1 < argc) json_file = argv[++i];
+    else if(!strcmp(argv[i], "--no-planner")) use_planner = false;
+    else {
+      cerr << "Usage: " << argv[0]
+           << " [--transport inproc|redis] [--trials N] [--json file] [--no-planner]" << endl;
+      return 1;
+    }
+  }
+
+  bool use_redis = (transport == "redis");
+  if(!use_redis && transport != "inproc") {
+    cerr << "Unknown transport " << transport << endl;
+    return 1;
+  }
+
+  IronDomeConfig config;
+  config.graphics = false;
+  config.redis = use_redis;
+  config.shell = false;
+  IronDomeApp app(config);
+  app.setPaused(false);
+
+  redox::Redox rdx;
+  if(use_redis) {
+    if(!rdx.connect(REDIS_HOST, REDIS_PORT)) {
+      cerr << "Could not connect to Redis server!" << endl;
+      return 1;
+    }
+    rdx.del("iron_dome:projectiles");
+  }
+
+  thread control_thread(&IronDomeApp::controlsLoop, &app);
+  thread io_thread(&IronDomeApp::ioLoop, &app);
+  thread planner_thread;
+  if(use_planner) planner_thread = thread(&IronDomeApp::plannerLoop, &app);
+
+  const ReactionProbe& probe = app.getReactionProbe();
+  LatencyStats selected, setpoint;
+  int missed = 0;
+
+  for(int trial = 0; trial < trials; trial++) {
+
+    // Unique IDs so tracks never collide between trials and runs
+    int id = 1000000 + trial;
+    int64_t last_injected_ns = 0;
+    int64_t selected_latency = -1, setpoint_latency = -1;
+    double t0 = steadyNanos() / 1e9;
+
+    for(double t = 0; t < TRIAL_TIMEOUT; t += DT) {
+
+      Eigen::Vector3d p = P0 + V0 * t + 0.5 * GRAVITY * t * t;
+      string msg = to_string(id) + " " + to_string(t0 + t) + " "
+          + to_string(p(0)) + " " + to_string(p(1)) + " " + to_string(p(2));
+
+      last_injected_ns = steadyNanos();
+      if(use_redis) rdx.command({"LPUSH", "iron_dome:projectiles", msg});
+      else app.ingestObservation(msg);
+
+      // Poll the probe until the next frame is due
+      int64_t next_frame_ns = last_injected_ns + static_cast<int64_t>(DT * 1e9);
+      while(steadyNanos() < next_frame_ns) {
+        if(selected_latency < 0 && probe.selected_id == id)
+          selected_latency = probe.selected_ns - last_injected_ns;
+        if(setpoint_latency < 0 && probe.setpoint_id == id)
+          setpoint_latency = probe.setpoint_ns - last_injected_ns;
+        if(selected_latency >= 0 && setpoint_latency >= 0) break;
+        this_thread::sleep_for(chrono::microseconds(20));
+      }
+      if(selected_latency >= 0 && setpoint_latency >= 0) break;
+    }
+
+    if(selected_latency < 0 || setpoint_latency < 0) {
+      missed++;
+      cout << "Trial " << trial << ": no reaction" << endl;
+    } else {
+      selected.add(selected_latency);
+      setpoint.add(setpoint_latency);
+      cout << "Trial " << trial << ": selected after " << selected_latency / 1e3
+           << " us, setpoint after " << setpoint_latency / 1e3 << " us" << endl;
+    }
+
+    this_thread::sleep_for(chrono::milliseconds(static_cast<int>(TRIAL_GAP * 1000)));
+  }
+
+  app.stop();
+  control_thread.join();
+  if(planner_thread.joinable()) planner_thread.join();
+  io_thread.join();
+  if(use_redis) rdx.disconnect();
+
+  cout << "\nReaction latency over " << selected.samples_us.size() << " trials ("
+       << missed << " missed), transport " << transport << ":\n"
+       << "  selected  p50 " << selected.percentile(0.5) << " us  p99 "
+       << selected.percentile(0.99) << " us  max " << selected.percentile(1.0) << " us\n"
+       << "  setpoint  p50 " << setpoint.percentile(0.5) << " us  p99 "
+       << setpoint.percentile(0.99) << " us  max " << setpoint.percentile(1.0) << " us\n";
+
+  if(!json_file.empty()) {
+    ofstream out(json_file);
+    out << "{\n"
+        << "  \"transport\": \"" << transport << "\",\n"
+        << "  \"planner\": " << (use_planner ? "true" : "false") << ",\n"
+        << "  \"trials\": " << trials << ",\n"
+        << "  \"missed\": " << missed << ",\n"
+        << "  \"selected_us\": {\"p50\": " << selected.percentile(0.5)
+        << ", \"p99\": " << selected.percentile(0.99)
+        << ", \"max\": " << selected.percentile(1.0) << "},\n"
+        << "  \"setpoint_us\": {\"p50\": " << setpoint.percentile(0.5)
+        << ", \"p99\": " << setpoint.percentile(0.99)
+        << ", \"max\": " << setpoint.percentile(1.0) << "}\n"
+        << "}\n";
+  }
+
+  return missed == trials ? 1 : 0;
+}
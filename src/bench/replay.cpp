@@ -0,0 +1,414 @@
+/**
+* replay.cpp
+* ----------
+* Replays recorded sessions and seeded scenarios through the app in
+* virtual time, and writes what happened as JSON for regression_gate.py.
+*
+* Each corpus entry gets a fresh headless app, unpaused. AppClock is
+* switched to virtual time, and every control tick advances it by one
+* control period, delivers the observations that are due through
+* ingestObservation(), and runs controlTick(). Decisions therefore do
+* not depend on how fast the machine is, and two builds see exactly
+* the same inputs. Recorded per entry:
+*
+*   intercepted   - tracks the operational point came within
+*                   INTERCEPT_RADIUS of, while the track was live
+*   targeted      - tracks the state machine selected
+*   reaction      - virtual time from a track's first observation to
+*                   its selection
+*   cpu           - thread CPU time of every CPU_SAMPLE_EVERY-th tick
+*   allocations   - heap allocations by the replay thread, in total and
+*                   inside the control tick (builds with allocation
+*                   tracking only)
+*
+* Sessions are files of observation messages ("id t x y z") and control
+* commands ("cmd seq t type args..."), as written by the app when
+* IRON_DOME_RECORD_SESSION is set. Each observation is delivered at its
+* own timestamp, and each command with the observation before it. Scenarios are generated from a seed,
+* like ProjectileGenerator does.
+*
+* Usage, from the repository root:
+*
+*   ./replay [--corpus file] [--session file]... [--scenario seed]...
+*            [--label name] [--robot name] [--controller name] [--json file]
+*
+* A corpus file lists one entry per line: "session <file>" or
+* "scenario <seed>". Lines starting with # are ignored.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "IronDomeAppBench.hpp"
+#include "../AppClock.hpp"
+#include "../ControlCommand.hpp"
+#include "../MessageParsing.hpp"
+#include "../profiling/AllocationTracker.hpp"
+
+using namespace std;
+
+// Virtual time before the first observation, to let the arm settle
+static const double LEAD_IN = 1.0;
+
+// Virtual time after the last observation
+static const double LEAD_OUT = 1.5;
+
+// How close the operational point must come to count as an intercept
+static const double INTERCEPT_RADIUS = 0.10;
+
+// Check intercepts every this many ticks (1 ms)
+static const int INTERCEPT_CHECK_EVERY = 10;
+
+// Record the CPU time of every this many ticks
+static const int CPU_SAMPLE_EVERY = 50;
+
+// Scenario generation, as in ProjectileGenerator and projectile_test
+static const int SCENARIO_PROJECTILES = 6;
+static const double SCENARIO_SPACING = 1.5;
+static const Eigen::Vector3d P0_AVG(4.2, 0, .7);
+static const double V_AVG = 6.5;
+static const double THETA_AVG = M_PI / 4;
+static const double P0_STDDEV = 0.2;
+static const double V0_STDDEV = 0.2;
+static const double NOISE_STDDEV = 0.05;
+static const double CAMERA_DT = 1.0 / 30;
+static const double CAMERA_X_CUTOFF = 1.5;
+static const Eigen::Vector3d GRAVITY(0, 0, -9.81);
+
+class Delivery {
+public:
+  double t;     // Virtual time to deliver at
+  string msg;
+  bool command; // A ControlCommand rather than an observation
+};
+
+/**
+* Best known position of one projectile over time, for judging
+* intercepts: the noiseless trajectory for scenarios, the observations
+* themselves for sessions.
+*/
+class TruthTrack {
+public:
+  vector<double> t;
+  vector<Eigen::Vector3d> p;
+
+  bool live(double now) const { return !t.empty() && now >= t.front() && now <= t.back(); }
+
+  Eigen::Vector3d at(double now) const {
+    size_t i = upper_bound(t.begin(), t.end(), now) - t.begin();
+    if(i == 0) return p.front();
+    if(i == t.size()) return p.back();
+    double w = (now - t[i - 1]) / (t[i] - t[i - 1]);
+    return (1 - w) * p[i - 1] + w * p[i];
+  }
+};
+
+class CorpusEntry {
+public:
+  string name;
+  vector<Delivery> deliveries; // Sorted by time
+  map<int, TruthTrack> truth;
+};
+
+class ReplayResult {
+public:
+  string name;
+  long ticks;
+  int tracks;
+  int targeted;
+  int intercepted;
+  vector<double> reaction_ms;
+  vector<long> cpu_ns;
+  double cpu_mean_ns;
+  uint64_t allocations;
+  uint64_t rt_allocations;
+};
+
+static string formatMessage(int id, double t, const Eigen::Vector3d& p) {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%d %f %f %f %f", id, t, p(0), p(1), p(2));
+  return buf;
+}
+
+static bool loadSession(const string& file, CorpusEntry& e) {
+
+  ifstream in(file);
+  if(!in) return false;
+  e.name = "session:" + file;
+
+  // Commands carry the app's clock rather than the vision system's, so
+  // they are delivered with the observation recorded before them
+  vector<pair<ObservationMessage, string>> messages;
+  vector<pair<int, string>> commands; // Index of the preceding observation
+  string line;
+  ObservationMessage obs;
+  ControlCommand cmd;
+  while(getline(in, line)) {
+    if(parseObservationMessage(line, obs)) messages.push_back(make_pair(obs, line));
+    else if(parseCommandMessage(line, cmd))
+      commands.push_back(make_pair(static_cast<int>(messages.size()) - 1, line));
+  }
+  if(messages.empty()) return true;
+
+  double t_first = messages.front().first.t;
+  for(pair<ObservationMessage, string>& m : messages) {
+    double t = m.first.t - t_first + LEAD_IN;
+    e.deliveries.push_back({t, m.second, false});
+    TruthTrack& track = e.truth[m.first.id];
+    track.t.push_back(t);
+    track.p.push_back(Eigen::Vector3d(m.first.x, m.first.y, m.first.z));
+  }
+  for(pair<int, string>& c : commands) {
+    double t = (c.first < 0) ? LEAD_IN : e.deliveries[c.first].t;
+    e.deliveries.push_back({t, c.second, true});
+  }
+  stable_sort(e.deliveries.begin(), e.deliveries.end(),
+      [](const Delivery& a, const Delivery& b) { return a.t < b.t; });
+  return true;
+}
+
+static void makeScenario(unsigned seed, CorpusEntry& e) {
+
+  e.name = "scenario:" + to_string(seed);
+
+  default_random_engine generator(seed);
+  normal_distribution<double> normal(0.0, 1.0);
+  uniform_real_distribution<double> jitter(0.0, 0.5);
+
+  for(int id = 1; id <= SCENARIO_PROJECTILES; id++) {
+
+    double t0 = LEAD_IN + (id - 1) * SCENARIO_SPACING + jitter(generator);
+    Eigen::Vector3d p0 = P0_AVG;
+    Eigen::Vector3d v0(-V_AVG * cos(THETA_AVG), 0, V_AVG * sin(THETA_AVG));
+    for(int j = 0; j < 3; j++) p0(j) += normal(generator) * P0_STDDEV;
+    for(int j = 0; j < 3; j++) v0(j) += normal(generator) * V0_STDDEV;
+
+    TruthTrack& track = e.truth[id];
+    for(double dt = 0; ; dt += CAMERA_DT) {
+      Eigen::Vector3d p = p0 + v0 * dt + 0.5 * GRAVITY * dt * dt;
+
+      // Tracks end where the app would expire them
+      if(p(0) < X_EXPIRATION || p(2) < Z_EXPIRATION) break;
+      track.t.push_back(t0 + dt);
+      track.p.push_back(p);
+      if(p(0) >= CAMERA_X_CUTOFF) {
+        Eigen::Vector3d noise(normal(generator), normal(generator), normal(generator));
+        e.deliveries.push_back({t0 + dt, formatMessage(id, t0 + dt, p + noise * NOISE_STDDEV), false});
+      }
+    }
+  }
+
+  stable_sort(e.deliveries.begin(), e.deliveries.end(),
+      [](const Delivery& a, const Delivery& b) { return a.t < b.t; });
+}
+
+static bool loadCorpus(const string& file, vector<CorpusEntry>& corpus) {
+
+  ifstream in(file);
+  if(!in) return false;
+
+  string line;
+  while(getline(in, line)) {
+    stringstream ss(line);
+    string kind, arg;
+    if(!(ss >> kind) || kind[0] == '#') continue;
+    ss >> arg;
+    CorpusEntry e;
+    if(kind == "scenario") {
+      makeScenario(atoi(arg.c_str()), e);
+    } else if(kind == "session") {
+      if(!loadSession(arg, e)) {
+        cerr << "Could not read session " << arg << endl;
+        return false;
+      }
+    } else {
+      cerr << "Unknown corpus entry: " << line << endl;
+      return false;
+    }
+    corpus.push_back(e);
+  }
+  return true;
+}
+
+static long threadCpuNanos() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static ReplayResult replay(const CorpusEntry& e, const IronDomeConfig& config) {
+
+  ReplayResult r;
+  r.name = e.name;
+  r.ticks = 0;
+  r.tracks = e.truth.size();
+  r.targeted = 0;
+  r.intercepted = 0;
+
+  AppClock::setVirtual(0);
+
+  IronDomeApp app(config);
+  IronDomeAppBench bench(app);
+  app.setPaused(false);
+
+  const ReactionProbe& probe = app.getReactionProbe();
+  map<int, double> first_seen;
+  set<int> targeted, intercepted;
+  int last_selected = probe.selected_id;
+
+  double t_end = (e.deliveries.empty() ? LEAD_IN : e.deliveries.back().t) + LEAD_OUT;
+  size_t next = 0;
+  double cpu_total = 0;
+
+  uint64_t alloc_start, rt_alloc_start;
+  AllocationTracker::getThreadCounts(alloc_start, rt_alloc_start);
+
+  const double control_dt = IronDomeApp::getControlPeriod();
+  while(AppClock::now() < t_end) {
+
+    AppClock::advance(control_dt);
+    double now = AppClock::now();
+
+    while(next < e.deliveries.size() && e.deliveries[next].t <= now) {
+      const Delivery& d = e.deliveries[next++];
+      ControlCommand cmd;
+      if(d.command) {
+        if(parseCommandMessage(d.msg, cmd)) app.postCommand(cmd);
+        continue;
+      }
+      app.ingestObservation(d.msg);
+      ObservationMessage obs;
+      if(parseObservationMessage(d.msg, obs) && !first_seen.count(obs.id))
+        first_seen[obs.id] = now;
+    }
+
+    long cpu_start = threadCpuNanos();
+    bench.runControlTicks(1);
+    long cpu = threadCpuNanos() - cpu_start;
+    cpu_total += cpu;
+    if(r.ticks % CPU_SAMPLE_EVERY == 0) r.cpu_ns.push_back(cpu);
+    r.ticks++;
+
+    int selected = probe.selected_id;
+    if(selected != last_selected) {
+      last_selected = selected;
+      if(targeted.insert(selected).second && first_seen.count(selected))
+        r.reaction_ms.push_back(1e3 * (now - first_seen[selected]));
+    }
+
+    if(r.ticks % INTERCEPT_CHECK_EVERY == 0) {
+      Eigen::Vector3d x = bench.getOperationalPosition();
+      for(const pair<const int, TruthTrack>& track : e.truth)
+        if(track.second.live(now) && (track.second.at(now) - x).norm() < INTERCEPT_RADIUS)
+          intercepted.insert(track.first);
+    }
+  }
+
+  uint64_t alloc_end, rt_alloc_end;
+  AllocationTracker::getThreadCounts(alloc_end, rt_alloc_end);
+  r.allocations = alloc_end - alloc_start;
+  r.rt_allocations = rt_alloc_end - rt_alloc_start;
+
+  r.targeted = targeted.size();
+  r.intercepted = intercepted.size();
+  r.cpu_mean_ns = r.ticks > 0 ? cpu_total / r.ticks : 0;
+  return r;
+}
+
+static void writeJson(ostream& os, const string& label, const vector<ReplayResult>& results) {
+  os << "{\n  \"suite\": \"replay\",\n  \"label\": \"" << label << "\",\n"
+     << "  \"allocation_tracking\": " << (AllocationTracker::isAvailable() ? "true" : "false")
+     << ",\n  \"entries\": [\n";
+  for(size_t i = 0; i < results.size(); i++) {
+    const ReplayResult& r = results[i];
+    os << "    {\"name\": \"" << r.name << "\", \"ticks\": " << r.ticks
+       << ", \"tracks\": " << r.tracks << ", \"targeted\": " << r.targeted
+       << ", \"intercepted\": " << r.intercepted
+       << ", \"allocations\": " << r.allocations << ", \"rt_allocations\": " << r.rt_allocations
+       << ", \"cpu_mean_ns\": " << r.cpu_mean_ns << ",\n     \"reaction_ms\": [";
+    for(size_t j = 0; j < r.reaction_ms.size(); j++)
+      os << (j ? ", " : "") << r.reaction_ms[j];
+    os << "],\n     \"cpu_ns\": [";
+    for(size_t j = 0; j < r.cpu_ns.size(); j++)
+      os << (j ? ", " : "") << r.cpu_ns[j];
+    os << "]}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+
+  vector<CorpusEntry> corpus;
+  IronDomeConfig config;
+  config.graphics = false;
+  config.redis = false;
+  string label = "replay";
+  string json_file;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--corpus") && i + 1 < argc) {
+      if(!loadCorpus(argv[++i], corpus)) {
+        cerr << "Could not load corpus " << argv[i] << endl;
+        return 1;
+      }
+    } else if(!strcmp(argv[i], "--session") && i + 1 < argc) {
+      CorpusEntry e;
+      if(!loadSession(argv[++i], e)) {
+        cerr << "Could not read session " << argv[i] << endl;
+        return 1;
+      }
+      corpus.push_back(e);
+    } else if(!strcmp(argv[i], "--scenario") && i + 1 < argc) {
+      CorpusEntry e;
+      makeScenario(atoi(argv[++i]), e);
+      corpus.push_back(e);
+    }
+    else if(!strcmp(argv[i], "--label") && i + 1 < argc) label = argv[++i];
+    else if(!strcmp(argv[i], "--robot") && i + 1 < argc) config.robot = argv[++i];
+    else if(!strcmp(argv[i], "--controller") && i + 1 < argc) config.controller = argv[++i];
+    else if(!strcmp(argv[i], "--json") && i + 1 < argc) json_file = argv[++i];
+    else {
+      cerr << "Usage: " << argv[0] << " [--corpus file] [--session file]... [--scenario seed]..."
+           << " [--label name] [--robot name] [--controller name] [--json file]" << endl;
+      return 1;
+    }
+  }
+
+  if(corpus.empty()) {
+    cerr << "Nothing to replay." << endl;
+    return 1;
+  }
+
+  AllocationTracker::registerThread("replay");
+  if(AllocationTracker::isAvailable())
+    AllocationTracker::setMode(AllocationTracker::MODE_COUNT);
+
+  vector<ReplayResult> results;
+  for(const CorpusEntry& e : corpus) {
+    results.push_back(replay(e, config));
+    const ReplayResult& r = results.back();
+    cout << r.name << ": " << r.intercepted << "/" << r.tracks << " intercepted, "
+         << r.targeted << " targeted, " << r.ticks << " ticks, "
+         << r.cpu_mean_ns << " ns CPU per tick, "
+         << r.rt_allocations << " allocations in the control tick" << endl;
+  }
+
+  if(!json_file.empty()) {
+    ofstream out(json_file);
+    writeJson(out, label, results);
+    cout << "Wrote " << results.size() << " results to " << json_file << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,267 @@
+/**
+* tracker_scaling.cpp
+* -------------------
+* Scalability benchmark of ProjectileManager. For each combination of
+* track count and ingest thread count, the manager is seeded with that
+* many converged tracks. Ingest threads then stream observations into
+* it while reader threads query it like the control loop does. A reader
+* tick expires tracks (reader 0 only, as in controlsLoop), fetches the
+* active set, snapshots the tracks, and runs a position and intercept
+* query on each converged track.
+*
+* Reported per configuration:
+*
+*   seed      - new tracks registered per second, single threaded
+*   ingest    - observations per second over all ingest threads
+*   tick      - reader tick latency, and the tick rate actually reached
+*   wait      - time spent waiting for ProjectileManager::projectile_lock
+*
+* Usage:
+*
+*   ./tracker_scaling [--tracks 10,100,...] [--threads 1,2,4] [--readers R]
+*                     [--reader-hz HZ] [--seconds S] [--json file]
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "Benchmark.hpp"
+#include "../profiling/LatencyHistogram.hpp"
+#include "../profiling/ProfiledMutex.hpp"
+#include "../projectile/projectile.hpp"
+
+using namespace std;
+
+// Same as the control loop period
+static const double DEFAULT_READER_HZ = 10000;
+
+// Intercept sphere of the default robot
+static const Eigen::Vector3d SPHERE_POS(-.4, 0, 0.1);
+static const double SPHERE_RADIUS = 1.50;
+
+// Observations each track gets before the run, enough to converge
+static const int SEED_OBSERVATIONS = 3;
+
+typedef chrono::steady_clock Clock;
+
+static double nowSeconds() {
+  return chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+static uint64_t nanosSince(Clock::time_point t0) {
+  return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - t0).count();
+}
+
+static vector<int> parseList(const string& s) {
+  vector<int> values;
+  stringstream ss(s);
+  string item;
+  while(getline(ss, item, ','))
+    values.push_back(atoi(item.c_str()));
+  return values;
+}
+
+/**
+* Observation of track id. Tracks hover well inside the expiration
+* bounds, spread out so that their intercept queries differ.
+*/
+static void observe(ProjectileManager& manager, int id, double t) {
+  double x = 3.0 + 0.01 * (id % 100);
+  double y = -0.5 + 0.01 * ((id / 100) % 100);
+  double z = 5.0;
+  manager.addObservation(id, t, x, y, z);
+}
+
+class ScalingResult {
+public:
+  int tracks;
+  int ingest_threads;
+  int readers;
+  double seed_per_sec;
+  double ingest_per_sec;
+  double reader_hz;
+  uint64_t tick_p50, tick_p99, tick_max;
+  uint64_t wait_p50, wait_p99, wait_max;
+  double contended_fraction;
+};
+
+static ScalingResult runConfiguration(int tracks, int ingest_threads, int readers,
+    double reader_hz, double seconds) {
+
+  ScalingResult result;
+  result.tracks = tracks;
+  result.ingest_threads = ingest_threads;
+  result.readers = readers;
+
+  ProjectileManager manager;
+
+  // Seed the tracks; the first pass registers them
+  Clock::time_point t_seed = Clock::now();
+  for(int i = 0; i < SEED_OBSERVATIONS; i++)
+    for(int id = 0; id < tracks; id++)
+      observe(manager, id, nowSeconds());
+  result.seed_per_sec = tracks / (nanosSince(t_seed) / 1e9 / SEED_OBSERVATIONS);
+
+  ProfiledMutex::reset();
+  ProfiledMutex::setEnabled(true);
+
+  atomic<bool> stop(false);
+  atomic<uint64_t> ingested(0);
+  atomic<uint64_t> ticks(0);
+  LatencyHistogram tick_latency;
+
+  // Each ingest thread owns the IDs congruent to its index
+  vector<thread> threads;
+  for(int k = 0; k < ingest_threads; k++) {
+    threads.emplace_back([&, k]() {
+      uint64_t n = 0;
+      while(!stop.load(memory_order_relaxed)) {
+        for(int id = k; id < tracks && !stop.load(memory_order_relaxed); id += ingest_threads) {
+          observe(manager, id, nowSeconds());
+          n++;
+        }
+      }
+      ingested.fetch_add(n);
+    });
+  }
+
+  for(int r = 0; r < readers; r++) {
+    threads.emplace_back([&, r]() {
+      Clock::duration period = chrono::duration_cast<Clock::duration>(
+          chrono::duration<double>(1.0 / reader_hz));
+      Clock::time_point next = Clock::now();
+      while(!stop.load(memory_order_relaxed)) {
+
+        Clock::time_point t0 = Clock::now();
+        if(r == 0) manager.updateActiveProjectiles();
+        doNotOptimize(manager.getActiveProjectiles());
+
+        double now = nowSeconds();
+        vector<ProjectileSnapshot> snapshots = manager.getSnapshots();
+        for(const ProjectileSnapshot& s : snapshots) {
+          if(!s.converged) continue;
+          doNotOptimize(s.getPosition(now));
+          doNotOptimize(s.getIntersectionTime(SPHERE_POS, SPHERE_RADIUS));
+        }
+        tick_latency.record(nanosSince(t0));
+        ticks.fetch_add(1, memory_order_relaxed);
+
+        // Keep the schedule; an overrunning tick starts the next at once
+        next += period;
+        if(next > Clock::now()) this_thread::sleep_until(next);
+        else next = Clock::now();
+      }
+    });
+  }
+
+  Clock::time_point t_run = Clock::now();
+  this_thread::sleep_for(chrono::duration<double>(seconds));
+  stop = true;
+  for(thread& t : threads) t.join();
+  double elapsed = nanosSince(t_run) / 1e9;
+
+  ProfiledMutex::setEnabled(false);
+
+  result.ingest_per_sec = ingested / elapsed;
+  result.reader_hz = readers > 0 ? ticks / elapsed / readers : 0;
+  result.tick_p50 = tick_latency.percentile(0.50);
+  result.tick_p99 = tick_latency.percentile(0.99);
+  result.tick_max = tick_latency.max();
+
+  const LockStats& lock = ProfiledMutex::getStats("ProjectileManager::projectile_lock");
+  result.wait_p50 = lock.wait.percentile(0.50);
+  result.wait_p99 = lock.wait.percentile(0.99);
+  result.wait_max = lock.wait.max();
+  result.contended_fraction = lock.wait.count() > 0 ?
+      static_cast<double>(lock.contended.load()) / lock.wait.count() : 0;
+
+  return result;
+}
+
+static void writeJson(ostream& os, const vector<ScalingResult>& results,
+    double reader_hz, double seconds) {
+  os << "{\n"
+     << "  \"suite\": \"tracker_scaling\",\n"
+     << "  \"hardware_threads\": " << thread::hardware_concurrency() << ",\n"
+     << "  \"target_reader_hz\": " << reader_hz << ",\n"
+     << "  \"seconds\": " << seconds << ",\n"
+     << "  \"results\": [\n";
+  for(size_t i = 0; i < results.size(); i++) {
+    const ScalingResult& r = results[i];
+    os << "    {\"tracks\": " << r.tracks
+       << ", \"ingest_threads\": " << r.ingest_threads
+       << ", \"readers\": " << r.readers
+       << ", \"seed_per_sec\": " << r.seed_per_sec
+       << ", \"ingest_per_sec\": " << r.ingest_per_sec
+       << ", \"reader_hz\": " << r.reader_hz
+       << ", \"tick_ns\": {\"p50\": " << r.tick_p50 << ", \"p99\": " << r.tick_p99
+       << ", \"max\": " << r.tick_max << "}"
+       << ", \"wait_ns\": {\"p50\": " << r.wait_p50 << ", \"p99\": " << r.wait_p99
+       << ", \"max\": " << r.wait_max << "}"
+       << ", \"contended\": " << r.contended_fraction << "}"
+       << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+
+  vector<int> track_counts = {10, 100, 1000, 10000, 100000};
+  vector<int> thread_counts = {1, 2, 4};
+  int readers = 1;
+  double reader_hz = DEFAULT_READER_HZ;
+  double seconds = 2.0;
+  string json_file;
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--tracks") && i + 1 < argc) track_counts = parseList(argv[++i]);
+    else if(!strcmp(argv[i], "--threads") && i + 1 < argc) thread_counts = parseList(argv[++i]);
+    else if(!strcmp(argv[i], "--readers") && i + 1 < argc) readers = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--reader-hz") && i + 1 < argc) reader_hz = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+    else if(!strcmp(argv[i], "--json") && i + 1 < argc) json_file = argv[++i];
+    else {
+      cerr << "Usage: " << argv[0] << " [--tracks 10,100,...] [--threads 1,2,4]"
+           << " [--readers R] [--reader-hz HZ] [--seconds S] [--json file]" << endl;
+      return 1;
+    }
+  }
+
+  vector<ScalingResult> results;
+  for(int tracks : track_counts) {
+    for(int ingest_threads : thread_counts) {
+
+      ScalingResult r = runConfiguration(tracks, ingest_threads, readers, reader_hz, seconds);
+      results.push_back(r);
+
+      char line[256];
+      snprintf(line, sizeof(line),
+          "%7d tracks %2d ingest: seed %9.0f/s  ingest %9.0f/s  reader %7.0f Hz  "
+          "tick p50 %-9s p99 %-9s  wait p99 %-9s max %-9s  %.1f%% contended",
+          r.tracks, r.ingest_threads, r.seed_per_sec, r.ingest_per_sec, r.reader_hz,
+          LatencyHistogram::formatDuration(r.tick_p50).c_str(),
+          LatencyHistogram::formatDuration(r.tick_p99).c_str(),
+          LatencyHistogram::formatDuration(r.wait_p99).c_str(),
+          LatencyHistogram::formatDuration(r.wait_max).c_str(),
+          100 * r.contended_fraction);
+      cout << line << endl;
+    }
+  }
+
+  if(!json_file.empty()) {
+    ofstream out(json_file);
+    writeJson(out, results, reader_hz, seconds);
+    cout << "Wrote " << results.size() << " results to " << json_file << endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+/**
+* FrameCalibration.cpp
+* --------------------
+* Implementation of the FrameCalibration class.
+*/
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "FrameCalibration.hpp"
+
+using namespace std;
+
+static const int MIN_POINTS = 3;
+
+// Smallest spread of the sensor points across their principal direction,
+// relative to along it, that still fixes the rotation about it
+static const double MIN_SPREAD_RATIO = 1e-3;
+
+FrameCalibration::FrameCalibration() {
+  transform.setZero();
+  transform.leftCols<3>().setIdentity();
+}
+
+FrameCalibration FrameCalibration::fit(const vector<Eigen::Vector3d>& sensor,
+                                       const vector<Eigen::Vector3d>& robot,
+                                       bool with_scaling, CalibrationResiduals& residuals) {
+
+  if(sensor.size() != robot.size())
+    throw runtime_error("Calibration needs as many robot points as sensor points!");
+  if(sensor.size() < static_cast<size_t>(MIN_POINTS))
+    throw runtime_error("Calibration needs at least " + to_string(MIN_POINTS) + " points!");
+
+  int n = sensor.size();
+  Eigen::Matrix3Xd src(3, n), dst(3, n);
+  for(int i = 0; i < n; i++) {
+    src.col(i) = sensor[i];
+    dst.col(i) = robot[i];
+  }
+
+  // Points along a line leave the rotation about it free
+  Eigen::Matrix3Xd centered = src.colwise() - src.rowwise().mean();
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> scatter(centered * centered.transpose());
+  Eigen::Vector3d spread = scatter.eigenvalues().cwiseMax(0).cwiseSqrt(); // Ascending
+  if(!(spread(1) > MIN_SPREAD_RATIO * spread(2)))
+    throw runtime_error("Calibration points are too close to a line!");
+
+  Eigen::Matrix4d T = Eigen::umeyama(src, dst, with_scaling);
+
+  FrameCalibration calibration;
+  calibration.transform = T.topRows<3>();
+  residuals = calibration.evaluate(sensor, robot);
+  return calibration;
+}
+
+CalibrationResiduals FrameCalibration::evaluate(const vector<Eigen::Vector3d>& sensor,
+                                                const vector<Eigen::Vector3d>& robot) const {
+
+  CalibrationResiduals residuals;
+  residuals.n = min(sensor.size(), robot.size());
+  residuals.rms = residuals.mean = residuals.max = 0;
+  residuals.worst = -1;
+
+  double sum_sq = 0;
+  for(int i = 0; i < residuals.n; i++) {
+    double e = (apply(sensor[i]) - robot[i]).norm();
+    residuals.errors.push_back(e);
+    residuals.mean += e;
+    sum_sq += e * e;
+    if(e > residuals.max || residuals.worst < 0) {
+      residuals.max = e;
+      residuals.worst = i;
+    }
+  }
+
+  if(residuals.n > 0) {
+    residuals.mean /= residuals.n;
+    residuals.rms = sqrt(sum_sq / residuals.n);
+  }
+  return residuals;
+}
+
+bool FrameCalibration::load(const string& path) {
+
+  ifstream in(path);
+  if(!in) return false;
+
+  Eigen::Matrix<double, 3, 4> T;
+  int row = 0;
+  string line;
+  while(getline(in, line)) {
+    if(line.empty() || line[0] == '#') continue;
+    if(row == 3) return false;
+
+    stringstream ss(line);
+    for(int j = 0; j < 4; j++)
+      if(!(ss >> T(row, j)) || !isfinite(T(row, j))) return false;
+    string extra;
+    if(ss >> extra) return false;
+    row++;
+  }
+
+  if(row != 3 || T.leftCols<3>().determinant() <= 0) return false;
+  transform = T;
+  return true;
+}
+
+bool FrameCalibration::save(const string& path, const CalibrationResiduals& residuals) const {
+
+  ofstream out(path);
+  if(!out) return false;
+
+  out << "# Sensor frame to robot frame, [scale * R | p], fit to " << residuals.n << " points" << endl;
+  out << "# Residuals: rms " << residuals.rms << ", mean " << residuals.mean
+      << ", max " << residuals.max << " (point " << residuals.worst << ")" << endl;
+  out << "# Scale " << getScale() << endl;
+
+  out << setprecision(17);
+  for(int i = 0; i < 3; i++) {
+    for(int j = 0; j < 4; j++) out << (j ? " " : "") << transform(i, j);
+    out << endl;
+  }
+  return static_cast<bool>(out);
+}
+
+double FrameCalibration::getScale() const {
+  return cbrt(transform.leftCols<3>().determinant());
+}
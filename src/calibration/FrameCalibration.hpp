@@ -0,0 +1,100 @@
+/**
+* FrameCalibration.hpp
+* --------------------
+* Transform from the vision sensor's frame to the robot's frame, fit by
+* least squares to any number of points measured in both, and saved to
+* a file the app loads at startup.
+*
+*   std::vector<Eigen::Vector3d> sensor, robot;   // Same points, both frames
+*   CalibrationResiduals residuals;
+*   FrameCalibration calibration = FrameCalibration::fit(sensor, robot, false, residuals);
+*   calibration.save("calibration.txt", residuals);
+*
+*   FrameCalibration calibration;
+*   if(calibration.load("calibration.txt"))
+*     Eigen::Vector3d x = calibration.apply(x_sensor);
+*
+* The fit is Umeyama's closed form: the rotation, translation and
+* optionally uniform scale minimizing the sum of squared distances
+* between the transformed sensor points and the robot points.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+/**
+* How well a fit explains its own points, in robot frame units.
+*/
+class CalibrationResiduals {
+public:
+  int n;       // Points fit
+  double rms;  // Root mean square distance
+  double mean; // Mean distance
+  double max;  // Largest distance
+  int worst;   // Index of the point with the largest distance
+  std::vector<double> errors; // Distance of each point
+};
+
+class FrameCalibration {
+
+public:
+
+  /**
+  * The identity transform.
+  */
+  FrameCalibration();
+
+  /**
+  * Fit the transform taking each sensor point to the robot point at
+  * the same index. With with_scaling, also fit a uniform scale. Throws
+  * a runtime_error if there are fewer than three points, their counts
+  * differ, or they are too close to a line to fix a rotation.
+  */
+  static FrameCalibration fit(const std::vector<Eigen::Vector3d>& sensor,
+                              const std::vector<Eigen::Vector3d>& robot,
+                              bool with_scaling, CalibrationResiduals& residuals);
+
+  /**
+  * Distances between the transformed sensor points and the robot
+  * points.
+  */
+  CalibrationResiduals evaluate(const std::vector<Eigen::Vector3d>& sensor,
+                                const std::vector<Eigen::Vector3d>& robot) const;
+
+  /**
+  * Read a transform written by save(). Returns false if the file is
+  * missing or malformed, leaving this unchanged.
+  */
+  bool load(const std::string& path);
+
+  /**
+  * Write the transform, with the residuals of its fit as comments.
+  * Returns false if the file could not be written.
+  */
+  bool save(const std::string& path, const CalibrationResiduals& residuals) const;
+
+  /**
+  * Move a point from the sensor's frame to the robot's. Fixed-size, so
+  * Eigen unrolls and vectorizes it.
+  */
+  Eigen::Vector3d apply(const Eigen::Vector3d& x) const {
+    return transform.leftCols<3>() * x + transform.col(3);
+  }
+
+  /**
+  * Scaled rotation in the first three columns, translation in the last.
+  */
+  const Eigen::Matrix<double, 3, 4>& getTransform() const { return transform; }
+
+  /**
+  * Uniform scale, 1 unless fit with scaling.
+  */
+  double getScale() const;
+
+private:
+
+  Eigen::Matrix<double, 3, 4> transform;
+};
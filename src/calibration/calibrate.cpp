@@ -0,0 +1,112 @@
+/**
+* calibrate.cpp
+* -------------
+* Fits the transform from the vision sensor's frame to the robot's from
+* points measured in both, and writes it for the app to load.
+*
+*   ./calibrate points.txt --out calibration.txt
+*   ./iron_dome --calibration calibration.txt
+*
+* Each line of the points file holds one point, "sx sy sz rx ry rz":
+* where the sensor saw it, then where it is in the robot's frame. Lines
+* starting with # are skipped. Any number of points from three up can
+* be given; more, spread over the workspace, average out sensor noise.
+*/
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "FrameCalibration.hpp"
+
+using namespace std;
+
+static const string DEFAULT_OUTPUT = "calibration.txt";
+
+// Points this many times the RMS residual off are flagged as suspect
+static const double OUTLIER_FACTOR = 3.0;
+
+static bool readPoints(istream& in, vector<Eigen::Vector3d>& sensor,
+                       vector<Eigen::Vector3d>& robot) {
+
+  string line;
+  int line_num = 0;
+  while(getline(in, line)) {
+    line_num++;
+    if(line.find_first_not_of(" \t\r") == string::npos || line[0] == '#') continue;
+
+    stringstream ss(line);
+    Eigen::Vector3d s, r;
+    if(!(ss >> s(0) >> s(1) >> s(2) >> r(0) >> r(1) >> r(2))) {
+      cerr << "Line " << line_num << " is not \"sx sy sz rx ry rz\": " << line << endl;
+      return false;
+    }
+    sensor.push_back(s);
+    robot.push_back(r);
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+
+  string points_file, output = DEFAULT_OUTPUT;
+  bool with_scaling = false;
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--out") && i + 1 < argc) output = argv[++i];
+    else if(!strcmp(argv[i], "--scale")) with_scaling = true;
+    else if(argv[i][0] != '-' && points_file.empty()) points_file = argv[i];
+    else {
+      cerr << "Usage: " << argv[0] << " points.txt [--out file] [--scale]" << endl;
+      return 1;
+    }
+  }
+
+  // Points from the file, or standard input without one
+  vector<Eigen::Vector3d> sensor, robot;
+  bool ok;
+  if(points_file.empty()) {
+    ok = readPoints(cin, sensor, robot);
+  } else {
+    ifstream in(points_file);
+    if(!in) {
+      cerr << "Could not open " << points_file << "!" << endl;
+      return 1;
+    }
+    ok = readPoints(in, sensor, robot);
+  }
+  if(!ok) return 1;
+
+  CalibrationResiduals residuals;
+  FrameCalibration calibration;
+  try {
+    calibration = FrameCalibration::fit(sensor, robot, with_scaling, residuals);
+  } catch(const runtime_error& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  cout << fixed << setprecision(4);
+  cout << "Transform [scale * R | p]:" << endl << calibration.getTransform() << endl;
+  cout << "Scale " << calibration.getScale() << endl << endl;
+
+  cout << "Residuals of " << residuals.n << " points:" << endl;
+  for(int i = 0; i < residuals.n; i++) {
+    cout << setw(5) << i << setw(10) << residuals.errors[i];
+    if(residuals.errors[i] > OUTLIER_FACTOR * residuals.rms) cout << "  suspect";
+    cout << endl;
+  }
+  cout << "  rms " << residuals.rms << ", mean " << residuals.mean
+       << ", max " << residuals.max << " (point " << residuals.worst << ")" << endl;
+
+  if(!calibration.save(output, residuals)) {
+    cerr << "Could not write " << output << "!" << endl;
+    return 1;
+  }
+  cout << "Wrote " << output << "." << endl;
+  return 0;
+}
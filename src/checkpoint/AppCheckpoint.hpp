@@ -0,0 +1,41 @@
+/**
+* AppCheckpoint.hpp
+* -----------------
+* What the app saves to resume an engagement after a restart: the
+* controller's mode and setpoints, the simulated joint state, and every
+* track. Plain data with a fixed layout, written to a CheckpointFile;
+* bump CHECKPOINT_LAYOUT whenever it changes.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "../RobotState.hpp"
+#include "../projectile/projectile.hpp"
+#include "../projectile/SalvoEvaluator.hpp"
+
+static const uint32_t CHECKPOINT_LAYOUT = 2;
+
+class AppCheckpoint {
+public:
+  double t;        // App time it was taken at
+  int64_t wall_ns; // CLOCK_REALTIME at the same moment, to tell its age across runs
+  char robot[32];  // RobotProfile it was taken with, NUL-terminated
+
+  // Controller mode and setpoints
+  int32_t state;
+  int32_t target_id;
+  uint8_t paused, simulation, joint_space;
+  double x_d[3];
+  double R_d[9]; // Row-major
+  int32_t dof;
+  double q_d[MAX_DOF];
+
+  // Joint state, restored when simulating
+  double q[MAX_DOF], dq[MAX_DOF];
+
+  // Tracks come last, so only the first num_tracks need writing
+  int32_t num_tracks;
+  TrackCheckpoint tracks[MAX_SALVO_TRACKS];
+};
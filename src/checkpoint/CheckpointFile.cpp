@@ -0,0 +1,128 @@
+/**
+* CheckpointFile.cpp
+* ------------------
+* Implementation of the CheckpointFile class.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CheckpointFile.hpp"
+#include "../ostreamlock.hpp"
+
+using namespace std;
+
+static const uint32_t CHECKPOINT_MAGIC = 0x49444350; // "IDCP"
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t fnv1a(const void* data, size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  uint64_t h = FNV_OFFSET;
+  for(size_t i = 0; i < size; i++) {
+    h ^= bytes[i];
+    h *= FNV_PRIME;
+  }
+  return h;
+}
+
+/**
+* Bytes of saved worth writing: everything up to its last track.
+*/
+static size_t usedSize(const AppCheckpoint& saved) {
+  int n = saved.num_tracks;
+  if(n < 0) n = 0;
+  if(n > MAX_SALVO_TRACKS) n = MAX_SALVO_TRACKS;
+  return offsetof(AppCheckpoint, tracks) + n * sizeof(TrackCheckpoint);
+}
+
+bool CheckpointFile::open(const string& path) {
+
+  close();
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if(fd < 0) {
+    cerr << oslock << "Could not open checkpoint file " << path << "!" << endl << osunlock;
+    return false;
+  }
+
+  // A file of another size or layout is started over
+  struct stat st;
+  bool fresh = fstat(fd, &st) < 0 || st.st_size != (off_t)sizeof(File);
+  if(fresh && ftruncate(fd, 0) < 0) fresh = false;
+  if(fresh && ftruncate(fd, sizeof(File)) < 0) {
+    cerr << oslock << "Could not size checkpoint file " << path << "!" << endl << osunlock;
+    ::close(fd);
+    return false;
+  }
+
+  void* mem = mmap(NULL, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(mem == MAP_FAILED) {
+    cerr << oslock << "Could not map checkpoint file " << path << "!" << endl << osunlock;
+    return false;
+  }
+  file = static_cast<File*>(mem);
+
+  if(file->magic != CHECKPOINT_MAGIC || file->layout != CHECKPOINT_LAYOUT) {
+    for(Slot& slot : file->slots) slot.sequence = 0;
+    file->magic = CHECKPOINT_MAGIC;
+    file->layout = CHECKPOINT_LAYOUT;
+  }
+
+  sequence = max(file->slots[0].sequence, file->slots[1].sequence);
+  return true;
+}
+
+void CheckpointFile::close() {
+  if(!file) return;
+  munmap(file, sizeof(File));
+  file = NULL;
+}
+
+bool CheckpointFile::read(AppCheckpoint& saved) {
+
+  if(!file) return false;
+
+  // Newest first
+  int order[2] = {0, 1};
+  if(file->slots[1].sequence > file->slots[0].sequence) swap(order[0], order[1]);
+
+  for(int i : order) {
+    const Slot& slot = file->slots[i];
+    if(slot.sequence == 0 || slot.size > sizeof(AppCheckpoint)) continue;
+    if(fnv1a(&slot.data, slot.size) != slot.checksum) continue;
+    if(slot.size != usedSize(slot.data)) continue;
+    memcpy(static_cast<void*>(&saved), &slot.data, slot.size);
+    return true;
+  }
+  return false;
+}
+
+void CheckpointFile::write(const AppCheckpoint& saved) {
+
+  if(!file) return;
+
+  Slot& slot = file->slots[(sequence + 1) & 1];
+  size_t size = usedSize(saved);
+
+  // Invalidate the slot before touching it, and validate it last
+  slot.sequence = 0;
+  atomic_thread_fence(memory_order_release);
+  memcpy(static_cast<void*>(&slot.data), &saved, size);
+  slot.size = size;
+  slot.checksum = fnv1a(&slot.data, size);
+  atomic_thread_fence(memory_order_release);
+  slot.sequence = ++sequence;
+
+  // Start it towards the disk without waiting
+  msync(file, sizeof(File), MS_ASYNC);
+}
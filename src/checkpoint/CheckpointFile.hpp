@@ -0,0 +1,74 @@
+/**
+* CheckpointFile.hpp
+* ------------------
+* A memory-mapped file holding the latest AppCheckpoint, which survives
+* the process being killed at any point.
+*
+*   CheckpointFile file;
+*   file.open("iron_dome.ckpt");
+*   if(file.read(saved)) resume(saved);   // at startup
+*   file.write(current);                  // periodically
+*
+* The file has two slots and writes alternate between them. A slot is
+* marked invalid while it is being written and carries a checksum of
+* its contents, so a write cut short leaves the other slot to read.
+* Writes land in the page cache, which outlives the process; they reach
+* the disk in the background.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "AppCheckpoint.hpp"
+
+class CheckpointFile {
+
+public:
+
+  CheckpointFile() : file(NULL), sequence(0) {}
+  ~CheckpointFile() { close(); }
+
+  /**
+  * Map the file at path, creating it if needed. Returns false on
+  * failure.
+  */
+  bool open(const std::string& path);
+  void close();
+  bool isOpen() const { return file != NULL; }
+
+  /**
+  * The newest complete checkpoint into saved. Returns false if there is
+  * none.
+  */
+  bool read(AppCheckpoint& saved);
+
+  /**
+  * Save a checkpoint over the older slot.
+  */
+  void write(const AppCheckpoint& saved);
+
+private:
+
+  class Slot {
+  public:
+    uint64_t sequence; // 0 while invalid
+    uint64_t size;     // Bytes of data in use
+    uint64_t checksum; // Of those bytes
+    AppCheckpoint data;
+  };
+
+  class File {
+  public:
+    uint32_t magic;
+    uint32_t layout;
+    Slot slots[2];
+  };
+
+  File* file;
+  uint64_t sequence; // Of the newest slot
+
+  CheckpointFile(const CheckpointFile&);
+  CheckpointFile& operator=(const CheckpointFile&);
+};
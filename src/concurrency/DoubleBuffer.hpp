@@ -0,0 +1,114 @@
+/**
+* DoubleBuffer.hpp
+* ----------------
+* Publishes a value from one writer thread to any number of readers
+* without locks. The writer never waits; a reader always gets a complete
+* copy of one published value, never a mix of two.
+*
+*   DoubleBuffer<SensedState> sensed;
+*   sensed.write(state);              // writer thread, every tick
+*   SensedState s = sensed.read();    // any other thread
+*
+* Values alternate between two slots, each guarded by a sequence number
+* that is odd while the slot is being written. A reader copies the slot
+* holding the latest value and retries only if the writer came back
+* around to that slot during the copy, i.e. if the copy took longer than
+* a whole write period.
+*
+* T is copied as raw words, so it must be plain data: scalars and
+* fixed-size or fixed-capacity Eigen types, nothing that owns heap
+* memory. Writes from more than one thread must be serialized by the
+* caller.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+template<typename T>
+class DoubleBuffer {
+
+public:
+
+  explicit DoubleBuffer(const T& initial = T()) : writes(0) {
+    for(Slot& s : slots) s.seq.store(0, std::memory_order_relaxed);
+    write(initial);
+  }
+
+  /**
+  * Publish a new value. Wait-free.
+  */
+  void write(const T& value) {
+
+    uint64_t words[NUM_WORDS];
+    words[NUM_WORDS - 1] = 0;
+    memcpy(words, &value, sizeof(T));
+
+    uint64_t n = writes.load(std::memory_order_relaxed) + 1;
+    Slot& s = slots[n & 1];
+
+    uint64_t seq = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for(size_t i = 0; i < NUM_WORDS; i++)
+      s.words[i].store(words[i], std::memory_order_relaxed);
+
+    s.seq.store(seq + 2, std::memory_order_release);
+    writes.store(n, std::memory_order_release);
+  }
+
+  /**
+  * Copy of the most recently published value.
+  */
+  T read() const {
+    T value;
+    read(value);
+    return value;
+  }
+
+  void read(T& value) const {
+
+    uint64_t words[NUM_WORDS];
+    while(true) {
+      const Slot& s = slots[writes.load(std::memory_order_acquire) & 1];
+
+      uint64_t seq = s.seq.load(std::memory_order_acquire);
+      if(seq & 1) continue;
+
+      for(size_t i = 0; i < NUM_WORDS; i++)
+        words[i] = s.words[i].load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(s.seq.load(std::memory_order_relaxed) == seq) break;
+    }
+    memcpy(static_cast<void*>(&value), words, sizeof(T));
+  }
+
+  /**
+  * Number of values written so far, including the initial one. Readers
+  * can compare it to the last count they saw to tell whether anything
+  * new was published.
+  */
+  uint64_t version() const {
+    return writes.load(std::memory_order_acquire);
+  }
+
+private:
+
+  static const size_t NUM_WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  class Slot {
+  public:
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[NUM_WORDS];
+  };
+
+  Slot slots[2];
+  std::atomic<uint64_t> writes;
+
+  DoubleBuffer(const DoubleBuffer&);
+  DoubleBuffer& operator=(const DoubleBuffer&);
+};
@@ -0,0 +1,56 @@
+/**
+* EventNotifier.cpp
+* -----------------
+* Implementation of the EventNotifier class.
+*/
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "EventNotifier.hpp"
+
+using namespace std;
+
+EventNotifier::EventNotifier() {
+  event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(event_fd < 0)
+    throw runtime_error(string("Could not create eventfd: ") + strerror(errno));
+}
+
+EventNotifier::~EventNotifier() {
+  close(event_fd);
+}
+
+void EventNotifier::notify() {
+  // Only fails if the counter would overflow, in which case an event
+  // is already pending
+  uint64_t one = 1;
+  ssize_t n = write(event_fd, &one, sizeof(one));
+  (void) n;
+}
+
+bool EventNotifier::consume() {
+  uint64_t count;
+  return read(event_fd, &count, sizeof(count)) == sizeof(count);
+}
+
+bool EventNotifier::wait(double timeout) {
+
+  if(consume()) return true;
+
+  pollfd p;
+  p.fd = event_fd;
+  p.events = POLLIN;
+  p.revents = 0;
+
+  int timeout_ms = static_cast<int>(timeout * 1000);
+  if(poll(&p, 1, timeout_ms) <= 0) return false;
+  return consume();
+}
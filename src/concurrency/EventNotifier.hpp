@@ -0,0 +1,54 @@
+/**
+* EventNotifier.hpp
+* -----------------
+* Wakes a thread sleeping on it as soon as another thread reports an
+* event. Built on a Linux eventfd, so notifications that arrive while
+* nobody is waiting are kept and coalesced, and the descriptor can also
+* be watched by poll() or an event loop.
+*
+*   EventNotifier updates;
+*   updates.notify();        // producer, e.g. after each observation
+*   updates.wait(0.05);      // consumer, returns early when notified
+*/
+
+#pragma once
+
+class EventNotifier {
+
+public:
+
+  /**
+  * Throws a runtime_error if the eventfd cannot be created.
+  */
+  EventNotifier();
+  ~EventNotifier();
+
+  /**
+  * Report an event. Safe from any thread; never blocks.
+  */
+  void notify();
+
+  /**
+  * Sleep until notified, or for at most timeout seconds. Returns
+  * whether there was a notification, and clears all pending ones.
+  */
+  bool wait(double timeout);
+
+  /**
+  * Clear pending notifications without sleeping. Returns whether there
+  * were any.
+  */
+  bool consume();
+
+  /**
+  * Descriptor that is readable while a notification is pending.
+  */
+  int fd() const { return event_fd; }
+
+private:
+
+  int event_fd;
+
+  EventNotifier(const EventNotifier&);
+  EventNotifier& operator=(const EventNotifier&);
+};
@@ -0,0 +1,101 @@
+/**
+* Mailbox.hpp
+* -----------
+* Bounded multi-producer, single-consumer queue. Any number of threads
+* may post; one thread takes. Posting is lock-free and fails instead of
+* waiting when the mailbox is full. Taking is wait-free, so the consumer
+* can drain it from a real-time loop.
+*
+*   Mailbox<ControlCommand, 256> commands;
+*   commands.post(cmd);                  // any thread
+*   while(commands.take(cmd)) apply(cmd); // consumer thread only
+*
+* Each cell carries a sequence number that says whether it is free for
+* the producer whose turn it is, or holds a value for the consumer
+* (D. Vyukov's bounded queue, specialized to one consumer). Values are
+* copied in and out by assignment, so T should not allocate when copied
+* if the consumer must not.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+template<typename T, size_t CAPACITY>
+class Mailbox {
+
+  static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0,
+      "Mailbox capacity must be a power of two");
+
+public:
+
+  Mailbox() : head(0), tail(0) {
+    for(size_t i = 0; i < CAPACITY; i++)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  /**
+  * Add a value. Returns false if the mailbox is full.
+  */
+  bool post(const T& value) {
+
+    Cell* cell;
+    size_t pos = tail.load(std::memory_order_relaxed);
+    while(true) {
+      cell = &cells[pos & (CAPACITY - 1)];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if(diff == 0) {
+        if(tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if(diff < 0) {
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = value;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+  * Remove the oldest value into value. Returns false if there is none,
+  * or if the producer of the oldest one has not finished posting it.
+  * Call from the consumer thread only.
+  */
+  bool take(T& value) {
+
+    Cell& cell = cells[head & (CAPACITY - 1)];
+    if(cell.seq.load(std::memory_order_acquire) != head + 1) return false;
+
+    value = cell.value;
+    cell.seq.store(head + CAPACITY, std::memory_order_release);
+    head++;
+    return true;
+  }
+
+  static size_t capacity() { return CAPACITY; }
+
+private:
+
+  class Cell {
+  public:
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  Cell cells[CAPACITY];
+
+  // Consumer position, only touched by the consumer
+  size_t head;
+
+  // Producer position, on its own cache line so that posting does not
+  // slow down the consumer
+  alignas(64) std::atomic<size_t> tail;
+
+  Mailbox(const Mailbox&);
+  Mailbox& operator=(const Mailbox&);
+};
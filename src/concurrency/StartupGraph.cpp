@@ -0,0 +1,125 @@
+/**
+* StartupGraph.cpp
+* ----------------
+* Implementation of the StartupGraph class.
+*/
+
+#include <iomanip>
+#include <stdexcept>
+
+#include "StartupGraph.hpp"
+#include "../profiling/LatencyHistogram.hpp"
+
+using namespace std;
+
+static uint64_t nanosBetween(chrono::steady_clock::time_point a,
+                             chrono::steady_clock::time_point b) {
+  return chrono::duration_cast<chrono::nanoseconds>(b - a).count();
+}
+
+void StartupGraph::add(const string& name, const vector<string>& deps, Step fn) {
+
+  if(findNode(name) >= 0) throw runtime_error("Startup step " + name + " added twice!");
+
+  unique_ptr<Node> node(new Node());
+  node->name = name;
+  node->fn = move(fn);
+  node->state = WAITING;
+  for(const string& dep : deps) {
+    int i = findNode(dep);
+    if(i < 0) throw runtime_error("Startup step " + name + " depends on unknown step " + dep + "!");
+    node->deps.push_back(i);
+  }
+  nodes.push_back(move(node));
+}
+
+void StartupGraph::run() {
+
+  run_start = chrono::steady_clock::now();
+
+  {
+    unique_lock<mutex> ul(lock);
+    launchReady();
+    finished.wait(ul, [this]() { return running == 0; });
+  }
+  for(thread& t : threads) t.join();
+  threads.clear();
+
+  run_end = chrono::steady_clock::now();
+  if(error) rethrow_exception(error);
+}
+
+void StartupGraph::launchReady() {
+
+  for(size_t i = 0; i < nodes.size(); i++) {
+    Node& node = *nodes[i];
+    if(node.state != WAITING) continue;
+
+    bool ready = true;
+    for(int dep : node.deps) {
+      if(nodes[dep]->state == FAILED || nodes[dep]->state == SKIPPED) node.state = SKIPPED;
+      if(nodes[dep]->state != DONE) ready = false;
+    }
+
+    // After a failure, nothing new starts
+    if(error) node.state = SKIPPED;
+    if(!ready || node.state == SKIPPED) continue;
+
+    node.state = RUNNING;
+    running++;
+    threads.push_back(thread(&StartupGraph::runNode, this, i));
+  }
+}
+
+void StartupGraph::runNode(int i) {
+
+  Node& node = *nodes[i];
+  node.start = chrono::steady_clock::now();
+
+  exception_ptr step_error;
+  try {
+    node.fn();
+  } catch(...) {
+    step_error = current_exception();
+  }
+
+  lock_guard<mutex> lg(lock);
+  node.end = chrono::steady_clock::now();
+  if(step_error) {
+    if(!error) error = step_error;
+    node.state = FAILED;
+  } else {
+    node.state = DONE;
+  }
+
+  launchReady();
+  if(--running == 0) finished.notify_all();
+}
+
+int StartupGraph::findNode(const string& name) const {
+  for(size_t i = 0; i < nodes.size(); i++) {
+    if(nodes[i]->name == name) return i;
+  }
+  return -1;
+}
+
+void StartupGraph::printReport(ostream& out) const {
+
+  uint64_t sum = 0;
+  out << "Startup:" << endl;
+  for(const unique_ptr<Node>& node : nodes) {
+    out << "  " << left << setw(16) << node->name << right;
+    if(node->state != DONE) {
+      out << setw(9) << (node->state == FAILED ? "failed" : "-") << endl;
+      continue;
+    }
+    uint64_t ns = nanosBetween(node->start, node->end);
+    sum += ns;
+    out << setw(9) << LatencyHistogram::formatDuration(ns)
+        << "  (from " << LatencyHistogram::formatDuration(nanosBetween(run_start, node->start))
+        << ")" << endl;
+  }
+  out << "  " << left << setw(16) << "total" << right
+      << setw(9) << LatencyHistogram::formatDuration(nanosBetween(run_start, run_end))
+      << "  (steps sum to " << LatencyHistogram::formatDuration(sum) << ")" << endl;
+}
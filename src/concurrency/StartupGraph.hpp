@@ -0,0 +1,89 @@
+/**
+* StartupGraph.hpp
+* ----------------
+* Initialization steps and what each depends on, run with as much
+* concurrency as the dependencies allow, and timed.
+*
+*   StartupGraph startup;
+*   startup.add("spec", {}, [&]() { parseSpec(); });
+*   startup.add("dynamics", {"spec"}, [&]() { initDynamics(); });
+*   startup.add("graphics", {"spec"}, [&]() { initGraphics(); });
+*   startup.run();                 // dynamics and graphics overlap
+*   startup.printReport(cout);
+*
+* Each step runs on a thread of its own once all of its dependencies
+* have finished. Steps report failure by throwing; run() waits for the
+* steps already started, skips the rest, and rethrows the first error.
+* Optional subsystems are simply not added when disabled.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StartupGraph {
+
+public:
+
+  typedef std::function<void()> Step;
+
+  StartupGraph() : running(0) {}
+
+  /**
+  * Add a step. Its dependencies must already have been added, which
+  * also rules out cycles. Throws a runtime_error otherwise.
+  */
+  void add(const std::string& name, const std::vector<std::string>& deps, Step fn);
+
+  /**
+  * Run every step, returning when all have finished. Throws the first
+  * error a step threw.
+  */
+  void run();
+
+  /**
+  * Time each step took, and the wall time of run() against their sum.
+  */
+  void printReport(std::ostream& out) const;
+
+private:
+
+  enum State { WAITING, RUNNING, DONE, FAILED, SKIPPED };
+
+  class Node {
+  public:
+    std::string name;
+    std::vector<int> deps;
+    Step fn;
+    State state;
+    std::chrono::steady_clock::time_point start, end;
+  };
+
+  int findNode(const std::string& name) const;
+
+  /**
+  * Start every waiting step whose dependencies are done. Call with
+  * lock held.
+  */
+  void launchReady();
+  void runNode(int i);
+
+  std::vector<std::unique_ptr<Node>> nodes;
+  std::vector<std::thread> threads;
+
+  std::mutex lock;
+  std::condition_variable finished;
+  int running;
+  std::exception_ptr error;
+
+  std::chrono::steady_clock::time_point run_start, run_end;
+};
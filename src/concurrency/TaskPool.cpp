@@ -0,0 +1,185 @@
+/**
+* TaskPool.cpp
+* ------------
+* Implementation of the TaskPool class.
+*/
+
+#include <string>
+
+#include "ThreadSupervisor.hpp"
+#include "TaskPool.hpp"
+
+using namespace std;
+
+TaskPool::TaskPool(int num_workers, const vector<int>& cpus) :
+    stopping(false), next_worker(0), work_signals(0) {
+
+  for(int i = 0; i < num_workers; i++)
+    workers.push_back(unique_ptr<Worker>(new Worker()));
+
+  // Start the threads only once every queue exists, since they steal
+  for(int i = 0; i < num_workers; i++) {
+    int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+    workers[i]->thread = thread(&TaskPool::workerLoop, this, i, cpu);
+  }
+}
+
+TaskPool::~TaskPool() {
+  stopping.store(true);
+  signalWork(true);
+  for(unique_ptr<Worker>& w : workers)
+    if(w->thread.joinable()) w->thread.join();
+}
+
+bool TaskPool::submit(Task* task) {
+
+  if(workers.empty()) return false;
+
+  unsigned start = next_worker.fetch_add(1, memory_order_relaxed);
+  for(size_t i = 0; i < workers.size(); i++) {
+    if(push(*workers[(start + i) % workers.size()], task)) {
+      signalWork(false);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskPool::LoopHelper::runChunk() {
+
+  size_t chunk = next_chunk.fetch_add(1, memory_order_relaxed);
+  if(chunk >= num_chunks) return false;
+
+  size_t begin = chunk * chunk_size;
+  size_t end = (chunk == num_chunks - 1) ? n : begin + chunk_size;
+  (*body)(begin, end);
+  return true;
+}
+
+void TaskPool::LoopHelper::run() {
+  while(runChunk()) {}
+
+  // The caller may return and destroy this helper right after this
+  running.fetch_sub(1, memory_order_release);
+}
+
+void TaskPool::runLoop(size_t n, size_t grain, const RangeBody& body) {
+
+  if(n == 0) return;
+
+  LoopHelper helper;
+  helper.body = &body;
+  helper.n = n;
+  helper.chunk_size = (grain > 0) ? grain : 1;
+  helper.num_chunks = (n + helper.chunk_size - 1) / helper.chunk_size;
+  helper.next_chunk.store(0, memory_order_relaxed);
+  helper.running.store(0, memory_order_relaxed);
+
+  if(workers.empty() || helper.num_chunks == 1) {
+    body(0, n);
+    return;
+  }
+
+  // One helper per worker that could have a chunk to itself. Each one
+  // is counted before it is queued, so that it cannot finish first.
+  size_t num_helpers = min(workers.size(), helper.num_chunks - 1);
+  unsigned start = next_worker.fetch_add(1, memory_order_relaxed);
+  for(size_t i = 0; i < num_helpers; i++) {
+    helper.running.fetch_add(1, memory_order_relaxed);
+    if(!push(*workers[(start + i) % workers.size()], &helper))
+      helper.running.fetch_sub(1, memory_order_relaxed);
+  }
+  signalWork(true);
+
+  while(helper.runChunk()) {}
+
+  // Every chunk is claimed. Take back the helpers no worker got to, and
+  // wait for the rest to finish the chunks they claimed.
+  for(unique_ptr<Worker>& w : workers)
+    helper.running.fetch_sub(cancel(*w, &helper), memory_order_relaxed);
+  while(helper.running.load(memory_order_acquire) > 0)
+    this_thread::yield();
+}
+
+bool TaskPool::push(Worker& w, Task* task) {
+  lock_guard<mutex> lg(w.m);
+  if(w.tail - w.head == QUEUE_SIZE) return false;
+  w.queue[w.tail++ % QUEUE_SIZE] = task;
+  return true;
+}
+
+Task* TaskPool::popNewest(Worker& w) {
+  lock_guard<mutex> lg(w.m);
+  while(w.tail != w.head) {
+    Task* task = w.queue[--w.tail % QUEUE_SIZE];
+    if(task) return task;
+  }
+  return nullptr;
+}
+
+Task* TaskPool::stealOldest(Worker& w) {
+  lock_guard<mutex> lg(w.m);
+  while(w.head != w.tail) {
+    Task* task = w.queue[w.head++ % QUEUE_SIZE];
+    if(task) return task;
+  }
+  return nullptr;
+}
+
+int TaskPool::cancel(Worker& w, Task* task) {
+  lock_guard<mutex> lg(w.m);
+  int count = 0;
+  for(size_t i = w.head; i != w.tail; i++) {
+    if(w.queue[i % QUEUE_SIZE] == task) {
+      w.queue[i % QUEUE_SIZE] = nullptr;
+      count++;
+    }
+  }
+
+  // Drop cleared slots at either end so they do not fill the queue
+  while(w.tail != w.head && !w.queue[(w.tail - 1) % QUEUE_SIZE]) w.tail--;
+  while(w.head != w.tail && !w.queue[w.head % QUEUE_SIZE]) w.head++;
+  return count;
+}
+
+void TaskPool::signalWork(bool all) {
+
+  // Counted under the lock, so a worker between finding its queues empty
+  // and going to sleep sees it and looks again
+  {
+    lock_guard<mutex> lg(sleep_lock);
+    work_signals++;
+  }
+  if(all) wake.notify_all();
+  else wake.notify_one();
+}
+
+void TaskPool::workerLoop(int index, int cpu) {
+
+  ThreadSpec spec("pool-" + to_string(index));
+  spec.cpu = cpu;
+  spec.applyToThisThread();
+
+  Worker& own = *workers[index];
+  while(!stopping.load(memory_order_relaxed)) {
+
+    uint64_t signals;
+    {
+      lock_guard<mutex> lg(sleep_lock);
+      signals = work_signals;
+    }
+
+    Task* task = popNewest(own);
+    for(size_t i = 1; !task && i < workers.size(); i++)
+      task = stealOldest(*workers[(index + i) % workers.size()]);
+
+    if(task) {
+      task->run();
+      continue;
+    }
+
+    // Sleep until something is queued; nothing else can make work appear
+    unique_lock<mutex> lk(sleep_lock);
+    wake.wait(lk, [&]() { return work_signals != signals; });
+  }
+}
@@ -0,0 +1,155 @@
+/**
+* TaskPool.hpp
+* ------------
+* Small work-stealing thread pool for splitting independent work, such
+* as evaluating every tracked projectile, across the cores that the
+* real-time loops do not use.
+*
+*   TaskPool pool(3, {1, 2, 3});
+*   pool.parallelFor(tracks.size(), 1, [&](size_t begin, size_t end) {
+*     for(size_t i = begin; i < end; i++) evaluate(tracks[i]);
+*   });
+*
+* Each worker has its own queue. It takes its newest task first and,
+* when its queue is empty, steals the oldest task from another worker.
+*
+* parallelFor() splits a range into chunks, which workers and the
+* calling thread claim one at a time. The caller only ever runs chunks
+* of its own loop, never unrelated queued tasks, and neither the queues
+* nor parallelFor() allocate. It can therefore be called from the
+* control loop: with the pool busy, the caller simply runs all the
+* chunks itself.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+* Unit of work for TaskPool::submit(). The caller owns it and must keep
+* it alive until run() returns.
+*/
+class Task {
+public:
+  virtual ~Task() {}
+  virtual void run() = 0;
+};
+
+class TaskPool {
+
+public:
+
+  /**
+  * Start num_workers workers, named "pool-0" and so on. Worker i is
+  * pinned to cpus[i % cpus.size()] if cpus is not empty. A pool with no
+  * workers runs everything on the calling thread.
+  */
+  explicit TaskPool(int num_workers, const std::vector<int>& cpus = std::vector<int>());
+
+  /**
+  * Stops the workers once their current tasks finish. Tasks still
+  * queued are not run.
+  */
+  ~TaskPool();
+
+  int numWorkers() const { return workers.size(); }
+
+  /**
+  * Queue a task to run on some worker. Returns false, without queueing
+  * it, if the pool has no workers or the queues are full.
+  */
+  bool submit(Task* task);
+
+  /**
+  * Call fn(begin, end) over consecutive chunks of [0, n), each at least
+  * grain long, spread over the workers and the calling thread. Returns
+  * once every chunk has run.
+  */
+  template<typename F>
+  void parallelFor(size_t n, size_t grain, const F& fn) {
+    RangeFunction<F> body(fn);
+    runLoop(n, grain, body);
+  }
+
+private:
+
+  // Tasks each worker can have queued
+  static const size_t QUEUE_SIZE = 256;
+
+  class RangeBody {
+  public:
+    virtual ~RangeBody() {}
+    virtual void operator()(size_t begin, size_t end) const = 0;
+  };
+
+  template<typename F>
+  class RangeFunction : public RangeBody {
+  public:
+    explicit RangeFunction(const F& fn) : fn(fn) {}
+    void operator()(size_t begin, size_t end) const { fn(begin, end); }
+  private:
+    const F& fn;
+  };
+
+  /**
+  * The chunks of one parallelFor. The same helper task is queued on
+  * several workers; each run of it claims chunks until none are left.
+  */
+  class LoopHelper : public Task {
+  public:
+    void run();
+    bool runChunk();
+
+    const RangeBody* body;
+    size_t n, chunk_size, num_chunks;
+    std::atomic<size_t> next_chunk;
+    std::atomic<int> running; // Queued or running copies of this helper
+  };
+
+  class Worker {
+  public:
+    Worker() : head(0), tail(0) {}
+
+    std::mutex m;
+    Task* queue[QUEUE_SIZE]; // Ring buffer, head is the oldest
+    size_t head, tail;
+    std::thread thread;
+  };
+
+  void runLoop(size_t n, size_t grain, const RangeBody& body);
+
+  bool push(Worker& w, Task* task);
+  Task* popNewest(Worker& w);
+  Task* stealOldest(Worker& w);
+
+  /**
+  * Clear every queued copy of task from w. Returns how many there were.
+  */
+  int cancel(Worker& w, Task* task);
+
+  /**
+  * Wake one idle worker, or all of them, after queueing tasks.
+  */
+  void signalWork(bool all);
+
+  void workerLoop(int index, int cpu);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<bool> stopping;
+  std::atomic<unsigned> next_worker; // Round robin for submit()
+
+  // Idle workers sleep here until tasks are queued or the pool stops
+  std::mutex sleep_lock;
+  std::condition_variable wake;
+  uint64_t work_signals; // Guarded by sleep_lock, bumped by signalWork()
+
+  TaskPool(const TaskPool&);
+  TaskPool& operator=(const TaskPool&);
+};
@@ -0,0 +1,247 @@
+/**
+* ThreadSupervisor.cpp
+* --------------------
+* Implementation of the ThreadSupervisor class.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "../ostreamlock.hpp"
+#include "ThreadSupervisor.hpp"
+
+using namespace std;
+
+// Linux limits thread names to 15 characters plus the terminator
+static const size_t MAX_THREAD_NAME = 15;
+
+void StopToken::requestStop() {
+  {
+    lock_guard<mutex> lg(m);
+    stop.store(true, memory_order_release);
+  }
+  cv.notify_all();
+}
+
+bool StopToken::waitFor(double seconds) {
+  unique_lock<mutex> lk(m);
+  return cv.wait_for(lk, chrono::duration<double>(seconds), [this]() { return stopRequested(); });
+}
+
+void StopToken::wait() {
+  unique_lock<mutex> lk(m);
+  cv.wait(lk, [this]() { return stopRequested(); });
+}
+
+static bool parsePolicy(const string& s, int& policy) {
+  if(s == "other") policy = SCHED_OTHER;
+  else if(s == "fifo") policy = SCHED_FIFO;
+  else if(s == "rr") policy = SCHED_RR;
+  else return false;
+  return true;
+}
+
+static string policyName(int policy) {
+  if(policy == SCHED_FIFO) return "fifo";
+  if(policy == SCHED_RR) return "rr";
+  return "other";
+}
+
+bool ThreadSpec::parse(const string& setting, ThreadSpec& spec) {
+
+  stringstream ss(setting);
+  string field;
+  if(!getline(ss, field, ':') || field.empty()) return false;
+  spec.name = field;
+
+  bool has_priority = false;
+  while(getline(ss, field, ':')) {
+    size_t eq = field.find('=');
+    if(eq == string::npos) return false;
+    string key = field.substr(0, eq);
+    string value = field.substr(eq + 1);
+
+    char* end;
+    if(key == "cpu") {
+      spec.cpu = strtol(value.c_str(), &end, 10);
+      if(*end || value.empty() || spec.cpu < -1) return false;
+    } else if(key == "policy") {
+      if(!parsePolicy(value, spec.policy)) return false;
+    } else if(key == "priority") {
+      spec.priority = strtol(value.c_str(), &end, 10);
+      if(*end || value.empty()) return false;
+      has_priority = true;
+    } else {
+      return false;
+    }
+  }
+
+  // Real-time policies need a priority in their range, the lowest if none
+  // is given, and SCHED_OTHER takes none
+  if(spec.policy != SCHED_OTHER) {
+    if(!has_priority) spec.priority = sched_get_priority_min(spec.policy);
+    return spec.priority >= sched_get_priority_min(spec.policy)
+        && spec.priority <= sched_get_priority_max(spec.policy);
+  }
+  return !has_priority || spec.priority == 0;
+}
+
+string ThreadSpec::describe() const {
+  stringstream ss;
+  ss << name << " (cpu " << (cpu < 0 ? string("any") : to_string(cpu))
+     << ", " << policyName(policy);
+  if(policy != SCHED_OTHER) ss << " " << priority;
+  ss << ")";
+  return ss.str();
+}
+
+bool ThreadSpec::applyToThisThread() const {
+
+  pthread_t self = pthread_self();
+  bool ok = true;
+
+  // The name shows up in top, gdb and the sampling profiler
+  if(!name.empty())
+    pthread_setname_np(self, name.substr(0, MAX_THREAD_NAME).c_str());
+
+  if(cpu >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    int err = pthread_setaffinity_np(self, sizeof(cpus), &cpus);
+    if(err) {
+      cerr << oslock << "Could not pin " << name << " thread to cpu " << cpu
+           << ": " << strerror(err) << endl << osunlock;
+      ok = false;
+    }
+  }
+
+  if(policy != SCHED_OTHER) {
+    sched_param param;
+    param.sched_priority = priority;
+    int err = pthread_setschedparam(self, policy, &param);
+    if(err) {
+      cerr << oslock << "Could not set " << policyName(policy) << " scheduling for "
+           << name << " thread: " << strerror(err) << endl << osunlock;
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+ThreadSupervisor::ThreadSupervisor(StopToken& stop_token) : stop_token(stop_token) {}
+
+ThreadSupervisor::~ThreadSupervisor() {
+  for(unique_ptr<Entry>& e : entries) {
+    if(!e->thread.joinable()) continue;
+    bool done;
+    {
+      lock_guard<mutex> lg(m);
+      done = e->done;
+    }
+    if(done) e->thread.join();
+    else e->thread.detach();
+  }
+}
+
+void ThreadSupervisor::add(const ThreadSpec& spec, function<void()> fn) {
+  unique_ptr<Entry> e(new Entry());
+  e->spec = spec;
+  e->fn = fn;
+  e->done = false;
+  entries.push_back(move(e));
+}
+
+bool ThreadSupervisor::configure(const ThreadSpec& spec) {
+  for(unique_ptr<Entry>& e : entries) {
+    if(e->spec.name == spec.name) {
+      e->spec = spec;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadSupervisor::startAll() {
+  for(unique_ptr<Entry>& e : entries) {
+    if(!e->thread.joinable())
+      e->thread = thread(&ThreadSupervisor::run, this, e.get());
+  }
+}
+
+void ThreadSupervisor::run(Entry* entry) {
+
+  const ThreadSpec& spec = entry->spec;
+  spec.applyToThisThread();
+
+  cout << oslock << "Thread " << spec.describe() << " started!" << endl << osunlock;
+
+  try {
+    entry->fn();
+  } catch(const exception& e) {
+    cerr << oslock << spec.name << " thread failed: " << e.what() << endl << osunlock;
+    stop_token.requestStop();
+  }
+
+  cout << oslock << "Thread " << spec.name << " finished!" << endl << osunlock;
+
+  {
+    lock_guard<mutex> lg(m);
+    entry->done = true;
+  }
+  exited.notify_all();
+}
+
+void ThreadSupervisor::requestStop() {
+  stop_token.requestStop();
+}
+
+bool ThreadSupervisor::joinAll(double timeout) {
+
+  requestStop();
+
+  chrono::steady_clock::time_point deadline = chrono::steady_clock::now()
+      + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout));
+
+  {
+    unique_lock<mutex> lk(m);
+    exited.wait_until(lk, deadline, [this]() {
+      for(const unique_ptr<Entry>& e : entries)
+        if(e->thread.joinable() && !e->done) return false;
+      return true;
+    });
+  }
+
+  bool all_joined = true;
+  for(unique_ptr<Entry>& e : entries) {
+    if(!e->thread.joinable()) continue;
+    bool done;
+    {
+      lock_guard<mutex> lg(m);
+      done = e->done;
+    }
+    if(done) {
+      e->thread.join();
+    } else {
+      cerr << oslock << "Thread " << e->spec.name << " did not finish within "
+           << timeout << " s, detaching it." << endl << osunlock;
+      e->thread.detach();
+      all_joined = false;
+    }
+  }
+  return all_joined;
+}
+
+vector<string> ThreadSupervisor::getNames() const {
+  vector<string> names;
+  for(const unique_ptr<Entry>& e : entries)
+    names.push_back(e->spec.name);
+  return names;
+}
@@ -0,0 +1,155 @@
+/**
+* ThreadSupervisor.hpp
+* --------------------
+* Launches the app's long-lived loops as named threads, each with an
+* optional CPU affinity and scheduling policy, and shuts them down
+* together. Loops poll a shared StopToken and return once it is set;
+* joinAll() then waits for them up to a deadline.
+*
+*   StopToken stop;
+*   ThreadSupervisor supervisor(stop);
+*   supervisor.add(ThreadSpec("control"), [&]() { app.controlsLoop(); });
+*   supervisor.startAll();
+*   stop.wait();
+*   supervisor.joinAll(2.0);
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+* Shutdown flag shared by all loops. Setting it also wakes any thread
+* sleeping in waitFor().
+*/
+class StopToken {
+
+public:
+
+  StopToken() : stop(false) {}
+
+  void requestStop();
+
+  bool stopRequested() const { return stop.load(std::memory_order_acquire); }
+
+  /**
+  * Sleep for up to the given number of seconds, returning early if a
+  * stop is requested. Returns true if a stop was requested.
+  */
+  bool waitFor(double seconds);
+
+  /**
+  * Sleep until a stop is requested.
+  */
+  void wait();
+
+private:
+
+  std::atomic<bool> stop;
+  std::mutex m;
+  std::condition_variable cv;
+};
+
+/**
+* How to run one thread. A cpu of -1 leaves the affinity to the kernel;
+* a policy other than SCHED_OTHER needs CAP_SYS_NICE or an rtprio limit.
+*/
+class ThreadSpec {
+
+public:
+
+  explicit ThreadSpec(const std::string& name = "") : name(name), cpu(-1), policy(0), priority(0) {}
+
+  /**
+  * Apply a setting of the form "name[:cpu=N][:policy=other|fifo|rr]
+  * [:priority=P]" to the spec it names. A real-time policy without a
+  * priority gets its lowest. Returns false if the setting is malformed,
+  * or the priority is out of the policy's range or given without one.
+  */
+  static bool parse(const std::string& setting, ThreadSpec& spec);
+
+  std::string describe() const;
+
+  /**
+  * Name the calling thread and apply the affinity and policy. Settings
+  * that cannot be applied are reported and skipped; returns false if
+  * there were any.
+  */
+  bool applyToThisThread() const;
+
+  std::string name; // Thread name, truncated to 15 characters by the kernel
+  int cpu;          // CPU to pin to, or -1
+  int policy;       // SCHED_OTHER, SCHED_FIFO or SCHED_RR
+  int priority;     // Static priority for SCHED_FIFO and SCHED_RR
+};
+
+class ThreadSupervisor {
+
+public:
+
+  explicit ThreadSupervisor(StopToken& stop_token);
+
+  /**
+  * Joins what it can; threads still running are detached.
+  */
+  ~ThreadSupervisor();
+
+  /**
+  * Register a loop. Its spec can be overridden with configure() until
+  * startAll() is called.
+  */
+  void add(const ThreadSpec& spec, std::function<void()> fn);
+
+  /**
+  * Replace the spec of the registered thread with the same name.
+  * Returns false if there is none.
+  */
+  bool configure(const ThreadSpec& spec);
+
+  /**
+  * Launch every registered thread. A thread whose affinity or policy
+  * cannot be applied still runs, with a warning.
+  */
+  void startAll();
+
+  /**
+  * Set the stop token.
+  */
+  void requestStop();
+
+  /**
+  * Wait until every thread has returned or the timeout in seconds runs
+  * out, requesting a stop first. Threads that are still running, such
+  * as one blocked reading stdin, are detached and named in a warning.
+  * Returns true if all threads were joined.
+  */
+  bool joinAll(double timeout);
+
+  std::vector<std::string> getNames() const;
+
+private:
+
+  class Entry {
+  public:
+    ThreadSpec spec;
+    std::function<void()> fn;
+    std::thread thread;
+    bool done;
+  };
+
+  void run(Entry* entry);
+
+  StopToken& stop_token;
+  std::vector<std::unique_ptr<Entry>> entries;
+
+  // Guards Entry::done; signalled when a thread's loop returns
+  std::mutex m;
+  std::condition_variable exited;
+};
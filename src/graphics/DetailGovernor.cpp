@@ -0,0 +1,112 @@
+/**
+* DetailGovernor.cpp
+* ------------------
+* Implementation of the DetailGovernor class.
+*/
+
+#include <fstream>
+#include <string>
+
+#include "DetailGovernor.hpp"
+
+using namespace std;
+
+// From full detail down; tracks beyond the pool size are never drawn anyway
+static const DetailLevel DETAIL_LEVELS[] = {
+  // frame_dt  spheres  trail  arc  tracks
+  {  0.020,    16,      32,    24,  64 },
+  {  0.033,    12,      16,    16,  32 },
+  {  0.050,    8,       8,     12,  16 },
+  {  0.100,    6,       0,     8,   8  }
+};
+static const int NUM_LEVELS = sizeof(DETAIL_LEVELS) / sizeof(DETAIL_LEVELS[0]);
+
+// Length of the windows load is judged over
+static const double ADJUST_INTERVAL = 0.5;
+
+// Fractions of control ticks missing their deadline above which to back
+// off, and below which to recover; a miss or two is jitter, not load
+static const double MISS_RATE_HIGH = 0.001;
+static const double MISS_RATE_LOW = MISS_RATE_HIGH / 10;
+
+// CPU busy fractions above which to back off, and below which to recover
+static const double CPU_BUSY_HIGH = 0.90;
+static const double CPU_BUSY_LOW = 0.70;
+
+// Quiet windows in a row before recovering a level
+static const int RECOVER_WINDOWS = 4;
+
+DetailGovernor::DetailGovernor() :
+    level(0), quiet_windows(0), window_start(chrono::steady_clock::now()),
+    window_ticks(0), window_misses(0), window_frame_max(0), cpu_busy(0), cpu_total(0) {
+  sampleCpuBusy();
+}
+
+bool DetailGovernor::update(uint64_t ticks, uint64_t misses, double frame_seconds) {
+
+  if(frame_seconds > window_frame_max) window_frame_max = frame_seconds;
+
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  if(chrono::duration<double>(now - window_start).count() < ADJUST_INTERVAL) return false;
+
+  double miss_rate = 0;
+  if(ticks > window_ticks) miss_rate = double(misses - window_misses) / (ticks - window_ticks);
+  double busy = sampleCpuBusy();
+
+  // A frame that cannot fit its own period is overload too
+  bool overloaded = miss_rate > MISS_RATE_HIGH || busy > CPU_BUSY_HIGH
+      || window_frame_max > getDetail().frame_dt;
+  bool quiet = miss_rate < MISS_RATE_LOW && busy < CPU_BUSY_LOW
+      && window_frame_max < 0.5 * getDetail().frame_dt;
+
+  window_start = now;
+  window_ticks = ticks;
+  window_misses = misses;
+  window_frame_max = 0;
+
+  int old_level = level;
+  if(overloaded) {
+    quiet_windows = 0;
+    if(level + 1 < NUM_LEVELS) level++;
+  } else if(quiet) {
+    if(++quiet_windows >= RECOVER_WINDOWS && level > 0) {
+      level--;
+      quiet_windows = 0;
+    }
+  } else {
+    quiet_windows = 0;
+  }
+  return level != old_level;
+}
+
+const DetailLevel& DetailGovernor::getDetail() const {
+  return DETAIL_LEVELS[level];
+}
+
+int DetailGovernor::numLevels() {
+  return NUM_LEVELS;
+}
+
+double DetailGovernor::sampleCpuBusy() {
+
+  // First line: cpu user nice system idle iowait irq softirq steal ...
+  ifstream stat("/proc/stat");
+  string cpu;
+  uint64_t fields[8] = {0};
+  stat >> cpu;
+  if(cpu != "cpu") return 0;
+  for(int i = 0; i < 8 && stat >> fields[i]; i++);
+
+  uint64_t total = 0;
+  for(uint64_t f : fields) total += f;
+  uint64_t idle = fields[3] + fields[4];
+  uint64_t busy = total - idle;
+
+  double fraction = 0;
+  if(cpu_total && total > cpu_total) {
+    fraction = double(busy - cpu_busy) / (total - cpu_total);
+  }
+  cpu_busy = busy;
+  cpu_total = total;
+  return fraction;
+}
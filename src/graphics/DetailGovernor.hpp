@@ -0,0 +1,75 @@
+/**
+* DetailGovernor.hpp
+* ------------------
+* Picks the graphics frame rate and scene detail from how loaded the
+* machine is. Rendering is the first thing to give up when control ticks
+* start missing their deadline or the CPUs are saturated, and it gets
+* its detail back once there is headroom again.
+*
+*   DetailGovernor governor;
+*   while(...) {
+*     const DetailLevel& detail = governor.getDetail();
+*     ... draw with detail, sleep until detail.frame_dt has passed ...
+*     governor.update(ticks, misses, frame_seconds);
+*   }
+*
+* Load is judged over ADJUST_INTERVAL windows. Any sign of overload
+* drops one level at once; recovering a level takes several quiet
+* windows in a row, so the detail does not flap.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/**
+* Frame rate and detail of one level.
+*/
+class DetailLevel {
+public:
+  double frame_dt;       // Frame period
+  int sphere_resolution; // Slices and stacks of each marker sphere
+  int trail_length;      // Observations drawn per trail
+  int arc_points;        // Points per predicted arc
+  int max_tracks;        // Most tracks drawn
+};
+
+class DetailGovernor {
+
+public:
+
+  DetailGovernor();
+
+  /**
+  * Account for one frame. ticks and misses are the running totals of
+  * control ticks and deadline misses; frame_seconds is how long the
+  * frame took to draw. Returns true if the level changed.
+  */
+  bool update(uint64_t ticks, uint64_t misses, double frame_seconds);
+
+  const DetailLevel& getDetail() const;
+
+  /**
+  * 0 for full detail, higher for less.
+  */
+  int getLevel() const { return level; }
+  static int numLevels();
+
+private:
+
+  /**
+  * Fraction of the last interval the CPUs were busy, from /proc/stat.
+  * Returns 0 if it cannot be read.
+  */
+  double sampleCpuBusy();
+
+  int level;
+  int quiet_windows; // Consecutive windows without overload
+
+  std::chrono::steady_clock::time_point window_start;
+  uint64_t window_ticks, window_misses;
+  double window_frame_max;
+
+  uint64_t cpu_busy, cpu_total; // Last /proc/stat totals
+};
@@ -0,0 +1,71 @@
+/**
+* PolylineBatch.cpp
+* -----------------
+* Implementation of the PolylineBatch class.
+*/
+
+#include "PolylineBatch.hpp"
+
+using namespace std;
+
+PolylineBatch::PolylineBatch(int max_points) :
+    num_vertices(0), strip_open(false), line_width(1) {
+
+  // A strip of n points becomes n - 1 segments of two endpoints each
+  max_vertices = 2 * max_points;
+  vertices.resize(3 * max_vertices);
+  setColor(1, 1, 1);
+}
+
+void PolylineBatch::setColor(float r, float g, float b, float a) {
+  color[0] = r;
+  color[1] = g;
+  color[2] = b;
+  color[3] = a;
+}
+
+void PolylineBatch::clear() {
+  num_vertices = 0;
+  strip_open = false;
+}
+
+void PolylineBatch::beginStrip() {
+  strip_open = false;
+}
+
+bool PolylineBatch::addPoint(const Eigen::Vector3d& p) {
+
+  float point[3] = {(float)p(0), (float)p(1), (float)p(2)};
+
+  if(strip_open) {
+    if(num_vertices + 2 > max_vertices) return false;
+    float* v = &vertices[3 * num_vertices];
+    for(int i = 0; i < 3; i++) {
+      v[i] = last[i];
+      v[3 + i] = point[i];
+    }
+    num_vertices += 2;
+  }
+
+  for(int i = 0; i < 3; i++) last[i] = point[i];
+  strip_open = true;
+  return true;
+}
+
+void PolylineBatch::render(chai3d::cRenderOptions& a_options) {
+
+  if(num_vertices == 0) return;
+
+  glPushAttrib(GL_ENABLE_BIT | GL_LINE_BIT | GL_CURRENT_BIT);
+  glDisable(GL_LIGHTING);
+  glDisable(GL_TEXTURE_2D);
+  glLineWidth(line_width);
+  glColor4fv(color);
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, vertices.data());
+  glDrawArrays(GL_LINES, 0, num_vertices);
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+  glPopAttrib();
+}
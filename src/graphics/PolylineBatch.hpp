@@ -0,0 +1,74 @@
+/**
+* PolylineBatch.hpp
+* -----------------
+* Many line strips in one scene graph object, drawn with a single call
+* from one vertex buffer. Used for per-track curves, where a mesh or
+* shape per segment would cost a node and a draw call each.
+*
+*   PolylineBatch arcs(1024);
+*   arcs.setColor(1, 0.5, 0);
+*   world->addChild(&arcs);
+*
+*   arcs.clear();                  // each frame
+*   arcs.beginStrip();
+*   for(...) arcs.addPoint(p);
+*
+* The buffer is sized once; points past its capacity are dropped rather
+* than reallocated, so a frame never allocates.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Dense>
+#include <chai3d.h>
+
+class PolylineBatch : public chai3d::cGenericObject {
+
+public:
+
+  /**
+  * Room for max_points points over all strips.
+  */
+  explicit PolylineBatch(int max_points);
+
+  void setColor(float r, float g, float b, float a = 1);
+  void setLineWidth(float width) { line_width = width; }
+
+  /**
+  * Remove all strips, keeping the buffer.
+  */
+  void clear();
+
+  /**
+  * Start a new strip. The next point connects to nothing before it.
+  */
+  void beginStrip();
+
+  /**
+  * Extend the current strip to p. Returns false if the buffer is full.
+  */
+  bool addPoint(const Eigen::Vector3d& p);
+
+  /**
+  * Number of line segments currently held.
+  */
+  int numSegments() const { return num_vertices / 2; }
+
+  virtual void render(chai3d::cRenderOptions& a_options);
+
+private:
+
+  // Segment endpoints, xyz each, drawn as GL_LINES
+  std::vector<float> vertices;
+  int num_vertices;
+  int max_vertices;
+
+  // Last point of the current strip, if it has one
+  bool strip_open;
+  float last[3];
+
+  float color[4];
+  float line_width;
+};
@@ -0,0 +1,186 @@
+/**
+* ProjectileMarkers.cpp
+* ---------------------
+* Implementation of the ProjectileMarkers class.
+*/
+
+#include "ProjectileMarkers.hpp"
+
+using namespace std;
+
+// Radius of each marker sphere
+static const double MARKER_RADIUS = 0.04;
+
+// Slices and stacks of each marker sphere until setDetail() is called
+static const int DEFAULT_SPHERE_RESOLUTION = 16;
+
+// How far ahead to draw arcs that do not reach the interception sphere
+static const double ARC_HORIZON = 1.0;
+
+ProjectileMarkers::ProjectileMarkers(chai3d::cWorld* world, int capacity) :
+    world(world), capacity(capacity), sphere_resolution(0), trail_length(TRAIL_LENGTH),
+    arc_points(ARC_POINTS), max_tracks(capacity), visuals(capacity), tracks(capacity),
+    arcs(capacity * ARC_POINTS), trails(capacity * TRAIL_LENGTH) {
+
+  estimate_mat.setYellow();
+  observed_mat.setGreen();
+  intercept_mat.setGray();
+
+  free_slots.reserve(capacity);
+  for(int i = capacity - 1; i >= 0; i--) {
+    TrackVisual& v = visuals[i];
+    v.estimate = new chai3d::cMesh(&estimate_mat);
+    v.observed = new chai3d::cMesh(&observed_mat);
+    v.intercept = new chai3d::cMesh(&intercept_mat);
+    for(chai3d::cMesh* m : {v.estimate, v.observed, v.intercept}) world->addChild(m);
+    release(v);
+    free_slots.push_back(i);
+  }
+  buildSpheres(DEFAULT_SPHERE_RESOLUTION);
+
+  arcs.setColor(1, 0.6, 0);
+  trails.setColor(0, 0.8, 0);
+  trails.setLineWidth(2);
+  world->addChild(&arcs);
+  world->addChild(&trails);
+}
+
+ProjectileMarkers::~ProjectileMarkers() {
+  for(TrackVisual& v : visuals) {
+    for(chai3d::cMesh* m : {v.estimate, v.observed, v.intercept}) {
+      world->removeChild(m);
+      delete m;
+    }
+  }
+  world->removeChild(&arcs);
+  world->removeChild(&trails);
+}
+
+void ProjectileMarkers::update(ProjectileManager& manager,
+    const SalvoResult& salvo, double now) {
+  int n = manager.getConvergedSnapshots(tracks.data(), capacity);
+  update(tracks.data(), n, salvo, now);
+}
+
+void ProjectileMarkers::update(const ProjectileSnapshot* snapshots, int n,
+    const SalvoResult& salvo, double now) {
+
+  for(TrackVisual& v : visuals) v.seen = false;
+
+  // Tracks past the limit lose their markers below
+  if(n > max_tracks) n = max_tracks;
+  for(int k = 0; k < n; k++) {
+
+    int id = snapshots[k].id;
+    int slot = findSlot(id);
+    if(slot < 0) {
+      if(free_slots.empty()) continue;
+      slot = free_slots.back();
+      free_slots.pop_back();
+      visuals[slot].id = id;
+    }
+
+    TrackVisual& v = visuals[slot];
+    v.seen = true;
+    v.snapshot = snapshots[k];
+    const ProjectileSnapshot& s = v.snapshot;
+
+    Eigen::Vector3d pos = s.getPosition(now);
+    v.estimate->setLocalPos(pos(0), pos(1), pos(2));
+    v.estimate->setShowEnabled(true);
+    v.observed->setLocalPos(s.pObs(0), s.pObs(1), s.pObs(2));
+    v.observed->setShowEnabled(true);
+
+    // Extend the trail when a new observation arrived
+    int newest = (v.trail_start + v.trail_count - 1) % TRAIL_LENGTH;
+    if(v.trail_count == 0 || !v.trail[newest].isApprox(s.pObs)) {
+      if(v.trail_count < TRAIL_LENGTH) {
+        v.trail[(v.trail_start + v.trail_count++) % TRAIL_LENGTH] = s.pObs;
+      } else {
+        v.trail[v.trail_start] = s.pObs;
+        v.trail_start = (v.trail_start + 1) % TRAIL_LENGTH;
+      }
+    }
+
+    // Intercepts come from the planner's last evaluation
+    const TrackEvaluation* eval = salvo.find(id);
+    if(eval && eval->intersects) {
+      const Eigen::Vector3d& c = eval->collision_pos;
+      v.intercept->setLocalPos(c(0), c(1), c(2));
+      v.intercept->setShowEnabled(true);
+      v.t_arc_end = eval->t_intersect;
+    } else {
+      v.intercept->setShowEnabled(false);
+      v.t_arc_end = now + ARC_HORIZON;
+    }
+  }
+
+  // Return the markers of tracks that went away
+  for(int i = 0; i < capacity; i++) {
+    TrackVisual& v = visuals[i];
+    if(v.id >= 0 && !v.seen) {
+      release(v);
+      free_slots.push_back(i);
+    }
+  }
+
+  drawCurves(now);
+}
+
+void ProjectileMarkers::setDetail(const DetailLevel& detail) {
+  trail_length = min(detail.trail_length, TRAIL_LENGTH);
+  arc_points = min(detail.arc_points, ARC_POINTS);
+  max_tracks = min(detail.max_tracks, capacity);
+  if(detail.sphere_resolution != sphere_resolution) buildSpheres(detail.sphere_resolution);
+}
+
+void ProjectileMarkers::buildSpheres(int resolution) {
+  for(TrackVisual& v : visuals) {
+    for(chai3d::cMesh* m : {v.estimate, v.observed, v.intercept}) {
+      m->clear();
+      chai3d::cCreateSphere(m, MARKER_RADIUS, resolution, resolution);
+    }
+  }
+  sphere_resolution = resolution;
+}
+
+int ProjectileMarkers::findSlot(int id) const {
+  for(int i = 0; i < capacity; i++) {
+    if(visuals[i].id == id) return i;
+  }
+  return -1;
+}
+
+void ProjectileMarkers::release(TrackVisual& v) {
+  v.id = -1;
+  v.seen = false;
+  v.trail_start = 0;
+  v.trail_count = 0;
+  v.estimate->setShowEnabled(false);
+  v.observed->setShowEnabled(false);
+  v.intercept->setShowEnabled(false);
+}
+
+void ProjectileMarkers::drawCurves(double now) {
+
+  arcs.clear();
+  trails.clear();
+
+  for(const TrackVisual& v : visuals) {
+    if(v.id < 0) continue;
+
+    if(v.snapshot.converged && v.t_arc_end > now) {
+      double dt = (v.t_arc_end - now) / (arc_points - 1);
+      arcs.beginStrip();
+      for(int i = 0; i < arc_points; i++) {
+        arcs.addPoint(v.snapshot.getPosition(now + i * dt));
+      }
+    }
+
+    // The newest trail_length observations
+    trails.beginStrip();
+    for(int i = max(0, v.trail_count - trail_length); i < v.trail_count; i++) {
+      trails.addPoint(v.trail[(v.trail_start + i) % TRAIL_LENGTH]);
+    }
+  }
+}
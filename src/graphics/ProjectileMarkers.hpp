@@ -0,0 +1,112 @@
+/**
+* ProjectileMarkers.hpp
+* ---------------------
+* Scene graph for the tracked projectiles: a marker for each track's
+* estimate, last observation and intercept, its predicted arc, and a
+* trail of its recent observations.
+*
+*   ProjectileMarkers markers(chai_world);
+*   markers.update(manager, salvo, now); // each frame
+*
+* Markers come from a pool built up front and are handed between tracks
+* as they come and go, so a frame never creates or removes scene graph
+* objects. All arcs and all trails are drawn as two PolylineBatches.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Dense>
+#include <chai3d.h>
+
+#include "DetailGovernor.hpp"
+#include "PolylineBatch.hpp"
+#include "../projectile/projectile.hpp"
+#include "../projectile/SalvoEvaluator.hpp"
+
+// Most observations kept in each track's trail
+static const int TRAIL_LENGTH = 32;
+
+// Most points along each predicted arc
+static const int ARC_POINTS = 24;
+
+class ProjectileMarkers {
+
+public:
+
+  /**
+  * Builds capacity markers and adds them to world, hidden. Tracks
+  * beyond capacity are not drawn.
+  */
+  ProjectileMarkers(chai3d::cWorld* world, int capacity = MAX_SALVO_TRACKS);
+  ~ProjectileMarkers();
+
+  /**
+  * Match the markers to the manager's converged tracks at time now.
+  * Intercepts and arc ends come from salvo. Call from the graphics
+  * thread.
+  */
+  void update(ProjectileManager& manager, const SalvoResult& salvo, double now);
+
+  /**
+  * Same, for n snapshots taken elsewhere, e.g. in another process.
+  */
+  void update(const ProjectileSnapshot* snapshots, int n, const SalvoResult& salvo, double now);
+
+  /**
+  * Draw with the given detail from the next update on. Changing the
+  * sphere resolution rebuilds every marker, so only call this when the
+  * level changes.
+  */
+  void setDetail(const DetailLevel& detail);
+
+  /**
+  * Number of tracks currently drawn.
+  */
+  int numShown() const { return capacity - free_slots.size(); }
+
+private:
+
+  /**
+  * Everything drawn for one track.
+  */
+  class TrackVisual {
+  public:
+    int id; // -1 while in the pool
+    bool seen; // Still active this frame
+    chai3d::cMesh* estimate;
+    chai3d::cMesh* observed;
+    chai3d::cMesh* intercept;
+
+    // Ring of recent observed positions
+    Eigen::Vector3d trail[TRAIL_LENGTH];
+    int trail_start, trail_count;
+
+    // Where the predicted arc ends
+    double t_arc_end;
+    ProjectileSnapshot snapshot;
+  };
+
+  void buildSpheres(int resolution);
+  int findSlot(int id) const;
+  void release(TrackVisual& v);
+  void drawCurves(double now);
+
+  chai3d::cWorld* world;
+  int capacity;
+
+  // Parts of the current DetailLevel that apply here
+  int sphere_resolution, trail_length, arc_points, max_tracks;
+
+  chai3d::cMaterial estimate_mat, observed_mat, intercept_mat;
+
+  std::vector<TrackVisual> visuals;
+  std::vector<ProjectileSnapshot> tracks; // This frame's, from the manager
+  std::vector<int> free_slots;
+
+  PolylineBatch arcs, trails;
+
+  ProjectileMarkers(const ProjectileMarkers&);
+  ProjectileMarkers& operator=(const ProjectileMarkers&);
+};
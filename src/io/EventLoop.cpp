@@ -0,0 +1,110 @@
+/**
+* EventLoop.cpp
+* -------------
+* Implementation of the EventLoop class.
+*/
+
+#include <stdexcept>
+
+#include "EventLoop.hpp"
+
+using namespace std;
+
+// How often run() checks its StopToken
+static const double STOP_CHECK_INTERVAL = 0.05;
+
+EventLoop::EventLoop() : stop(NULL) {
+
+  loop = ev_loop_new(EVFLAG_AUTO);
+  if(!loop) throw runtime_error("Could not create an event loop!");
+
+  ev_async_init(&posted_watcher, &EventLoop::onPosted);
+  posted_watcher.data = this;
+  ev_async_start(loop, &posted_watcher);
+
+  ev_timer_init(&stop_watcher, &EventLoop::onStopCheck, STOP_CHECK_INTERVAL, STOP_CHECK_INTERVAL);
+  stop_watcher.data = this;
+}
+
+EventLoop::~EventLoop() {
+  ev_loop_destroy(loop);
+}
+
+void EventLoop::run(StopToken& stop) {
+  this->stop = &stop;
+  ev_timer_start(loop, &stop_watcher);
+  ev_run(loop, 0);
+  ev_timer_stop(loop, &stop_watcher);
+}
+
+void EventLoop::post(Callback fn) {
+  {
+    lock_guard<mutex> lg(posted_lock);
+    posted.push_back(move(fn));
+  }
+  ev_async_send(loop, &posted_watcher);
+}
+
+int EventLoop::addTimer(double interval, Callback fn) {
+  unique_ptr<Watcher> w(new Watcher());
+  w->is_timer = true;
+  w->fn = move(fn);
+  ev_timer_init(&w->timer, &EventLoop::onTimer, interval, interval);
+  w->timer.data = w.get();
+  ev_timer_start(loop, &w->timer);
+  watchers.push_back(move(w));
+  return watchers.size() - 1;
+}
+
+int EventLoop::watchReadable(int fd, Callback fn) {
+  unique_ptr<Watcher> w(new Watcher());
+  w->is_timer = false;
+  w->fn = move(fn);
+  ev_io_init(&w->io, &EventLoop::onIo, fd, EV_READ);
+  w->io.data = w.get();
+  ev_io_start(loop, &w->io);
+  watchers.push_back(move(w));
+  return watchers.size() - 1;
+}
+
+void EventLoop::setEnabled(int id, bool enabled) {
+  Watcher& w = *watchers.at(id);
+  if(w.is_timer) {
+    if(enabled) ev_timer_start(loop, &w.timer);
+    else ev_timer_stop(loop, &w.timer);
+  } else {
+    if(enabled) ev_io_start(loop, &w.io);
+    else ev_io_stop(loop, &w.io);
+  }
+}
+
+bool EventLoop::isEnabled(int id) const {
+  const Watcher& w = *watchers.at(id);
+  return w.is_timer ? ev_is_active(&w.timer) : ev_is_active(&w.io);
+}
+
+void EventLoop::onIo(struct ev_loop* loop, ev_io* w, int revents) {
+  static_cast<Watcher*>(w->data)->fn();
+}
+
+void EventLoop::onTimer(struct ev_loop* loop, ev_timer* w, int revents) {
+  static_cast<Watcher*>(w->data)->fn();
+}
+
+void EventLoop::onPosted(struct ev_loop* loop, ev_async* w, int revents) {
+
+  EventLoop* self = static_cast<EventLoop*>(w->data);
+
+  // Run them outside the lock, since they may post more
+  vector<Callback> ready;
+  {
+    lock_guard<mutex> lg(self->posted_lock);
+    ready.swap(self->posted);
+  }
+  for(Callback& fn : ready) fn();
+}
+
+void EventLoop::onStopCheck(struct ev_loop* loop, ev_timer* w, int revents) {
+  EventLoop* self = static_cast<EventLoop*>(w->data);
+  if(self->stop->stopRequested()) ev_break(loop, EVBREAK_ALL);
+}
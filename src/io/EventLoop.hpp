@@ -0,0 +1,106 @@
+/**
+* EventLoop.hpp
+* -------------
+* One libev loop for all of the app's non-real-time I/O: Redis
+* connections, shell input and periodic timers. Everything registered
+* on it runs on the thread that calls run(), one callback at a time, so
+* callbacks need no locks between them.
+*
+*   EventLoop loop;
+*   loop.addTimer(1.0, []() { heartbeat(); });
+*   loop.watchReadable(STDIN_FILENO, []() { readInput(); });
+*   loop.run(stop_token);               // the I/O thread
+*
+*   loop.post([]() { publish(); });     // any other thread
+*
+* Timers and watchers are added before run() or from its callbacks;
+* other threads hand work to the loop through post().
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <ev.h>
+
+#include "../concurrency/ThreadSupervisor.hpp"
+
+class EventLoop {
+
+public:
+
+  typedef std::function<void()> Callback;
+
+  /**
+  * Throws a runtime_error if libev cannot create a loop.
+  */
+  EventLoop();
+  ~EventLoop();
+
+  /**
+  * Run callbacks until stop is requested. Returns soon after.
+  */
+  void run(StopToken& stop);
+
+  /**
+  * Run fn on the loop thread as soon as it is free. Safe from any
+  * thread.
+  */
+  void post(Callback fn);
+
+  /**
+  * Call fn every interval seconds. Returns an ID for setEnabled().
+  */
+  int addTimer(double interval, Callback fn);
+
+  /**
+  * Call fn whenever fd has data to read. Returns an ID for
+  * setEnabled().
+  */
+  int watchReadable(int fd, Callback fn);
+
+  /**
+  * Pause or resume a timer or watcher. Call from the loop thread.
+  */
+  void setEnabled(int id, bool enabled);
+  bool isEnabled(int id) const;
+
+  /**
+  * The underlying libev loop, for attaching other libraries to it.
+  */
+  struct ev_loop* get() { return loop; }
+
+private:
+
+  class Watcher {
+  public:
+    ev_io io;
+    ev_timer timer;
+    bool is_timer;
+    Callback fn;
+  };
+
+  static void onIo(struct ev_loop* loop, ev_io* w, int revents);
+  static void onTimer(struct ev_loop* loop, ev_timer* w, int revents);
+  static void onPosted(struct ev_loop* loop, ev_async* w, int revents);
+  static void onStopCheck(struct ev_loop* loop, ev_timer* w, int revents);
+
+  struct ev_loop* loop;
+
+  std::vector<std::unique_ptr<Watcher>> watchers;
+
+  // Callbacks posted from other threads
+  ev_async posted_watcher;
+  std::mutex posted_lock;
+  std::vector<Callback> posted;
+
+  // Checks the StopToken given to run()
+  ev_timer stop_watcher;
+  StopToken* stop;
+
+  EventLoop(const EventLoop&);
+  EventLoop& operator=(const EventLoop&);
+};
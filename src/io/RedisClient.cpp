@@ -0,0 +1,113 @@
+/**
+* RedisClient.cpp
+* ---------------
+* Implementation of the RedisClient class.
+*/
+
+#include <iostream>
+
+#include <hiredis/adapters/libev.h>
+
+#include "../ostreamlock.hpp"
+#include "RedisClient.hpp"
+
+using namespace std;
+
+RedisClient::RedisClient(EventLoop& loop, const string& name) :
+    loop(loop), name(name), context(NULL), connected(false) {}
+
+RedisClient::~RedisClient() {
+  // Fails the callbacks still waiting, with NULL replies
+  if(context) redisAsyncFree(context);
+}
+
+bool RedisClient::connect(const string& host, int port) {
+
+  context = redisAsyncConnect(host.c_str(), port);
+  if(!context || context->err) {
+    cerr << oslock << "Could not connect " << name << " to Redis at " << host << ":" << port
+         << ": " << (context ? context->errstr : "out of memory") << endl << osunlock;
+    if(context) redisAsyncFree(context);
+    context = NULL;
+    return false;
+  }
+
+  context->data = this;
+  redisLibevAttach(loop.get(), context);
+  redisAsyncSetConnectCallback(context, &RedisClient::onConnect);
+  redisAsyncSetDisconnectCallback(context, &RedisClient::onDisconnect);
+  return true;
+}
+
+void RedisClient::disconnect() {
+
+  if(!context) return;
+  redisAsyncContext* c = context;
+  context = NULL;
+  connected = false;
+  redisAsyncFree(c);
+}
+
+void RedisClient::command(const vector<string>& args, Callback cb) {
+
+  if(!context) {
+    if(cb) cb(NULL);
+    return;
+  }
+
+  vector<const char*> argv;
+  vector<size_t> argvlen;
+  for(const string& a : args) {
+    argv.push_back(a.data());
+    argvlen.push_back(a.size());
+  }
+
+  // hiredis copies the arguments, so only the callback outlives this
+  Callback* privdata = new Callback(move(cb));
+  int err = redisAsyncCommandArgv(context, &RedisClient::onReply, privdata,
+      argv.size(), argv.data(), argvlen.data());
+  if(err != REDIS_OK) {
+    if(*privdata) (*privdata)(NULL);
+    delete privdata;
+  }
+}
+
+bool RedisClient::ok(const redisReply* reply) {
+  return reply && reply->type != REDIS_REPLY_ERROR;
+}
+
+bool RedisClient::popValue(const redisReply* reply, string& value) {
+  if(!reply || reply->type != REDIS_REPLY_ARRAY || reply->elements != 2) return false;
+  const redisReply* v = reply->element[1];
+  if(v->type != REDIS_REPLY_STRING) return false;
+  value.assign(v->str, v->len);
+  return true;
+}
+
+void RedisClient::onConnect(const redisAsyncContext* c, int status) {
+  RedisClient* self = static_cast<RedisClient*>(c->data);
+  if(status != REDIS_OK) {
+    cerr << oslock << "Could not connect " << self->name << " to Redis: "
+         << c->errstr << endl << osunlock;
+    // hiredis frees the context after this
+    self->context = NULL;
+    return;
+  }
+  self->connected = true;
+}
+
+void RedisClient::onDisconnect(const redisAsyncContext* c, int status) {
+  RedisClient* self = static_cast<RedisClient*>(c->data);
+  if(status != REDIS_OK) {
+    cerr << oslock << "Lost " << self->name << " connection to Redis: "
+         << c->errstr << endl << osunlock;
+  }
+  self->connected = false;
+  self->context = NULL;
+}
+
+void RedisClient::onReply(redisAsyncContext* c, void* reply, void* privdata) {
+  Callback* cb = static_cast<Callback*>(privdata);
+  if(*cb) (*cb)(static_cast<redisReply*>(reply));
+  delete cb;
+}
@@ -0,0 +1,88 @@
+/**
+* RedisClient.hpp
+* ---------------
+* Asynchronous Redis connection driven by an EventLoop, so any number of
+* connections share the loop's thread instead of each running its own.
+*
+*   RedisClient redis(loop, "vision");
+*   redis.connect("localhost", 6379);
+*   redis.command({"BLPOP", "iron_dome:projectiles", "0"}, [](redisReply* r) {
+*     if(RedisClient::ok(r)) ...
+*   });
+*
+* Commands are sent in order and their callbacks run on the loop thread.
+* A blocking command such as BLPOP holds up the commands behind it on
+* the same connection, so give blocking reads a connection of their own.
+*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <hiredis/async.h>
+
+#include "EventLoop.hpp"
+
+class RedisClient {
+
+public:
+
+  /**
+  * Called with the reply, or NULL if the connection failed or closed
+  * before one arrived.
+  */
+  typedef std::function<void(redisReply*)> Callback;
+
+  /**
+  * The name only labels log messages.
+  */
+  RedisClient(EventLoop& loop, const std::string& name);
+  ~RedisClient();
+
+  /**
+  * Start connecting. Returns false if that failed at once; later
+  * failures are logged and fail the commands waiting on them. Commands
+  * may be issued before the connection is up.
+  */
+  bool connect(const std::string& host, int port);
+
+  bool isConnected() const { return connected; }
+
+  /**
+  * Close the connection now, failing the commands still waiting with
+  * NULL replies. Call from the loop thread.
+  */
+  void disconnect();
+
+  /**
+  * Send a command. Call from the loop thread, or before the loop runs.
+  */
+  void command(const std::vector<std::string>& args, Callback cb = Callback());
+
+  /**
+  * Whether a reply is present and not an error.
+  */
+  static bool ok(const redisReply* reply);
+
+  /**
+  * The value of a BLPOP reply into value. Returns false if the reply
+  * is not one.
+  */
+  static bool popValue(const redisReply* reply, std::string& value);
+
+private:
+
+  static void onConnect(const redisAsyncContext* c, int status);
+  static void onDisconnect(const redisAsyncContext* c, int status);
+  static void onReply(redisAsyncContext* c, void* reply, void* privdata);
+
+  EventLoop& loop;
+  std::string name;
+  redisAsyncContext* context;
+  bool connected;
+
+  RedisClient(const RedisClient&);
+  RedisClient& operator=(const RedisClient&);
+};
@@ -0,0 +1,168 @@
+/**
+* FailoverLink.cpp
+* ----------------
+* Implementation of the FailoverLink class.
+*/
+
+#include <cerrno>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FailoverLink.hpp"
+#include "../ostreamlock.hpp"
+
+using namespace std;
+
+static const uint32_t FAILOVER_MAGIC = 0x4944464c; // "IDFL"
+
+/**
+* Whether process pid exists, even if it is not ours to signal.
+*/
+static bool processAlive(int32_t pid) {
+  return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+bool FailoverLink::lead(const string& name) {
+
+  // Refuse to replace a primary that is still running
+  if(follow(name)) {
+    int32_t pid = region->leader.load(memory_order_acquire);
+    close();
+    if(pid != getpid() && processAlive(pid)) {
+      cerr << oslock << "Process " << pid << " already leads " << name
+           << "; start this one as a standby." << endl << osunlock;
+      return false;
+    }
+  }
+
+  close();
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if(fd < 0 || ftruncate(fd, sizeof(Region)) < 0) {
+    cerr << oslock << "Could not create shared memory " << name << "!" << endl << osunlock;
+    if(fd >= 0) ::close(fd);
+    return false;
+  }
+
+  void* mem = mmap(NULL, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(mem == MAP_FAILED) {
+    cerr << oslock << "Could not map shared memory " << name << "!" << endl << osunlock;
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  region = new (mem) Region();
+  region->layout = CHECKPOINT_LAYOUT;
+  region->size = sizeof(Region);
+  region->leader.store(getpid(), memory_order_relaxed);
+  region->beats.store(0, memory_order_relaxed);
+  region->magic.store(FAILOVER_MAGIC, memory_order_release);
+
+  this->name = name;
+  leading = true;
+  return true;
+}
+
+bool FailoverLink::follow(const string& name) {
+
+  close();
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if(fd < 0) return false;
+
+  struct stat st;
+  if(fstat(fd, &st) < 0 || st.st_size != (off_t)sizeof(Region)) {
+    ::close(fd);
+    return false;
+  }
+
+  void* mem = mmap(NULL, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(mem == MAP_FAILED) return false;
+
+  region = static_cast<Region*>(mem);
+  if(region->magic.load(memory_order_acquire) != FAILOVER_MAGIC
+      || region->layout != CHECKPOINT_LAYOUT || region->size != sizeof(Region)) {
+    close();
+    return false;
+  }
+
+  this->name = name;
+  leading = false;
+  followed_pid = region->leader.load(memory_order_acquire);
+  last_beats = region->beats.load(memory_order_acquire);
+  last_change = chrono::steady_clock::now();
+  return true;
+}
+
+void FailoverLink::close() {
+  if(!region) return;
+  munmap(region, sizeof(Region));
+  if(isLeader()) shm_unlink(name.c_str());
+  region = NULL;
+  leading = false;
+}
+
+bool FailoverLink::beat() {
+
+  if(!isLeader()) return false;
+  int32_t pid = region->leader.load(memory_order_acquire);
+  if(pid != getpid()) {
+    followed_pid = pid;
+    leading = false;
+    return false;
+  }
+  region->beats.fetch_add(1, memory_order_release);
+  return true;
+}
+
+void FailoverLink::publish(const AppCheckpoint& state) {
+  if(isLeader()) region->state.write(state);
+}
+
+bool FailoverLink::leaderAlive(double timeout, double stall_timeout) {
+
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  int32_t pid = region->leader.load(memory_order_acquire);
+  uint64_t beats = region->beats.load(memory_order_acquire);
+
+  if(pid != followed_pid || beats != last_beats) {
+    followed_pid = pid;
+    last_beats = beats;
+    last_change = now;
+    return true;
+  }
+
+  // Only look for the process once the beats are late
+  double silent = chrono::duration<double>(now - last_change).count();
+  if(silent < timeout) return true;
+  return silent < stall_timeout && processAlive(pid);
+}
+
+bool FailoverLink::takeOver() {
+
+  int32_t expected = followed_pid;
+  if(!region->leader.compare_exchange_strong(expected, getpid(), memory_order_acq_rel)) {
+    followed_pid = expected;
+    last_change = chrono::steady_clock::now();
+    return false;
+  }
+
+  followed_pid = getpid();
+  leading = true;
+  return true;
+}
+
+bool FailoverLink::read(AppCheckpoint& state) const {
+
+  // The region starts out holding a blank state
+  if(region->state.version() < 2) return false;
+  region->state.read(state);
+  return true;
+}
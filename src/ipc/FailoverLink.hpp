@@ -0,0 +1,125 @@
+/**
+* FailoverLink.hpp
+* ----------------
+* Shared memory between a primary instance of the app and standby
+* instances on the same machine. The primary beats once per control
+* tick and mirrors its tracks and controller state; a standby watches
+* the beats and takes over command publication once they stop.
+*
+*   FailoverLink link;
+*   link.lead("/iron_dome_failover");       // primary
+*   link.beat();                            // every control tick
+*   link.publish(checkpoint);               // every few milliseconds
+*
+*   FailoverLink link;
+*   link.follow("/iron_dome_failover");     // standby
+*   if(!link.leaderAlive(timeout, stall_timeout) && link.takeOver()) {
+*     link.read(checkpoint);                // resume from the mirror
+*   }
+*
+* The region records which process leads. Taking over swaps in the new
+* leader atomically, so of several standbys only one wins, and a primary
+* that was only stalled finds out at its next beat instead of publishing
+* alongside its successor.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "../checkpoint/AppCheckpoint.hpp"
+#include "../concurrency/DoubleBuffer.hpp"
+
+static const std::string DEFAULT_FAILOVER_SHM = "/iron_dome_failover";
+
+class FailoverLink {
+
+public:
+
+  FailoverLink() : region(NULL), leading(false), followed_pid(0), last_beats(0) {}
+
+  ~FailoverLink() { close(); }
+
+  /**
+  * Create the shared memory object name and lead it. Returns false if
+  * it could not be created, or if a live process already leads it.
+  */
+  bool lead(const std::string& name);
+
+  /**
+  * Attach to the shared memory object name as a standby. Returns false
+  * if no primary has created it.
+  */
+  bool follow(const std::string& name);
+
+  /**
+  * Unmap, and remove the object if this process leads it.
+  */
+  void close();
+
+  bool isOpen() const { return region != NULL; }
+  bool isLeader() const { return leading.load(std::memory_order_acquire); }
+
+  /**
+  * Leader: record a control tick. Returns false, and stops leading, if
+  * another process has taken over. Wait-free.
+  */
+  bool beat();
+
+  /**
+  * Leader: mirror the state a standby would resume from.
+  */
+  void publish(const AppCheckpoint& state);
+
+  /**
+  * Standby: whether the leader is still alive. It is not once it has
+  * missed beats for timeout seconds and its process is gone, or for
+  * stall_timeout seconds regardless, so a leader the scheduler merely
+  * held back is not replaced. A change of leader counts as a
+  * beat. Call at least as often as the timeout.
+  */
+  bool leaderAlive(double timeout, double stall_timeout);
+
+  /**
+  * Standby: lead in place of the process last seen leading. Returns
+  * false if another standby got there first.
+  */
+  bool takeOver();
+
+  /**
+  * Latest mirrored state. Returns false if none was published.
+  */
+  bool read(AppCheckpoint& state) const;
+
+  /**
+  * Process that leads, as last seen.
+  */
+  int getLeaderPid() const { return followed_pid; }
+
+private:
+
+  class Region {
+  public:
+    std::atomic<uint32_t> magic; // Set last, once the region is ready
+    uint32_t layout;
+    uint64_t size;
+    std::atomic<int32_t> leader; // Process publishing commands
+    std::atomic<uint64_t> beats; // Control ticks of the leaders so far
+    DoubleBuffer<AppCheckpoint> state;
+  };
+
+  Region* region;
+  std::string name;
+  std::atomic<bool> leading; // Read by the thread publishing state
+
+  // What a standby last saw, and when it changed
+  int32_t followed_pid;
+  uint64_t last_beats;
+  std::chrono::steady_clock::time_point last_change;
+
+  FailoverLink(const FailoverLink&);
+  FailoverLink& operator=(const FailoverLink&);
+};
@@ -0,0 +1,156 @@
+/**
+* SharedSnapshot.hpp
+* ------------------
+* A DoubleBuffer in POSIX shared memory, so one process can publish a
+* value that any number of other processes read without locks. The
+* writer never waits on readers, however many attach or however slow
+* they are.
+*
+*   SharedSnapshot<ViewerState> out;
+*   out.create("/iron_dome_state", VIEWER_STATE_LAYOUT);
+*   out.write(state);                         // publisher
+*
+*   SharedSnapshot<ViewerState> in;
+*   if(in.open("/iron_dome_state", VIEWER_STATE_LAYOUT)) in.read(state);
+*
+* A header in front of the buffer records the layout version and size
+* of T, and open() refuses a region that does not match. T has the same
+* requirements as for DoubleBuffer, and must also not hold pointers.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../concurrency/DoubleBuffer.hpp"
+
+template<typename T>
+class SharedSnapshot {
+
+public:
+
+  SharedSnapshot() : region(NULL), owner(false) {}
+
+  ~SharedSnapshot() { close(); }
+
+  /**
+  * Create the shared memory object name, replacing any left over, and
+  * become its writer. Returns false on failure.
+  */
+  bool create(const std::string& name, uint32_t layout) {
+
+    close();
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0 || ftruncate(fd, sizeof(Region)) < 0) {
+      std::cerr << "Could not create shared memory " << name << "!" << std::endl;
+      if(fd >= 0) ::close(fd);
+      return false;
+    }
+
+    void* mem = mmap(NULL, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mem == MAP_FAILED) {
+      std::cerr << "Could not map shared memory " << name << "!" << std::endl;
+      shm_unlink(name.c_str());
+      return false;
+    }
+
+    region = new (mem) Region();
+    region->layout = layout;
+    region->size = sizeof(T);
+    region->magic.store(MAGIC, std::memory_order_release);
+
+    this->name = name;
+    owner = true;
+    return true;
+  }
+
+  /**
+  * Attach to the shared memory object name as a reader. Returns false
+  * if it does not exist yet or holds a different layout.
+  */
+  bool open(const std::string& name, uint32_t layout) {
+
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size != (off_t)sizeof(Region)) {
+      ::close(fd);
+      return false;
+    }
+
+    void* mem = mmap(NULL, sizeof(Region), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mem == MAP_FAILED) return false;
+
+    region = static_cast<Region*>(mem);
+    if(region->magic.load(std::memory_order_acquire) != MAGIC
+        || region->layout != layout || region->size != sizeof(T)) {
+      close();
+      return false;
+    }
+
+    this->name = name;
+    owner = false;
+    return true;
+  }
+
+  /**
+  * Unmap, and remove the object if this is its writer.
+  */
+  void close() {
+    if(!region) return;
+    munmap(region, sizeof(Region));
+    if(owner) shm_unlink(name.c_str());
+    region = NULL;
+    owner = false;
+  }
+
+  bool isOpen() const { return region != NULL; }
+
+  /**
+  * Publish a value. Writer only.
+  */
+  void write(const T& value) { region->buffer.write(value); }
+
+  /**
+  * Copy of the latest value. Attached readers and the writer.
+  */
+  void read(T& value) const { region->buffer.read(value); }
+
+  /**
+  * Number of values written, to tell whether anything new arrived.
+  */
+  uint64_t version() const { return region->buffer.version(); }
+
+private:
+
+  static const uint32_t MAGIC = 0x49444d53; // "IDMS"
+
+  class Region {
+  public:
+    std::atomic<uint32_t> magic; // Set last, once the region is ready
+    uint32_t layout;
+    uint64_t size;
+    DoubleBuffer<T> buffer;
+  };
+
+  Region* region;
+  std::string name;
+  bool owner;
+
+  SharedSnapshot(const SharedSnapshot&);
+  SharedSnapshot& operator=(const SharedSnapshot&);
+};
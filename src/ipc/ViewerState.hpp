@@ -0,0 +1,50 @@
+/**
+* ViewerState.hpp
+* ---------------
+* What a viewer needs to draw one frame: the robot's joints and control
+* points, and every converged track with its intercept. Published by the
+* app to shared memory and read by viewer processes, so it is plain data
+* with a fixed layout; bump VIEWER_STATE_LAYOUT whenever it changes.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "../RobotState.hpp"
+#include "../projectile/SalvoEvaluator.hpp"
+
+// Shared memory object the app publishes to by default
+static const char* const DEFAULT_VIEWER_SHM = "/iron_dome_state";
+
+// Layout version of ViewerState, checked by readers
+static const uint32_t VIEWER_STATE_LAYOUT = 2;
+
+/**
+* One converged track, enough to extrapolate it like a
+* ProjectileSnapshot.
+*/
+class ViewerTrack {
+public:
+  int32_t id;
+  int32_t intersects;  // Whether it reaches the interception sphere
+  double t;            // Time of the estimate
+  double p[3], v[3], a[3]; // Estimated pos/vel/acc at time t
+  double p_obs[3];     // Last measured position
+  double t_intersect;  // Time it reaches the sphere, or -1
+  double collision_pos[3];
+};
+
+class ViewerState {
+public:
+  double t;         // App time of the frame
+  int64_t iter;     // Control tick the robot state is from
+  char robot[32];   // RobotProfile of the app, NUL-terminated
+  int32_t dof;
+  int32_t state;    // State machine state
+  int32_t target_id;
+  int32_t num_tracks;
+  double q[MAX_DOF];
+  double x_c[3], x_d[3]; // Current and desired operational point
+  ViewerTrack tracks[MAX_SALVO_TRACKS];
+};
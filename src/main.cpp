@@ -2,61 +2,98 @@
 *
 */
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "ostreamlock.hpp"
 #include "IronDomeApp.hpp"
+#include "metrics/MetricsServer.hpp"
+#include "concurrency/ThreadSupervisor.hpp"
 
 using namespace std;
 
-static const int NUM_THREADS = 5;
+// How long to wait for the loops to return after a stop
+static const double JOIN_TIMEOUT = 2.0;
 
-static const int CONTROL_THREAD = 0;
-static const int GRAPHICS_THREAD = 1;
-static const int VISION_THREAD = 2;
-static const int SHELL_THREAD = 3;
-static const int ROBOT_THREAD = 4;
+// Port for the Prometheus metrics endpoint on localhost
+static const int METRICS_PORT = 9464;
 
-int main(int argc, char* argv[]) {
-
-  IronDomeApp app = {};
-
-  omp_set_num_threads(NUM_THREADS);
-  int thread_id;
-
-#pragma omp parallel private(thread_id)
-  {
-    thread_id = omp_get_thread_num();
-
-    if(thread_id == CONTROL_THREAD) {
-
-      cout << oslock << "Control thread started!" << endl << osunlock;
-      app.controlsLoop();
-      cout << oslock << "Control thread finished!" << endl << osunlock;
-
-    } else if (thread_id == GRAPHICS_THREAD) {
+/**
+* Parse a comma-separated list of CPU numbers, e.g. "2,3".
+*/
+static bool parseCpuList(const string& list, vector<int>& cpus) {
+  stringstream ss(list);
+  string field;
+  while(getline(ss, field, ',')) {
+    char* end;
+    long cpu = strtol(field.c_str(), &end, 10);
+    if(field.empty() || *end || cpu < 0) return false;
+    cpus.push_back(cpu);
+  }
+  return !cpus.empty();
+}
 
-      cout << oslock << "Graphics thread started!" << endl << osunlock;
-      app.graphicsLoop();
-      cout << oslock << "Graphics thread finished!" << endl << osunlock;
+int main(int argc, char* argv[]) {
 
-    } else if (thread_id == VISION_THREAD) {
+  IronDomeConfig config;
+  vector<string> thread_settings;
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--robot") && i + 1 < argc) config.robot = argv[++i];
+    else if(!strcmp(argv[i], "--controller") && i + 1 < argc) config.controller = argv[++i];
+    else if(!strcmp(argv[i], "--thread") && i + 1 < argc) thread_settings.push_back(argv[++i]);
+    else if(!strcmp(argv[i], "--workers") && i + 1 < argc) config.task_workers = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--worker-cpus") && i + 1 < argc && parseCpuList(argv[i + 1], config.task_cpus)) i++;
+    else if(!strcmp(argv[i], "--viewer-shm") && i + 1 < argc) config.viewer_shm = argv[++i];
+    else if(!strcmp(argv[i], "--no-graphics")) config.graphics = false;
+    else if(!strcmp(argv[i], "--checkpoint") && i + 1 < argc) config.checkpoint_file = argv[++i];
+    else if(!strcmp(argv[i], "--failover") && i + 1 < argc) config.failover_shm = argv[++i];
+    else if(!strcmp(argv[i], "--standby")) config.standby = true;
+    else if(!strcmp(argv[i], "--calibration") && i + 1 < argc) config.calibration_file = argv[++i];
+    else {
+      cerr << "Usage: " << argv[0] << " [--robot name] [--controller name]"
+           << " [--thread name[:cpu=N][:policy=other|fifo|rr][:priority=P]]..."
+           << " [--workers N] [--worker-cpus a,b,...]"
+           << " [--viewer-shm name] [--no-graphics] [--checkpoint file]"
+           << " [--failover name] [--standby] [--calibration file]" << endl;
+      return 1;
+    }
+  }
 
-      cout << oslock << "Vision thread started!" << endl << osunlock;
-      app.visionLoop();
-      cout << oslock << "Vision thread finished!" << endl << osunlock;
+  IronDomeApp app(config);
+
+  MetricsServer metrics_server(METRICS_PORT);
+  metrics_server.start();
+
+  ThreadSupervisor supervisor(app.getStopToken());
+  supervisor.add(ThreadSpec("control"), [&app]() { app.controlsLoop(); });
+  if(config.graphics)
+    supervisor.add(ThreadSpec("graphics"), [&app]() { app.graphicsLoop(); });
+  supervisor.add(ThreadSpec("planner"), [&app]() { app.plannerLoop(); });
+  supervisor.add(ThreadSpec("io"), [&app]() { app.ioLoop(); });
+
+  for(const string& setting : thread_settings) {
+    ThreadSpec spec;
+    if(!ThreadSpec::parse(setting, spec) || !supervisor.configure(spec)) {
+      cerr << "Invalid --thread setting " << setting << "; threads are";
+      for(const string& name : supervisor.getNames()) cerr << " " << name;
+      cerr << endl;
+      return 1;
+    }
+  }
 
-    } else if (thread_id == SHELL_THREAD) {
+  supervisor.startAll();
 
-      cout << oslock << "Shell thread started!" << endl << osunlock;
-      app.shellLoop();
-      cout << oslock << "Shell thread finished!" << endl << osunlock;
-    } else if (thread_id == ROBOT_THREAD) {
+  // Run until the shell exits, the window closes or a loop fails
+  app.getStopToken().wait();
 
-      cout << oslock << "Robot thread started!" << endl << osunlock;
-      app.robotLoop();
-      cout << oslock << "Robot thread finished!" << endl << osunlock;
-    }
- 
+  if(!supervisor.joinAll(JOIN_TIMEOUT)) {
+    // A detached loop may still touch the app, so skip the destructors
+    cout << oslock << "Exiting without joining all threads." << endl << osunlock;
+    cout.flush();
+    _Exit(0);
   }
 
   cout << oslock << "Successfully exiting." << endl << osunlock;
@@ -0,0 +1,90 @@
+/**
+* AppMetrics.cpp
+* --------------
+* Registration of the metrics recorded by IronDomeApp.
+*/
+
+#include "AppMetrics.hpp"
+
+static MetricsRegistry& reg() {
+  return MetricsRegistry::instance();
+}
+
+static const char* STAGE_HELP = "Time spent in each stage of the control tick";
+static const char* QUEUE_HELP = "Length of the Redis lists used as message queues";
+static const char* TRACKS_HELP = "Number of projectiles being tracked";
+static const char* OUTCOME_HELP = "How targeting of a projectile ended";
+
+AppMetrics::AppMetrics() :
+
+  control_ticks(reg().counter("iron_dome_control_ticks_total",
+      "Control loop iterations")),
+  control_deadline_misses(reg().counter("iron_dome_control_deadline_misses_total",
+      "Control ticks that took longer than the control period")),
+  control_period(reg().histogram("iron_dome_control_period_seconds",
+      "Time between the starts of consecutive control ticks")),
+  control_tick(reg().histogram("iron_dome_control_tick_seconds",
+      "Compute time of one control tick, excluding sleep")),
+  stage_update_state(reg().histogram("iron_dome_control_stage_seconds",
+      STAGE_HELP, "stage=\"update_state\"")),
+  stage_send_to_robot(reg().histogram("iron_dome_control_stage_seconds",
+      STAGE_HELP, "stage=\"send_to_robot\"")),
+  stage_state_machine(reg().histogram("iron_dome_control_stage_seconds",
+      STAGE_HELP, "stage=\"state_machine\"")),
+  stage_controller(reg().histogram("iron_dome_control_stage_seconds",
+      STAGE_HELP, "stage=\"controller\"")),
+  stage_integrate(reg().histogram("iron_dome_control_stage_seconds",
+      STAGE_HELP, "stage=\"integrate\"")),
+
+  commands(reg().counter("iron_dome_commands_total",
+      "Commands applied by the control loop")),
+  commands_dropped(reg().counter("iron_dome_commands_dropped_total",
+      "Commands dropped because the command mailbox was full")),
+  command_latency(reg().histogram("iron_dome_command_latency_seconds",
+      "Time from posting a command to applying it in the control tick")),
+
+  planner_wakeups(reg().counter("iron_dome_planner_wakeups_total",
+      "Times the planner woke up for changed tracks")),
+  planner_evaluation(reg().histogram("iron_dome_planner_evaluation_seconds",
+      "Time to evaluate the intercepts of all tracks after a wakeup")),
+
+  graphics_frames(reg().counter("iron_dome_graphics_frames_total",
+      "Frames rendered by the graphics loop")),
+  graphics_frame(reg().histogram("iron_dome_graphics_frame_seconds",
+      "Time to update and render one frame, excluding sleep")),
+  graphics_detail_level(reg().gauge("iron_dome_graphics_detail_level",
+      "Graphics detail level, 0 for full detail and higher under load")),
+
+  observations(reg().counter("iron_dome_observations_total",
+      "Projectile observations received")),
+  invalid_observations(reg().counter("iron_dome_invalid_observations_total",
+      "Projectile observations that could not be parsed")),
+  observation_processing(reg().histogram("iron_dome_observation_processing_seconds",
+      "Time to parse an observation and update its track")),
+  robot_messages(reg().counter("iron_dome_robot_messages_total",
+      "Joint position messages received from the robot")),
+  robot_command_latency(reg().histogram("iron_dome_redis_latency_seconds",
+      "Round trip time of Redis commands", "command=\"robot_command\"")),
+  queue_projectiles(reg().gauge("iron_dome_queue_depth",
+      QUEUE_HELP, "queue=\"projectiles\"")),
+  queue_robot_data(reg().gauge("iron_dome_queue_depth",
+      QUEUE_HELP, "queue=\"robot_data\"")),
+  queue_robot_commands(reg().gauge("iron_dome_queue_depth",
+      QUEUE_HELP, "queue=\"robot_commands\"")),
+
+  tracks(reg().gauge("iron_dome_tracks", TRACKS_HELP, "state=\"all\"")),
+  converged_tracks(reg().gauge("iron_dome_tracks", TRACKS_HELP, "state=\"converged\"")),
+  dropped_tracks(reg().gauge("iron_dome_salvo_tracks_dropped",
+      "Converged tracks left out of intercept evaluation, beyond MAX_SALVO_TRACKS")),
+  state(reg().gauge("iron_dome_state",
+      "State machine state (-1 uninit, 0 idle, 1 targeting, 2 paused)")),
+  target_id(reg().gauge("iron_dome_target_id",
+      "ID of the projectile being chased, or -1")),
+  targets_acquired(reg().counter("iron_dome_targets_acquired_total",
+      "Projectiles selected as intercept targets")),
+  targets_out_of_envelope(reg().counter("iron_dome_target_outcomes_total",
+      OUTCOME_HELP, "outcome=\"out_of_envelope\"")),
+  targets_expired(reg().counter("iron_dome_target_outcomes_total",
+      OUTCOME_HELP, "outcome=\"expired\"")),
+  targets_paused(reg().counter("iron_dome_target_outcomes_total",
+      OUTCOME_HELP, "outcome=\"paused\"")) {}
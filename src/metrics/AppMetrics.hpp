@@ -0,0 +1,65 @@
+/**
+* AppMetrics.hpp
+* --------------
+* The metrics recorded by IronDomeApp, registered in one place so that
+* the app, the metrics server and the dashboard agree on names. Any
+* number of AppMetrics objects may exist; they all refer to the same
+* registry entries.
+*/
+
+#pragma once
+
+#include "MetricsRegistry.hpp"
+
+class AppMetrics {
+
+public:
+
+  AppMetrics();
+
+  // Control loop
+  Counter& control_ticks;
+  Counter& control_deadline_misses;
+  LatencyHistogram& control_period;
+  LatencyHistogram& control_tick;
+  LatencyHistogram& stage_update_state;
+  LatencyHistogram& stage_send_to_robot;
+  LatencyHistogram& stage_state_machine;
+  LatencyHistogram& stage_controller;
+  LatencyHistogram& stage_integrate;
+
+  // Commands to the control loop
+  Counter& commands;
+  Counter& commands_dropped;
+  LatencyHistogram& command_latency;
+
+  // Planner
+  Counter& planner_wakeups;
+  LatencyHistogram& planner_evaluation;
+
+  // Graphics loop
+  Counter& graphics_frames;
+  LatencyHistogram& graphics_frame;
+  Gauge& graphics_detail_level;
+
+  // Observation ingest and robot transport
+  Counter& observations;
+  Counter& invalid_observations;
+  LatencyHistogram& observation_processing;
+  Counter& robot_messages;
+  LatencyHistogram& robot_command_latency;
+  Gauge& queue_projectiles;
+  Gauge& queue_robot_data;
+  Gauge& queue_robot_commands;
+
+  // Tracking and interception
+  Gauge& tracks;
+  Gauge& converged_tracks;
+  Gauge& dropped_tracks;
+  Gauge& state;
+  Gauge& target_id;
+  Counter& targets_acquired;
+  Counter& targets_out_of_envelope;
+  Counter& targets_expired;
+  Counter& targets_paused;
+};
@@ -0,0 +1,242 @@
+/**
+* Dashboard.cpp
+* -------------
+* Implementation of the ncurses Dashboard.
+*/
+
+#include <cmath>
+#include <ncurses.h>
+
+#include "Dashboard.hpp"
+#include "../AppClock.hpp"
+
+using namespace std;
+
+// Time between screen refreshes
+static const int REFRESH_MS = 250;
+
+static const char* STATE_NAMES[] = {"uninitialized", "idle", "targeting", "paused"};
+
+// ----------------------------
+// Windows over cumulative metrics
+// ----------------------------
+
+Dashboard::HistogramWindow::HistogramWindow(const LatencyHistogram& h) : histogram(&h) {
+  for(int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) {
+    previous[i] = h.bucketCount(i);
+    delta[i] = 0;
+  }
+}
+
+void Dashboard::HistogramWindow::update() {
+  for(int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) {
+    uint64_t current = histogram->bucketCount(i);
+    delta[i] = current - previous[i];
+    previous[i] = current;
+  }
+}
+
+uint64_t Dashboard::HistogramWindow::count() const {
+  uint64_t n = 0;
+  for(int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) n += delta[i];
+  return n;
+}
+
+uint64_t Dashboard::HistogramWindow::percentile(double q) const {
+  uint64_t n = count();
+  if(n == 0) return 0;
+  uint64_t rank = static_cast<uint64_t>(q * (n - 1)) + 1;
+  uint64_t seen = 0;
+  for(int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++) {
+    seen += delta[i];
+    if(seen >= rank) return LatencyHistogram::bucketUpperBound(i);
+  }
+  return LatencyHistogram::bucketUpperBound(LatencyHistogram::NUM_BUCKETS - 1);
+}
+
+Dashboard::RateWindow::RateWindow(const Counter& c) :
+    counter(&c), previous(c.value()), current_rate(0) {}
+
+void Dashboard::RateWindow::update(double dt) {
+  uint64_t current = counter->value();
+  current_rate = (dt > 0) ? (current - previous) / dt : 0;
+  previous = current;
+}
+
+// ----------------------------
+// Dashboard
+// ----------------------------
+
+Dashboard::Dashboard(ProjectileManager& projectile_manager,
+    const Eigen::Vector3d& sphere_pos, double sphere_radius) :
+  projectile_manager(projectile_manager),
+  sphere_pos(sphere_pos),
+  sphere_radius(sphere_radius),
+  control_rate(metrics.control_ticks),
+  graphics_rate(metrics.graphics_frames),
+  observation_rate(metrics.observations),
+  robot_rate(metrics.robot_messages),
+  control_period(metrics.control_period),
+  control_tick(metrics.control_tick),
+  stage_update_state(metrics.stage_update_state),
+  stage_send_to_robot(metrics.stage_send_to_robot),
+  stage_state_machine(metrics.stage_state_machine),
+  stage_controller(metrics.stage_controller),
+  stage_integrate(metrics.stage_integrate),
+  graphics_frame(metrics.graphics_frame),
+  observation_processing(metrics.observation_processing),
+  robot_command_latency(metrics.robot_command_latency),
+  last_update(chrono::steady_clock::now()) {}
+
+void Dashboard::update() {
+
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  double dt = chrono::duration<double>(now - last_update).count();
+  last_update = now;
+
+  control_rate.update(dt);
+  graphics_rate.update(dt);
+  observation_rate.update(dt);
+  robot_rate.update(dt);
+
+  HistogramWindow* windows[] = {&control_period, &control_tick,
+      &stage_update_state, &stage_send_to_robot, &stage_state_machine,
+      &stage_controller, &stage_integrate, &graphics_frame,
+      &observation_processing, &robot_command_latency};
+  for(HistogramWindow* w : windows) w->update();
+
+  tracks = projectile_manager.getSnapshots();
+}
+
+int Dashboard::drawLatency(int row, const char* label, const HistogramWindow& h) {
+  if(h.count() == 0) {
+    mvprintw(row, 2, "%-16s %8s", label, "-");
+  } else {
+    mvprintw(row, 2, "%-16s %8llu samples  p50 %9s  p99 %9s  p99.9 %9s", label,
+        (unsigned long long) h.count(),
+        LatencyHistogram::formatDuration(h.percentile(0.5)).c_str(),
+        LatencyHistogram::formatDuration(h.percentile(0.99)).c_str(),
+        LatencyHistogram::formatDuration(h.percentile(0.999)).c_str());
+  }
+  return row + 1;
+}
+
+void Dashboard::draw() {
+
+  erase();
+  int row = 0;
+
+  attron(A_BOLD);
+  mvprintw(row++, 0, "Iron Dome    t = %.1f s    (q to quit)",
+      AppClock::now());
+  attroff(A_BOLD);
+  row++;
+
+  // Loop rates and jitter
+  attron(A_BOLD);
+  mvprintw(row++, 0, "Loops");
+  attroff(A_BOLD);
+  uint64_t p50 = control_period.percentile(0.5);
+  uint64_t p99 = control_period.percentile(0.99);
+  mvprintw(row++, 2, "control   %9.1f Hz   jitter (p99 - p50 period) %9s   deadline misses %llu",
+      control_rate.rate(), LatencyHistogram::formatDuration(p99 > p50 ? p99 - p50 : 0).c_str(),
+      (unsigned long long) metrics.control_deadline_misses.value());
+  mvprintw(row++, 2, "graphics  %9.1f Hz   detail level %.0f", graphics_rate.rate(),
+      metrics.graphics_detail_level.value());
+  mvprintw(row++, 2, "vision    %9.1f obs/s   (%llu invalid)", observation_rate.rate(),
+      (unsigned long long) metrics.invalid_observations.value());
+  mvprintw(row++, 2, "robot     %9.1f msg/s", robot_rate.rate());
+  row++;
+
+  // Latencies over the last refresh interval
+  attron(A_BOLD);
+  mvprintw(row++, 0, "Latencies");
+  attroff(A_BOLD);
+  row = drawLatency(row, "control period", control_period);
+  row = drawLatency(row, "control tick", control_tick);
+  row = drawLatency(row, "  update_state", stage_update_state);
+  row = drawLatency(row, "  send_to_robot", stage_send_to_robot);
+  row = drawLatency(row, "  state_machine", stage_state_machine);
+  row = drawLatency(row, "  controller", stage_controller);
+  row = drawLatency(row, "  integrate", stage_integrate);
+  row = drawLatency(row, "graphics frame", graphics_frame);
+  row = drawLatency(row, "observation", observation_processing);
+  row = drawLatency(row, "robot command", robot_command_latency);
+  row++;
+
+  // Queues
+  attron(A_BOLD);
+  mvprintw(row++, 0, "Queues");
+  attroff(A_BOLD);
+  mvprintw(row++, 2, "projectiles %.0f    robot_data %.0f    robot_commands %.0f",
+      metrics.queue_projectiles.value(), metrics.queue_robot_data.value(),
+      metrics.queue_robot_commands.value());
+  row++;
+
+  // State machine and target
+  int state = static_cast<int>(metrics.state.value());
+  int target_id = static_cast<int>(metrics.target_id.value());
+  attron(A_BOLD);
+  mvprintw(row++, 0, "Interception");
+  attroff(A_BOLD);
+  mvprintw(row++, 2, "state %-14s target %-6s acquired %llu  out of envelope %llu  "
+      "expired %llu  paused %llu",
+      (state >= -1 && state <= 2) ? STATE_NAMES[state + 1] : "?",
+      (target_id >= 0) ? to_string(target_id).c_str() : "none",
+      (unsigned long long) metrics.targets_acquired.value(),
+      (unsigned long long) metrics.targets_out_of_envelope.value(),
+      (unsigned long long) metrics.targets_expired.value(),
+      (unsigned long long) metrics.targets_paused.value());
+  row++;
+
+  // Track table with intercept candidates
+  int converged = 0;
+  for(const ProjectileSnapshot& s : tracks) if(s.converged) converged++;
+  attron(A_BOLD);
+  mvprintw(row++, 0, "Tracks (%d, %d converged)", static_cast<int>(tracks.size()), converged);
+  attroff(A_BOLD);
+  mvprintw(row++, 2, "%6s %5s %4s %24s %24s %9s %24s", "id", "obs", "conv",
+      "position", "velocity", "t_hit", "intercept");
+
+  double now = AppClock::now();
+  for(const ProjectileSnapshot& s : tracks) {
+    if(row >= LINES - 1) break;
+
+    Eigen::Vector3d pos = s.getPosition(now);
+    Eigen::Vector3d vel = s.getVelocity(now);
+    double t_hit = s.converged ? s.getIntersectionTime(sphere_pos, sphere_radius) : -1;
+
+    if(s.id == target_id) attron(A_REVERSE);
+    mvprintw(row, 2, "%6d %5d %4s %7.2f %7.2f %7.2f  %7.2f %7.2f %7.2f ",
+        s.id, s.observations, s.converged ? "yes" : "no",
+        pos(0), pos(1), pos(2), vel(0), vel(1), vel(2));
+    if(t_hit >= 0) {
+      Eigen::Vector3d hit = s.getPosition(t_hit);
+      printw("%8.2fs  %7.2f %7.2f %7.2f", t_hit - now, hit(0), hit(1), hit(2));
+    } else {
+      printw("%9s %24s", "-", "-");
+    }
+    if(s.id == target_id) attroff(A_REVERSE);
+    row++;
+  }
+
+  refresh();
+}
+
+void Dashboard::run(const StopToken& stop_token) {
+
+  initscr();
+  cbreak();
+  noecho();
+  curs_set(0);
+  timeout(REFRESH_MS);
+
+  while(!stop_token.stopRequested()) {
+    update();
+    draw();
+    int c = getch();
+    if(c == 'q' || c == 'Q') break;
+  }
+
+  endwin();
+}
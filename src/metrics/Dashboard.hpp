@@ -0,0 +1,92 @@
+/**
+* Dashboard.hpp
+* -------------
+* Full-screen ncurses view of the running app: loop rates and jitter,
+* stage and transport latencies, queue depths, the state machine and a
+* table of tracks with their predicted intercepts.
+*
+* Everything shown comes from the lock-free MetricsRegistry and from
+* ProjectileManager snapshots, so the dashboard never takes data_lock.
+* Latency percentiles are computed over the last refresh interval only.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "AppMetrics.hpp"
+#include "../concurrency/ThreadSupervisor.hpp"
+#include "../projectile/projectile.hpp"
+
+class Dashboard {
+
+public:
+
+  /**
+  * The intercept sphere is used to compute predicted intercepts
+  * for the track table.
+  */
+  Dashboard(ProjectileManager& projectile_manager,
+      const Eigen::Vector3d& sphere_pos, double sphere_radius);
+
+  /**
+  * Take over the terminal and refresh until the user presses 'q' or a
+  * stop is requested, then restore it. Call from the thread that owns
+  * stdin.
+  */
+  void run(const StopToken& stop_token);
+
+private:
+
+  /**
+  * Bucket counts of a histogram recorded since the previous update.
+  */
+  class HistogramWindow {
+  public:
+    explicit HistogramWindow(const LatencyHistogram& h);
+    void update();
+    uint64_t count() const;
+    uint64_t percentile(double q) const;
+  private:
+    const LatencyHistogram* histogram;
+    uint64_t previous[LatencyHistogram::NUM_BUCKETS];
+    uint64_t delta[LatencyHistogram::NUM_BUCKETS];
+  };
+
+  /**
+  * Events per second of a counter since the previous update.
+  */
+  class RateWindow {
+  public:
+    explicit RateWindow(const Counter& c);
+    void update(double dt);
+    double rate() const { return current_rate; }
+  private:
+    const Counter* counter;
+    uint64_t previous;
+    double current_rate;
+  };
+
+  void update();
+  void draw();
+  int drawLatency(int row, const char* label, const HistogramWindow& h);
+
+  ProjectileManager& projectile_manager;
+  Eigen::Vector3d sphere_pos;
+  double sphere_radius;
+
+  AppMetrics metrics;
+
+  RateWindow control_rate, graphics_rate, observation_rate, robot_rate;
+  HistogramWindow control_period, control_tick;
+  HistogramWindow stage_update_state, stage_send_to_robot, stage_state_machine,
+      stage_controller, stage_integrate;
+  HistogramWindow graphics_frame, observation_processing, robot_command_latency;
+
+  std::vector<ProjectileSnapshot> tracks;
+  std::chrono::steady_clock::time_point last_update;
+};
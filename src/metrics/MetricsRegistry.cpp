@@ -0,0 +1,135 @@
+/**
+* MetricsRegistry.cpp
+* -------------------
+* Implementation of the MetricsRegistry class and its Prometheus output.
+*/
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "MetricsRegistry.hpp"
+
+using namespace std;
+
+// Histogram buckets exported to Prometheus, as LatencyHistogram bucket
+// indices: 2^10 ns (~1 us) up to 2^34 ns (~17 s).
+static const int FIRST_EXPORTED_BUCKET = 10;
+static const int LAST_EXPORTED_BUCKET = 34;
+
+MetricsRegistry& MetricsRegistry::instance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::MetricsRegistry() : count(0) {}
+
+Metric& MetricsRegistry::lookup(Metric::Type type, const string& name,
+    const string& help, const string& labels) {
+
+  lock_guard<mutex> lg(registration_lock);
+
+  int n = count.load(memory_order_relaxed);
+  for(int i = 0; i < n; i++) {
+    Metric& m = metrics[i];
+    if(m.name != name) continue;
+    if(m.type != type)
+      throw runtime_error("Metric " + name + " registered with two types!");
+    if(m.labels == labels) return m;
+  }
+
+  if(n >= MAX_METRICS)
+    throw runtime_error("Too many metrics registered!");
+
+  Metric& m = metrics[n];
+  m.type = type;
+  m.name = name;
+  m.help = help;
+  m.labels = labels;
+
+  // Publish the new entry to lock-free readers
+  count.store(n + 1, memory_order_release);
+  return m;
+}
+
+Counter& MetricsRegistry::counter(const string& name, const string& help,
+    const string& labels) {
+  return lookup(Metric::COUNTER, name, help, labels).counter;
+}
+
+Gauge& MetricsRegistry::gauge(const string& name, const string& help,
+    const string& labels) {
+  return lookup(Metric::GAUGE, name, help, labels).gauge;
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const string& name, const string& help,
+    const string& labels) {
+  return lookup(Metric::HISTOGRAM, name, help, labels).histogram;
+}
+
+int MetricsRegistry::size() const {
+  return count.load(memory_order_acquire);
+}
+
+const Metric& MetricsRegistry::get(int i) const {
+  return metrics[i];
+}
+
+const Metric* MetricsRegistry::find(const string& name, const string& labels) const {
+  int n = size();
+  for(int i = 0; i < n; i++)
+    if(metrics[i].name == name && metrics[i].labels == labels) return &metrics[i];
+  return NULL;
+}
+
+static string withLabels(const string& name, const string& labels, const string& extra = "") {
+  string all = labels;
+  if(!extra.empty()) all += (all.empty() ? "" : ",") + extra;
+  return all.empty() ? name : name + "{" + all + "}";
+}
+
+static string formatDouble(double v) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", v);
+  return buf;
+}
+
+void MetricsRegistry::writePrometheus(ostream& os) const {
+
+  static const char* type_names[] = {"counter", "gauge", "histogram"};
+
+  int n = size();
+  for(int i = 0; i < n; i++) {
+
+    const Metric& m = metrics[i];
+
+    // HELP and TYPE once per metric family
+    bool first = true;
+    for(int j = 0; j < i; j++)
+      if(metrics[j].name == m.name) first = false;
+    if(first) {
+      os << "# HELP " << m.name << " " << m.help << "\n";
+      os << "# TYPE " << m.name << " " << type_names[m.type] << "\n";
+    }
+
+    if(m.type == Metric::COUNTER) {
+      os << withLabels(m.name, m.labels) << " " << m.counter.value() << "\n";
+
+    } else if(m.type == Metric::GAUGE) {
+      os << withLabels(m.name, m.labels) << " " << formatDouble(m.gauge.value()) << "\n";
+
+    } else {
+      const LatencyHistogram& h = m.histogram;
+      uint64_t cumulative = 0;
+      for(int b = 0; b < LatencyHistogram::NUM_BUCKETS; b++) {
+        cumulative += h.bucketCount(b);
+        if(b < FIRST_EXPORTED_BUCKET || b > LAST_EXPORTED_BUCKET) continue;
+        double le = (LatencyHistogram::bucketUpperBound(b) + 1) / 1e9;
+        os << withLabels(m.name + "_bucket", m.labels, "le=\"" + formatDouble(le) + "\"")
+           << " " << cumulative << "\n";
+      }
+      os << withLabels(m.name + "_bucket", m.labels, "le=\"+Inf\"") << " " << cumulative << "\n";
+      os << withLabels(m.name + "_sum", m.labels) << " " << formatDouble(h.sum() / 1e9) << "\n";
+      os << withLabels(m.name + "_count", m.labels) << " " << cumulative << "\n";
+    }
+  }
+}
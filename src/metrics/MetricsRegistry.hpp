@@ -0,0 +1,124 @@
+/**
+* MetricsRegistry.hpp
+* -------------------
+* Process-wide registry of counters, gauges and latency histograms.
+*
+* Metrics are registered up front (registration takes a lock) and live
+* in a fixed-capacity table for the lifetime of the program, so the
+* references handed out stay valid. Updating a metric and reading the
+* table are lock-free, which lets the metrics server and the dashboard
+* take snapshots without disturbing the threads that record them.
+*
+*   LatencyHistogram& tick = MetricsRegistry::instance().histogram(
+*       "iron_dome_control_tick_seconds", "Control tick compute time");
+*   { ScopedTimer timer(tick); ... }
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "../profiling/LatencyHistogram.hpp"
+
+class Counter {
+public:
+  Counter() : count(0) {}
+  void increment(uint64_t n = 1) { count.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return count.load(std::memory_order_relaxed); }
+private:
+  std::atomic<uint64_t> count;
+};
+
+class Gauge {
+public:
+  Gauge() : current(0) {}
+  void set(double v) { current.store(v, std::memory_order_relaxed); }
+  double value() const { return current.load(std::memory_order_relaxed); }
+private:
+  std::atomic<double> current;
+};
+
+/**
+* Records the lifetime of the object into a histogram.
+*/
+class ScopedTimer {
+public:
+  explicit ScopedTimer(LatencyHistogram& h) :
+      histogram(h), start(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+  }
+private:
+  LatencyHistogram& histogram;
+  std::chrono::steady_clock::time_point start;
+};
+
+class Metric {
+public:
+  enum Type { COUNTER, GAUGE, HISTOGRAM };
+
+  Type type;
+  std::string name;
+  std::string help;
+  std::string labels; // Prometheus label set without braces, e.g. stage="integrate"
+
+  Counter counter;
+  Gauge gauge;
+  LatencyHistogram histogram; // Durations in nanoseconds
+};
+
+class MetricsRegistry {
+
+public:
+
+  static const int MAX_METRICS = 128;
+
+  static MetricsRegistry& instance();
+
+  /**
+  * Find or register a metric. Registering the same name and labels
+  * twice returns the same object. Throws if the registry is full or
+  * the name was registered with a different type.
+  */
+  Counter& counter(const std::string& name, const std::string& help,
+      const std::string& labels = "");
+  Gauge& gauge(const std::string& name, const std::string& help,
+      const std::string& labels = "");
+  LatencyHistogram& histogram(const std::string& name, const std::string& help,
+      const std::string& labels = "");
+
+  /**
+  * Number of registered metrics. Entries [0, size()) are fully
+  * constructed and safe to read from any thread.
+  */
+  int size() const;
+  const Metric& get(int i) const;
+
+  /**
+  * Look up a registered metric without registering it. Returns NULL if
+  * it does not exist.
+  */
+  const Metric* find(const std::string& name, const std::string& labels = "") const;
+
+  /**
+  * Write every metric in the Prometheus text exposition format.
+  */
+  void writePrometheus(std::ostream& os) const;
+
+private:
+
+  MetricsRegistry();
+
+  Metric& lookup(Metric::Type type, const std::string& name,
+      const std::string& help, const std::string& labels);
+
+  Metric metrics[MAX_METRICS];
+  std::atomic<int> count;
+  std::mutex registration_lock;
+};
@@ -0,0 +1,140 @@
+/**
+* MetricsServer.cpp
+* -----------------
+* Implementation of the MetricsServer class.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../ostreamlock.hpp"
+#include "MetricsServer.hpp"
+#include "MetricsRegistry.hpp"
+
+using namespace std;
+
+// How often the server thread checks whether it should stop
+static const int POLL_TIMEOUT_MS = 200;
+
+// Give up on clients that do not send a request in time
+static const int RECEIVE_TIMEOUT_MS = 1000;
+
+MetricsServer::MetricsServer(int port) : port(port), listen_fd(-1), running(false) {
+  const char* env = getenv("IRON_DOME_METRICS_PORT");
+  if(env) this->port = atoi(env);
+}
+
+MetricsServer::~MetricsServer() {
+  stop();
+}
+
+bool MetricsServer::start() {
+
+  if(port <= 0 || running) return false;
+
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if(listen_fd < 0) return false;
+
+  int reuse = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if(bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+     || listen(listen_fd, 4) < 0) {
+    cerr << oslock << "Could not serve metrics on port " << port << ": "
+         << strerror(errno) << endl << osunlock;
+    close(listen_fd);
+    listen_fd = -1;
+    return false;
+  }
+
+  running = true;
+  server_thread = thread(&MetricsServer::serve, this);
+
+  cout << oslock << "Serving metrics at http://127.0.0.1:" << port << "/metrics"
+       << endl << osunlock;
+  return true;
+}
+
+void MetricsServer::stop() {
+  if(!running) return;
+  running = false;
+  if(server_thread.joinable()) server_thread.join();
+  close(listen_fd);
+  listen_fd = -1;
+}
+
+void MetricsServer::serve() {
+
+  while(running) {
+
+    pollfd pfd = {listen_fd, POLLIN, 0};
+    if(poll(&pfd, 1, POLL_TIMEOUT_MS) <= 0) continue;
+
+    int fd = accept(listen_fd, NULL, NULL);
+    if(fd < 0) continue;
+
+    handleConnection(fd);
+    close(fd);
+  }
+}
+
+void MetricsServer::handleConnection(int fd) {
+
+  // Read until the end of the request headers
+  string request;
+  char buf[1024];
+  while(request.find("\r\n\r\n") == string::npos && request.size() < 8192) {
+    pollfd pfd = {fd, POLLIN, 0};
+    if(poll(&pfd, 1, RECEIVE_TIMEOUT_MS) <= 0) return;
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if(n <= 0) return;
+    request.append(buf, n);
+  }
+
+  string method, path;
+  stringstream request_stream(request);
+  request_stream >> method >> path;
+
+  string status, content_type, body;
+  if(method == "GET" && (path == "/metrics" || path == "/")) {
+    stringstream body_stream;
+    MetricsRegistry::instance().writePrometheus(body_stream);
+    status = "200 OK";
+    content_type = "text/plain; version=0.0.4";
+    body = body_stream.str();
+  } else {
+    status = "404 Not Found";
+    content_type = "text/plain";
+    body = "Not found\n";
+  }
+
+  stringstream response;
+  response << "HTTP/1.0 " << status << "\r\n"
+           << "Content-Type: " << content_type << "\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: close\r\n\r\n"
+           << body;
+
+  string out = response.str();
+  size_t sent = 0;
+  while(sent < out.size()) {
+    ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+    if(n <= 0) return;
+    sent += n;
+  }
+}
@@ -0,0 +1,48 @@
+/**
+* MetricsServer.hpp
+* -----------------
+* Minimal HTTP server on localhost that serves the MetricsRegistry in
+* Prometheus text format at /metrics. Runs on its own thread and only
+* reads the registry, so a scrape never takes a lock that the control
+* loop might need.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+class MetricsServer {
+
+public:
+
+  /**
+  * Serve on 127.0.0.1 at the given port. The port can be overridden
+  * with IRON_DOME_METRICS_PORT; a port of 0 disables the server.
+  */
+  explicit MetricsServer(int port);
+  ~MetricsServer();
+
+  /**
+  * Bind the socket and start serving. Returns false if the port
+  * could not be bound.
+  */
+  bool start();
+
+  /**
+  * Stop serving and join the server thread.
+  */
+  void stop();
+
+  int getPort() const { return port; }
+
+private:
+
+  void serve();
+  void handleConnection(int fd);
+
+  int port;
+  int listen_fd;
+  std::atomic<bool> running;
+  std::thread server_thread;
+};
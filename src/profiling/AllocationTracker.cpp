@@ -0,0 +1,310 @@
+/**
+* AllocationTracker.cpp
+* ---------------------
+* Counting replacements for the malloc family, and the reports built
+* from them. Nothing in the hooks may allocate: all bookkeeping lives in
+* fixed-size static tables updated with atomics.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include "AllocationTracker.hpp"
+
+using namespace std;
+
+#ifndef IRON_DOME_ALLOC_TRACKING
+
+bool AllocationTracker::isAvailable() { return false; }
+void AllocationTracker::setMode(Mode mode) {}
+AllocationTracker::Mode AllocationTracker::getMode() { return MODE_OFF; }
+void AllocationTracker::registerThread(const char* name) {}
+void AllocationTracker::report(ostream& os) {
+  os << "Allocation tracking is not compiled in. "
+     << "Rebuild with -DIRON_DOME_ALLOC_TRACKING=ON.\n";
+}
+void AllocationTracker::getThreadCounts(uint64_t& allocations, uint64_t& rt_allocations) {
+  allocations = rt_allocations = 0;
+}
+void AllocationTracker::reset() {}
+
+#else
+
+#include <unistd.h>
+#include <execinfo.h>
+
+#include "Symbolizer.hpp"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+static const int MAX_THREADS = 64;
+static const int MAX_SITES = 256;
+static const int STACK_DEPTH = 12;
+
+// Limits on how much of the site table is printed
+static const int REPORTED_SITES = 20;
+static const int REPORTED_FRAMES = 8;
+
+// Frames belonging to the hook itself (noteAllocation, malloc)
+static const int SKIPPED_FRAMES = 2;
+
+struct ThreadAllocStats {
+  atomic<bool> used;
+  char name[32];
+  atomic<uint64_t> allocations;
+  atomic<uint64_t> bytes;
+  atomic<uint64_t> frees;
+  atomic<uint64_t> rt_allocations;
+  atomic<uint64_t> rt_bytes;
+};
+
+struct AllocationSite {
+  atomic<uint64_t> hash;   // Zero while the slot is free
+  atomic<bool> ready;      // Frames have been written
+  void* frames[STACK_DEPTH];
+  int depth;
+  const char* section;
+  atomic<uint64_t> count;
+  atomic<uint64_t> bytes;
+};
+
+static atomic<int> alloc_mode(AllocationTracker::MODE_OFF);
+static ThreadAllocStats thread_stats[MAX_THREADS];
+static AllocationSite sites[MAX_SITES];
+static atomic<uint64_t> dropped_sites(0);
+
+static thread_local ThreadAllocStats* current_thread = NULL;
+static thread_local int rt_depth = 0;
+static thread_local const char* rt_name = NULL;
+static thread_local bool in_hook = false;
+
+static ThreadAllocStats* claimThreadSlot(const char* name) {
+  for(int i = 0; i < MAX_THREADS; i++) {
+    bool expected = false;
+    if(thread_stats[i].used.compare_exchange_strong(expected, true)) {
+      strncpy(thread_stats[i].name, name, sizeof(thread_stats[i].name) - 1);
+      return &thread_stats[i];
+    }
+  }
+  return NULL;
+}
+
+static void recordSite(size_t size) {
+
+  void* frames[STACK_DEPTH + SKIPPED_FRAMES];
+  int depth = backtrace(frames, STACK_DEPTH + SKIPPED_FRAMES) - SKIPPED_FRAMES;
+  if(depth <= 0) return;
+
+  // FNV-1a over the return addresses
+  uint64_t hash = 1469598103934665603ULL;
+  for(int i = 0; i < depth; i++) {
+    hash ^= reinterpret_cast<uintptr_t>(frames[i + SKIPPED_FRAMES]);
+    hash *= 1099511628211ULL;
+  }
+  if(hash == 0) hash = 1;
+
+  for(int n = 0; n < MAX_SITES; n++) {
+    AllocationSite& s = sites[(hash + n) % MAX_SITES];
+    uint64_t current = s.hash.load(memory_order_acquire);
+    if(current == 0 && s.hash.compare_exchange_strong(current, hash)) {
+      memcpy(s.frames, frames + SKIPPED_FRAMES, depth * sizeof(void*));
+      s.depth = depth;
+      s.section = rt_name;
+      s.ready.store(true, memory_order_release);
+      current = hash;
+    }
+    if(current == hash) {
+      s.count.fetch_add(1, memory_order_relaxed);
+      s.bytes.fetch_add(size, memory_order_relaxed);
+      return;
+    }
+  }
+  dropped_sites.fetch_add(1, memory_order_relaxed);
+}
+
+static void writeStderr(const char* str) {
+  ssize_t ignored = write(STDERR_FILENO, str, strlen(str));
+  (void) ignored;
+}
+
+static inline void noteAllocation(size_t size) {
+
+  int mode = alloc_mode.load(memory_order_relaxed);
+  if(mode == AllocationTracker::MODE_OFF || in_hook) return;
+  in_hook = true;
+
+  if(!current_thread) current_thread = claimThreadSlot("unnamed");
+  if(current_thread) {
+    current_thread->allocations.fetch_add(1, memory_order_relaxed);
+    current_thread->bytes.fetch_add(size, memory_order_relaxed);
+    if(rt_depth > 0) {
+      current_thread->rt_allocations.fetch_add(1, memory_order_relaxed);
+      current_thread->rt_bytes.fetch_add(size, memory_order_relaxed);
+    }
+  }
+
+  if(rt_depth > 0) {
+    recordSite(size);
+    if(mode == AllocationTracker::MODE_ASSERT) {
+      writeStderr("FATAL: heap allocation in real-time section '");
+      writeStderr(rt_name ? rt_name : "?");
+      writeStderr("' on thread '");
+      writeStderr(current_thread ? current_thread->name : "?");
+      writeStderr("':\n");
+      void* frames[32];
+      backtrace_symbols_fd(frames, backtrace(frames, 32), STDERR_FILENO);
+      abort();
+    }
+  }
+
+  in_hook = false;
+}
+
+static inline void noteFree() {
+  if(alloc_mode.load(memory_order_relaxed) == AllocationTracker::MODE_OFF || in_hook) return;
+  if(current_thread) current_thread->frees.fetch_add(1, memory_order_relaxed);
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+  noteAllocation(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+  noteAllocation(n * size);
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  noteAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+  if(ptr) noteFree();
+  __libc_free(ptr);
+}
+
+}
+
+// ----------------------------
+// AllocationTracker
+// ----------------------------
+
+bool AllocationTracker::isAvailable() {
+  return true;
+}
+
+void AllocationTracker::setMode(Mode mode) {
+
+  // backtrace() loads the unwinder lazily, which allocates. Do that
+  // now rather than from inside the first real-time allocation.
+  void* frames[1];
+  backtrace(frames, 1);
+
+  alloc_mode.store(mode, memory_order_relaxed);
+}
+
+AllocationTracker::Mode AllocationTracker::getMode() {
+  return static_cast<Mode>(alloc_mode.load(memory_order_relaxed));
+}
+
+void AllocationTracker::registerThread(const char* name) {
+  if(current_thread) {
+    strncpy(current_thread->name, name, sizeof(current_thread->name) - 1);
+  } else {
+    current_thread = claimThreadSlot(name);
+  }
+}
+
+void AllocationTracker::report(ostream& os) {
+
+  static const char* mode_names[] = {"off", "count", "assert"};
+  os << "Allocation tracking mode: " << mode_names[getMode()] << "\n\n";
+
+  os << "Per-thread allocations (total / in real-time sections):\n";
+  for(int i = 0; i < MAX_THREADS; i++) {
+    ThreadAllocStats& s = thread_stats[i];
+    if(!s.used.load()) continue;
+    os << "  " << s.name << ": "
+       << s.allocations.load() << " allocs (" << s.bytes.load() << " B), "
+       << s.frees.load() << " frees / "
+       << s.rt_allocations.load() << " allocs (" << s.rt_bytes.load() << " B)\n";
+  }
+
+  vector<AllocationSite*> hot;
+  for(int i = 0; i < MAX_SITES; i++)
+    if(sites[i].ready.load(memory_order_acquire)) hot.push_back(&sites[i]);
+  sort(hot.begin(), hot.end(), [](AllocationSite* a, AllocationSite* b) {
+    return a->count.load() > b->count.load();
+  });
+
+  os << "\nReal-time allocation sites (" << hot.size() << " distinct";
+  if(dropped_sites.load()) os << ", " << dropped_sites.load() << " not recorded";
+  os << "):\n";
+  for(size_t n = 0; n < hot.size() && n < REPORTED_SITES; n++) {
+    AllocationSite* s = hot[n];
+    os << "  " << s->count.load() << " allocs, " << s->bytes.load() << " B in '"
+       << (s->section ? s->section : "?") << "'\n";
+    for(int i = 0; i < s->depth && i < REPORTED_FRAMES; i++)
+      os << "      " << symbolize(s->frames[i]) << "\n";
+  }
+}
+
+void AllocationTracker::getThreadCounts(uint64_t& allocations, uint64_t& rt_allocations) {
+  allocations = current_thread ? current_thread->allocations.load() : 0;
+  rt_allocations = current_thread ? current_thread->rt_allocations.load() : 0;
+}
+
+void AllocationTracker::reset() {
+  for(int i = 0; i < MAX_THREADS; i++) {
+    ThreadAllocStats& s = thread_stats[i];
+    s.allocations = 0;
+    s.bytes = 0;
+    s.frees = 0;
+    s.rt_allocations = 0;
+    s.rt_bytes = 0;
+  }
+  for(int i = 0; i < MAX_SITES; i++) {
+    sites[i].count = 0;
+    sites[i].bytes = 0;
+  }
+  dropped_sites = 0;
+}
+
+// Pick up the initial mode from the environment
+static struct AllocationModeFromEnv {
+  AllocationModeFromEnv() {
+    const char* env = getenv("IRON_DOME_ALLOC_MODE");
+    if(!env) return;
+    if(strcmp(env, "count") == 0) AllocationTracker::setMode(AllocationTracker::MODE_COUNT);
+    if(strcmp(env, "assert") == 0) AllocationTracker::setMode(AllocationTracker::MODE_ASSERT);
+  }
+} alloc_mode_from_env;
+
+// ----------------------------
+// RealTimeSection
+// ----------------------------
+
+RealTimeSection::RealTimeSection(const char* name) : previous_name(rt_name) {
+  rt_depth++;
+  rt_name = name;
+}
+
+RealTimeSection::~RealTimeSection() {
+  rt_name = previous_name;
+  rt_depth--;
+}
+
+#endif
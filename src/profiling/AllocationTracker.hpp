@@ -0,0 +1,94 @@
+/**
+* AllocationTracker.hpp
+* ---------------------
+* Counts heap allocations per thread and catches allocations inside
+* designated real-time sections, such as the control tick.
+*
+* Only available when built with -DIRON_DOME_ALLOC_TRACKING=ON, which
+* replaces malloc/calloc/realloc/free (and with them operator new and
+* Eigen's allocator) with counting wrappers. In other builds every call
+* here is a no-op.
+*
+* Modes, set with IRON_DOME_ALLOC_MODE or from the shell (`allocs`):
+*   off    - nothing is recorded
+*   count  - count allocations, remember real-time call stacks
+*   assert - as count, but abort on the first real-time allocation
+*
+*   void IronDomeApp::controlsLoop() {
+*     AllocationTracker::registerThread("control");
+*     while(...) {
+*       RealTimeSection rt("control tick");
+*       ...
+*     }
+*   }
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+class AllocationTracker {
+
+public:
+
+  enum Mode { MODE_OFF = 0, MODE_COUNT = 1, MODE_ASSERT = 2 };
+
+  /**
+  * Whether the allocation hooks are compiled into this build.
+  */
+  static bool isAvailable();
+
+  static void setMode(Mode mode);
+  static Mode getMode();
+
+  /**
+  * Name the calling thread's counters in reports. Threads that never
+  * register are reported as "unnamed".
+  */
+  static void registerThread(const char* name);
+
+  /**
+  * Print per-thread counters and the call stacks of allocations made
+  * inside real-time sections, most frequent first.
+  */
+  static void report(std::ostream& os);
+
+  /**
+  * Counters of the calling thread since it registered or since the
+  * last reset(): all allocations, and those in real-time sections.
+  * Zero if tracking is not compiled in or the thread never registered.
+  */
+  static void getThreadCounts(uint64_t& allocations, uint64_t& rt_allocations);
+
+  static void reset();
+};
+
+/**
+* RAII marker for a real-time section on the calling thread. Sections
+* may nest. While one is active, any heap allocation on this thread is
+* recorded (or aborts, in assert mode). Eigen's allocations go through
+* malloc, so they are caught the same way; its own runtime malloc flag
+* is process-wide and would also fire on other threads, so it is left
+* alone.
+*/
+class RealTimeSection {
+
+public:
+
+#ifdef IRON_DOME_ALLOC_TRACKING
+  explicit RealTimeSection(const char* name);
+  ~RealTimeSection();
+#else
+  explicit RealTimeSection(const char* name) {}
+#endif
+
+  RealTimeSection(const RealTimeSection&) = delete;
+  RealTimeSection& operator=(const RealTimeSection&) = delete;
+
+private:
+
+#ifdef IRON_DOME_ALLOC_TRACKING
+  const char* previous_name;
+#endif
+};
@@ -0,0 +1,88 @@
+/**
+* LatencyHistogram.cpp
+* --------------------
+* Implementation of the LatencyHistogram class.
+*/
+
+#include <cstdio>
+
+#include "LatencyHistogram.hpp"
+
+using namespace std;
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+
+  // Index of the highest set bit, plus one
+  int i = (ns == 0) ? 0 : 64 - __builtin_clzll(ns);
+  if(i >= NUM_BUCKETS) i = NUM_BUCKETS - 1;
+
+  buckets[i].fetch_add(1, memory_order_relaxed);
+  total_count.fetch_add(1, memory_order_relaxed);
+  total_ns.fetch_add(ns, memory_order_relaxed);
+
+  uint64_t prev = max_ns.load(memory_order_relaxed);
+  while(ns > prev && !max_ns.compare_exchange_weak(prev, ns, memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::reset() {
+  for(int i = 0; i < NUM_BUCKETS; i++)
+    buckets[i].store(0, memory_order_relaxed);
+  total_count.store(0, memory_order_relaxed);
+  total_ns.store(0, memory_order_relaxed);
+  max_ns.store(0, memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+  return total_count.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::sum() const {
+  return total_ns.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+  return max_ns.load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucketCount(int i) const {
+  return buckets[i].load(memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int i) {
+  if(i <= 0) return 0;
+  return (static_cast<uint64_t>(1) << i) - 1;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+
+  // Counts are read individually, so the total may be slightly
+  // inconsistent with the buckets while other threads record.
+  uint64_t n = 0;
+  for(int i = 0; i < NUM_BUCKETS; i++) n += bucketCount(i);
+  if(n == 0) return 0;
+
+  uint64_t rank = static_cast<uint64_t>(q * (n - 1)) + 1;
+  uint64_t seen = 0;
+  for(int i = 0; i < NUM_BUCKETS; i++) {
+    seen += bucketCount(i);
+    if(seen >= rank) {
+      uint64_t bound = bucketUpperBound(i);
+      uint64_t largest = max();
+      return (bound < largest) ? bound : largest;
+    }
+  }
+  return max();
+}
+
+string LatencyHistogram::formatDuration(uint64_t ns) {
+  char buf[32];
+  if(ns < 1000) snprintf(buf, sizeof(buf), "%lluns", (unsigned long long) ns);
+  else if(ns < 1000000) snprintf(buf, sizeof(buf), "%.1fus", ns / 1e3);
+  else if(ns < 1000000000) snprintf(buf, sizeof(buf), "%.2fms", ns / 1e6);
+  else snprintf(buf, sizeof(buf), "%.3fs", ns / 1e9);
+  return buf;
+}
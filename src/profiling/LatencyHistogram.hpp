@@ -0,0 +1,63 @@
+/**
+* LatencyHistogram.hpp
+* --------------------
+* Lock-free histogram of durations in nanoseconds, bucketed by powers
+* of two. Recording is a handful of relaxed atomic operations, so it is
+* safe to call from the control loop and from any number of threads.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class LatencyHistogram {
+
+public:
+
+  // Bucket i holds durations in [2^(i-1), 2^i) ns; bucket 0 holds zero.
+  static const int NUM_BUCKETS = 48;
+
+  LatencyHistogram();
+
+  /**
+  * Add one duration sample, in nanoseconds.
+  */
+  void record(uint64_t ns);
+
+  /**
+  * Clear all samples.
+  */
+  void reset();
+
+  uint64_t count() const;
+  uint64_t sum() const;
+  uint64_t max() const;
+
+  /**
+  * Approximate q-th quantile (0 <= q <= 1) in nanoseconds. Returns
+  * the upper bound of the bucket the quantile falls into, clamped
+  * to the largest recorded sample.
+  */
+  uint64_t percentile(double q) const;
+
+  uint64_t bucketCount(int i) const;
+
+  /**
+  * Upper bound of bucket i in nanoseconds.
+  */
+  static uint64_t bucketUpperBound(int i);
+
+  /**
+  * Format a duration in nanoseconds with a human-readable unit.
+  */
+  static std::string formatDuration(uint64_t ns);
+
+private:
+
+  std::atomic<uint64_t> buckets[NUM_BUCKETS];
+  std::atomic<uint64_t> total_count;
+  std::atomic<uint64_t> total_ns;
+  std::atomic<uint64_t> max_ns;
+};
@@ -0,0 +1,215 @@
+/**
+* ProfiledMutex.cpp
+* -----------------
+* Implementation of the ProfiledMutex class and its report.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "ProfiledMutex.hpp"
+#include "Symbolizer.hpp"
+
+using namespace std;
+
+static atomic<bool> profiling_enabled(getenv("IRON_DOME_LOCK_PROFILE") != NULL);
+
+// All LockStats ever created. Entries are never freed, so pointers
+// held by mutexes stay valid for the lifetime of the program.
+static mutex registry_lock;
+static vector<unique_ptr<LockStats>>& registry() {
+  static vector<unique_ptr<LockStats>> stats;
+  return stats;
+}
+
+static LockStats* lookupStats(const string& name) {
+  lock_guard<mutex> lg(registry_lock);
+  for(unique_ptr<LockStats>& s : registry())
+    if(s->name == name) return s.get();
+  registry().emplace_back(new LockStats(name));
+  return registry().back().get();
+}
+
+static uint64_t nanosBetween(chrono::steady_clock::time_point a,
+                             chrono::steady_clock::time_point b) {
+  return chrono::duration_cast<chrono::nanoseconds>(b - a).count();
+}
+
+// ----------------------------
+// LockSiteStats / LockStats
+// ----------------------------
+
+LockSiteStats::LockSiteStats() : addr(NULL), blocking_ns(0) {}
+
+LockStats::LockStats(const string& name) : name(name), contended(0) {}
+
+LockSiteStats* LockStats::site(const void* addr) {
+
+  // Open addressing on the address; slots are claimed with a CAS
+  // and never released (reset() only clears the histograms).
+  size_t start = (reinterpret_cast<uintptr_t>(addr) >> 4) % (MAX_SITES - 1);
+  for(int n = 0; n < MAX_SITES - 1; n++) {
+    LockSiteStats& s = sites[(start + n) % (MAX_SITES - 1)];
+    const void* current = s.addr.load(memory_order_acquire);
+    if(current == addr) return &s;
+    if(current == NULL) {
+      if(s.addr.compare_exchange_strong(current, addr, memory_order_acq_rel))
+        return &s;
+      if(current == addr) return &s;
+    }
+  }
+  return &sites[MAX_SITES - 1];
+}
+
+void LockStats::reset() {
+  contended.store(0, memory_order_relaxed);
+  wait.reset();
+  hold.reset();
+  for(int i = 0; i < MAX_SITES; i++) {
+    sites[i].wait.reset();
+    sites[i].hold.reset();
+    sites[i].blocking_ns.store(0, memory_order_relaxed);
+  }
+}
+
+// ----------------------------
+// ProfiledMutex
+// ----------------------------
+
+ProfiledMutex::ProfiledMutex(const char* name) :
+    stats(lookupStats(name)), profiled(false), holder(NULL) {}
+
+void ProfiledMutex::setEnabled(bool enabled) {
+  profiling_enabled.store(enabled, memory_order_relaxed);
+}
+
+bool ProfiledMutex::isEnabled() {
+  return profiling_enabled.load(memory_order_relaxed);
+}
+
+__attribute__((noinline)) void ProfiledMutex::lock() {
+
+  if(!isEnabled()) {
+    mtx.lock();
+    profiled = false;
+    return;
+  }
+
+  const void* caller = __builtin_return_address(0);
+  Clock::time_point t_request = Clock::now();
+
+  if(!mtx.try_lock()) {
+
+    // Blame the current holder for the time we are about to wait
+    LockSiteStats* blocker = holder.load(memory_order_relaxed);
+    mtx.lock();
+    Clock::time_point t_now = Clock::now();
+    stats->contended.fetch_add(1, memory_order_relaxed);
+    if(blocker)
+      blocker->blocking_ns.fetch_add(nanosBetween(t_request, t_now), memory_order_relaxed);
+  }
+
+  acquired(caller, t_request);
+}
+
+__attribute__((noinline)) bool ProfiledMutex::try_lock() {
+
+  if(!mtx.try_lock()) return false;
+
+  if(!isEnabled()) {
+    profiled = false;
+    return true;
+  }
+
+  acquired(__builtin_return_address(0), Clock::now());
+  return true;
+}
+
+void ProfiledMutex::acquired(const void* caller, Clock::time_point t_request) {
+
+  t_acquired = Clock::now();
+  profiled = true;
+
+  uint64_t waited = nanosBetween(t_request, t_acquired);
+  LockSiteStats* site = stats->site(caller);
+  stats->wait.record(waited);
+  site->wait.record(waited);
+  holder.store(site, memory_order_relaxed);
+}
+
+void ProfiledMutex::unlock() {
+
+  if(profiled) {
+    uint64_t held = nanosBetween(t_acquired, Clock::now());
+    LockSiteStats* site = holder.load(memory_order_relaxed);
+    stats->hold.record(held);
+    if(site) site->hold.record(held);
+    holder.store(NULL, memory_order_relaxed);
+    profiled = false;
+  }
+
+  mtx.unlock();
+}
+
+static void printHistogram(ostream& os, const char* label, const LatencyHistogram& h) {
+  os << "    " << label
+     << "  p50 " << setw(9) << LatencyHistogram::formatDuration(h.percentile(0.50))
+     << "  p99 " << setw(9) << LatencyHistogram::formatDuration(h.percentile(0.99))
+     << "  max " << setw(9) << LatencyHistogram::formatDuration(h.max())
+     << "  total " << setw(9) << LatencyHistogram::formatDuration(h.sum())
+     << "\n";
+}
+
+void ProfiledMutex::report(ostream& os) {
+
+  lock_guard<mutex> lg(registry_lock);
+
+  os << "Lock profiling is " << (isEnabled() ? "enabled" : "disabled") << ".\n";
+
+  for(unique_ptr<LockStats>& s : registry()) {
+
+    uint64_t n = s->wait.count();
+    if(n == 0) continue;
+
+    char contended_pct[16];
+    snprintf(contended_pct, sizeof(contended_pct), "%.2f%%",
+        100.0 * s->contended.load(memory_order_relaxed) / n);
+    os << "\n" << s->name << ": " << n << " acquisitions, "
+       << contended_pct << " contended\n";
+    printHistogram(os, "wait", s->wait);
+    printHistogram(os, "hold", s->hold);
+
+    // Sort call sites by total hold time, worst first
+    vector<LockSiteStats*> sites;
+    for(int i = 0; i < LockStats::MAX_SITES; i++)
+      if(s->sites[i].hold.count() > 0 || s->sites[i].wait.count() > 0)
+        sites.push_back(&s->sites[i]);
+    sort(sites.begin(), sites.end(), [](LockSiteStats* a, LockSiteStats* b) {
+      return a->hold.sum() > b->hold.sum();
+    });
+
+    for(LockSiteStats* site : sites) {
+      const void* addr = site->addr.load(memory_order_relaxed);
+      os << "  " << (addr ? symbolize(addr) : string("<other sites>"))
+         << "  (" << site->wait.count() << " acquisitions, made others wait "
+         << LatencyHistogram::formatDuration(site->blocking_ns.load(memory_order_relaxed))
+         << ")\n";
+      printHistogram(os, "wait", site->wait);
+      printHistogram(os, "hold", site->hold);
+    }
+  }
+}
+
+void ProfiledMutex::reset() {
+  lock_guard<mutex> lg(registry_lock);
+  for(unique_ptr<LockStats>& s : registry())
+    s->reset();
+}
+
+const LockStats& ProfiledMutex::getStats(const string& name) {
+  return *lookupStats(name);
+}
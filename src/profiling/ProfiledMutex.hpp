@@ -0,0 +1,115 @@
+/**
+* ProfiledMutex.hpp
+* -----------------
+* Drop-in replacement for std::mutex that records how long threads
+* wait to acquire it, how long it is held, and from which call sites.
+* Statistics are aggregated per lock name, so all mutexes constructed
+* with the same name (e.g. one per Projectile) share one report entry.
+*
+* Profiling is off by default and costs a single atomic load per lock
+* when disabled. Enable it from the shell (`locks on`) or by setting
+* IRON_DOME_LOCK_PROFILE=1 in the environment.
+*
+*   ProfiledMutex m("ProjectileManager::projectile_lock");
+*   std::lock_guard<ProfiledMutex> lg(m);
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "LatencyHistogram.hpp"
+
+/**
+* Statistics for one call site that acquired a lock.
+*/
+class LockSiteStats {
+public:
+  LockSiteStats();
+
+  std::atomic<const void*> addr; // Return address of the lock() call
+  LatencyHistogram wait;         // Time spent waiting to acquire
+  LatencyHistogram hold;         // Time spent holding the lock
+  std::atomic<uint64_t> blocking_ns; // Wait time other threads spent on this site
+};
+
+/**
+* Statistics for all mutexes sharing a name.
+*/
+class LockStats {
+public:
+
+  static const int MAX_SITES = 64;
+
+  explicit LockStats(const std::string& name);
+
+  /**
+  * Find or insert the entry for a call site. Lock-free; if the table
+  * is full, the last slot collects all remaining sites.
+  */
+  LockSiteStats* site(const void* addr);
+
+  void reset();
+
+  const std::string name;
+
+  std::atomic<uint64_t> contended; // Acquisitions that had to wait
+  LatencyHistogram wait;
+  LatencyHistogram hold;
+  LockSiteStats sites[MAX_SITES];
+};
+
+class ProfiledMutex {
+
+public:
+
+  explicit ProfiledMutex(const char* name = "unnamed");
+
+  ProfiledMutex(const ProfiledMutex&) = delete;
+  ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+
+  /**
+  * Turn recording on or off for all profiled mutexes.
+  */
+  static void setEnabled(bool enabled);
+  static bool isEnabled();
+
+  /**
+  * Print a per-lock, per-call-site report of wait and hold times.
+  */
+  static void report(std::ostream& os);
+
+  /**
+  * Clear all recorded statistics.
+  */
+  static void reset();
+
+  /**
+  * Statistics shared by all mutexes with the given name.
+  */
+  static const LockStats& getStats(const std::string& name);
+
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  void acquired(const void* caller, Clock::time_point t_request);
+
+  std::mutex mtx;
+  LockStats* stats;
+
+  // Written only by the thread holding mtx
+  bool profiled;
+  Clock::time_point t_acquired;
+
+  // Read by waiting threads to attribute their wait to the holder
+  std::atomic<LockSiteStats*> holder;
+};
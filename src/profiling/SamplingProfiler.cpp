@@ -0,0 +1,186 @@
+/**
+* SamplingProfiler.cpp
+* --------------------
+* SIGPROF-driven stack sampling. The signal handler only uses backtrace()
+* (primed before the timer is armed, so it does not allocate) and atomic
+* operations on a buffer allocated before the timer is armed.
+*/
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "SamplingProfiler.hpp"
+#include "Symbolizer.hpp"
+
+using namespace std;
+
+// Frames belonging to the signal handler and the kernel trampoline
+static const int SKIPPED_FRAMES = 2;
+
+struct StackSample {
+  pid_t tid;
+  int depth;
+  void* frames[SamplingProfiler::MAX_DEPTH];
+};
+
+// Allocated by start() and kept until the next one, for writeFolded()
+static StackSample* samples = NULL;
+static int max_samples = 0;
+
+static atomic<int> next_sample(0);
+static atomic<int> dropped(0);
+static atomic<bool> running(false);
+static bool handler_installed = false;
+
+static void onSigprof(int sig, siginfo_t* info, void* context) {
+
+  if(!running.load(memory_order_acquire)) return;
+
+  int saved_errno = errno;
+
+  int i = next_sample.fetch_add(1, memory_order_relaxed);
+  if(i >= max_samples) {
+    dropped.fetch_add(1, memory_order_relaxed);
+    errno = saved_errno;
+    return;
+  }
+
+  void* frames[SamplingProfiler::MAX_DEPTH + SKIPPED_FRAMES];
+  int depth = backtrace(frames, SamplingProfiler::MAX_DEPTH + SKIPPED_FRAMES) - SKIPPED_FRAMES;
+  if(depth < 0) depth = 0;
+
+  StackSample& s = samples[i];
+  s.tid = static_cast<pid_t>(syscall(SYS_gettid));
+  memcpy(s.frames, frames + SKIPPED_FRAMES, depth * sizeof(void*));
+
+  // Publish the depth last; writeFolded() skips samples with depth 0
+  __atomic_store_n(&s.depth, depth, __ATOMIC_RELEASE);
+
+  errno = saved_errno;
+}
+
+bool SamplingProfiler::start(int hz, int n) {
+
+  if(hz <= 0 || n <= 0 || running) return false;
+
+  // Zeroed pages, so every depth starts at 0 without touching the
+  // buffer; only the slots sampled into are ever committed. No handler
+  // uses the old buffer, since running is false.
+  free(samples);
+  samples = static_cast<StackSample*>(calloc(n, sizeof(StackSample)));
+  max_samples = samples ? n : 0;
+  if(!samples) return false;
+  next_sample = 0;
+  dropped = 0;
+  running.store(true, memory_order_release);
+
+  // The first backtrace() loads the unwinder, which is not safe to do
+  // inside a signal handler
+  void* frames[1];
+  backtrace(frames, 1);
+
+  // The handler stays installed after stop(), so that a signal still in
+  // flight when the timer is disarmed is ignored rather than killing us
+  if(!handler_installed) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = onSigprof;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if(sigaction(SIGPROF, &action, NULL) != 0) {
+      running = false;
+      return false;
+    }
+    handler_installed = true;
+  }
+
+  long period_us = 1000000 / hz;
+  if(period_us < 1) period_us = 1;
+  itimerval timer;
+  timer.it_interval.tv_sec = period_us / 1000000;
+  timer.it_interval.tv_usec = period_us % 1000000;
+  timer.it_value = timer.it_interval;
+  if(setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    running = false;
+    return false;
+  }
+
+  return true;
+}
+
+void SamplingProfiler::stop() {
+
+  if(!running) return;
+
+  itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  running = false;
+}
+
+bool SamplingProfiler::isRunning() {
+  return running;
+}
+
+int SamplingProfiler::numSamples() {
+  int n = next_sample.load();
+  return (n < max_samples) ? n : max_samples;
+}
+
+int SamplingProfiler::numDropped() {
+  return dropped.load();
+}
+
+static string threadName(pid_t tid) {
+  ifstream comm("/proc/self/task/" + to_string(tid) + "/comm");
+  string name;
+  if(comm && getline(comm, name) && !name.empty()) return name;
+  return "thread-" + to_string(tid);
+}
+
+void SamplingProfiler::writeFolded(ostream& os) {
+
+  map<void*, string> symbols;
+  map<pid_t, string> thread_names;
+  map<string, int> folded;
+
+  int n = numSamples();
+  for(int i = 0; i < n; i++) {
+
+    const StackSample& s = samples[i];
+    int depth = __atomic_load_n(&s.depth, __ATOMIC_ACQUIRE);
+    if(depth <= 0) continue;
+
+    if(thread_names.find(s.tid) == thread_names.end())
+      thread_names[s.tid] = threadName(s.tid);
+
+    // Folded stacks are root first; backtrace() is leaf first
+    string stack = thread_names[s.tid];
+    for(int f = depth - 1; f >= 0; f--) {
+      void* addr = s.frames[f];
+      if(symbols.find(addr) == symbols.end()) {
+        // Return addresses point after the call; step back into it
+        string name = symbolizeFunction(static_cast<char*>(addr) - 1);
+        for(char& c : name) if(c == ';' || c == ' ') c = '_';
+        symbols[addr] = name;
+      }
+      stack += ";" + symbols[addr];
+    }
+    folded[stack]++;
+  }
+
+  for(pair<const string, int>& entry : folded)
+    os << entry.first << " " << entry.second << "\n";
+}
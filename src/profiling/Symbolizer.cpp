@@ -0,0 +1,63 @@
+/**
+* Symbolizer.cpp
+* --------------
+* Implementation of address symbolization via dladdr().
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <dlfcn.h>
+#include <cxxabi.h>
+
+#include "Symbolizer.hpp"
+
+using namespace std;
+
+static string demangle(const char* name) {
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+  if(status != 0 || !demangled) return name;
+  string result(demangled);
+  free(demangled);
+  return result;
+}
+
+static string describe(const void* addr, bool with_offset) {
+
+  char buf[64];
+  Dl_info info;
+
+  if(!addr || !dladdr(addr, &info)) {
+    snprintf(buf, sizeof(buf), "%p", addr);
+    return buf;
+  }
+
+  string name;
+  uintptr_t base;
+  if(info.dli_sname) {
+    name = demangle(info.dli_sname);
+    base = reinterpret_cast<uintptr_t>(info.dli_saddr);
+  } else {
+    const char* module = info.dli_fname ? strrchr(info.dli_fname, '/') : NULL;
+    name = module ? module + 1 : (info.dli_fname ? info.dli_fname : "??");
+    base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+  }
+
+  if(with_offset) {
+    snprintf(buf, sizeof(buf), "+0x%lx",
+        static_cast<unsigned long>(reinterpret_cast<uintptr_t>(addr) - base));
+    name += buf;
+  }
+  return name;
+}
+
+string symbolize(const void* addr) {
+  return describe(addr, true);
+}
+
+string symbolizeFunction(const void* addr) {
+  return describe(addr, false);
+}
@@ -0,0 +1,23 @@
+/**
+* Symbolizer.hpp
+* --------------
+* Turns code addresses into readable function names. Requires the
+* executable to be linked with -rdynamic so that its own symbols are
+* visible to dladdr().
+*/
+
+#pragma once
+
+#include <string>
+
+/**
+* Return "function+0xoffset" for the given code address, or
+* "module+0xoffset" if no symbol covers it.
+*/
+std::string symbolize(const void* addr);
+
+/**
+* Same as symbolize(), but without the offset. Useful for aggregating
+* samples by function.
+*/
+std::string symbolizeFunction(const void* addr);
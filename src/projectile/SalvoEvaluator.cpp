@@ -0,0 +1,78 @@
+/**
+* SalvoEvaluator.cpp
+* ------------------
+* Implementation of the SalvoEvaluator class.
+*/
+
+#include <cmath>
+
+#include "SalvoEvaluator.hpp"
+
+using namespace std;
+
+bool InterceptEnvelope::contains(const Eigen::Vector3d& pos, double margin) const {
+  return (pos[2] > z_min - margin) &&
+         (abs(pos[1]) < y_width + margin) &&
+         (pos[0] > x_min - margin);
+}
+
+const TrackEvaluation* SalvoResult::find(int id) const {
+  for(int i = 0; i < count; i++)
+    if(tracks[i].id == id) return &tracks[i];
+  return NULL;
+}
+
+SalvoEvaluator::SalvoEvaluator(ProjectileManager& manager, TaskPool& pool) :
+    manager(manager), pool(pool), evaluated_version(0), dropped(0) {}
+
+void SalvoEvaluator::evaluateTrack(int i) {
+
+  const ProjectileSnapshot& s = snapshots[i];
+  TrackEvaluation& e = scratch.tracks[i];
+
+  e.id = s.id;
+  e.t_intersect = s.getIntersectionTime(envelope.sphere_pos, envelope.sphere_radius);
+  e.intersects = (e.t_intersect >= 0);
+  e.selectable = false;
+
+  if(e.intersects) {
+    e.collision_pos = s.getPosition(e.t_intersect);
+    e.collision_vel = s.getVelocity(e.t_intersect);
+    e.selectable = (e.t_intersect >= envelope.t_min) && envelope.contains(e.collision_pos);
+  } else {
+    e.collision_pos.setZero();
+    e.collision_vel.setZero();
+  }
+}
+
+void SalvoEvaluator::evaluate(double now) {
+
+  lock_guard<mutex> lg(evaluate_lock);
+
+  // Read the version first, so a change during the snapshot is not lost
+  uint64_t version = manager.getVersion();
+  int total;
+  int n = manager.getConvergedSnapshots(snapshots, MAX_SALVO_TRACKS, &total);
+
+  // Tracks cost about the same, so one per chunk balances well
+  pool.parallelFor(n, 1, [this](size_t begin, size_t end) {
+    for(size_t i = begin; i < end; i++) evaluateTrack(i);
+  });
+
+  scratch.t = now;
+  scratch.track_version = version;
+  scratch.count = n;
+  scratch.dropped = total - n;
+  results.write(scratch);
+  dropped.store(scratch.dropped, memory_order_relaxed);
+  evaluated_version.store(version, memory_order_release);
+}
+
+bool SalvoEvaluator::evaluateIfChanged(double now) {
+
+  if(evaluated_version.load(memory_order_acquire) == manager.getVersion())
+    return false;
+
+  evaluate(now);
+  return true;
+}
@@ -0,0 +1,159 @@
+/**
+* SalvoEvaluator.hpp
+* ------------------
+* Intercept solving for every converged projectile at once, spread over
+* a TaskPool. Each track is evaluated on its own snapshot, so the work
+* is independent per track and scales with the pool's workers.
+*
+*   SalvoEvaluator salvo(manager, pool);
+*   salvo.setEnvelope(envelope);
+*   salvo.evaluateIfChanged(now); // planner, whenever the tracks change
+*   salvo.getResult(result);      // latest finished evaluation, any thread
+*
+* The caller does the work together with the pool and publishes the
+* result before returning. Results carry the tracker version they were
+* computed from, so an evaluation is only repeated when a track changed.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <Eigen/Dense>
+
+#include "projectile.hpp"
+#include "../concurrency/DoubleBuffer.hpp"
+#include "../concurrency/TaskPool.hpp"
+
+// Most tracks evaluated at once, also the most the viewer state and
+// checkpoints carry. Converged tracks beyond it, the newest, are left
+// out and counted in SalvoResult::dropped. Set with the CMake cache
+// variable IRON_DOME_MAX_SALVO_TRACKS for larger salvos.
+#ifndef IRON_DOME_MAX_SALVO_TRACKS
+#define IRON_DOME_MAX_SALVO_TRACKS 64
+#endif
+static const int MAX_SALVO_TRACKS = IRON_DOME_MAX_SALVO_TRACKS;
+
+/**
+* Where the robot can take a projectile: the interception sphere, plus
+* limits on where and when the intercept happens.
+*/
+class InterceptEnvelope {
+public:
+  InterceptEnvelope() : sphere_radius(0), t_min(0), z_min(0), x_min(0), y_width(0) {
+    sphere_pos.setZero();
+  }
+
+  Eigen::Vector3d sphere_pos;
+  double sphere_radius;
+
+  double t_min;   // Earliest intercept time
+  double z_min;   // Lowest intercept height
+  double x_min;   // Nearest intercept distance in x
+  double y_width; // Largest intercept offset in y, either side
+
+  /**
+  * Whether an intercept at pos is inside the limits, widened by margin.
+  */
+  bool contains(const Eigen::Vector3d& pos, double margin = 0) const;
+};
+
+/**
+* Intercept of one track with the envelope's sphere.
+*/
+class TrackEvaluation {
+public:
+  int id;
+  bool intersects;    // Whether it reaches the sphere at all
+  bool selectable;    // Whether the intercept is inside the envelope
+  double t_intersect; // Time it reaches the sphere, or -1
+  Eigen::Vector3d collision_pos, collision_vel;
+};
+
+/**
+* Evaluation of every converged track at one time, ordered by ID.
+*/
+class SalvoResult {
+public:
+  SalvoResult() : t(-1), track_version(0), count(0), dropped(0) {}
+
+  double t; // Time of the evaluation, -1 before the first
+  uint64_t track_version; // ProjectileManager::getVersion() evaluated
+  int count;
+  int dropped; // Converged tracks left out for lack of room
+  TrackEvaluation tracks[MAX_SALVO_TRACKS];
+
+  /**
+  * The evaluation of track id, or NULL if it is not in this result.
+  */
+  const TrackEvaluation* find(int id) const;
+};
+
+class SalvoEvaluator {
+
+public:
+
+  SalvoEvaluator(ProjectileManager& manager, TaskPool& pool);
+
+  /**
+  * Set the envelope before the first evaluation.
+  */
+  void setEnvelope(const InterceptEnvelope& envelope) { this->envelope = envelope; }
+  const InterceptEnvelope& getEnvelope() const { return envelope; }
+
+  /**
+  * Evaluate all converged tracks as of time now and publish the
+  * result. Does not allocate. Calls from different threads take turns.
+  */
+  void evaluate(double now);
+
+  /**
+  * Evaluate only if the tracks changed since the last evaluation.
+  * Returns whether it did.
+  */
+  bool evaluateIfChanged(double now);
+
+  /**
+  * Copy the latest published result. Safe from any thread.
+  */
+  void getResult(SalvoResult& result) const { results.read(result); }
+
+  /**
+  * Number of results published so far. Compare it to the last count
+  * seen to tell whether getResult() has anything new.
+  */
+  uint64_t getResultCount() const { return results.version(); }
+
+  /**
+  * SalvoResult::dropped of the latest result. Safe from any thread.
+  */
+  int getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+  /**
+  * Intercept of snapshots[i] into scratch.tracks[i]. Depends only on
+  * the snapshot, not on when it is evaluated.
+  */
+  void evaluateTrack(int i);
+
+  ProjectileManager& manager;
+  TaskPool& pool;
+  InterceptEnvelope envelope;
+
+  // Inputs and output of the evaluation in progress
+  ProjectileSnapshot snapshots[MAX_SALVO_TRACKS];
+  SalvoResult scratch;
+
+  DoubleBuffer<SalvoResult> results;
+  std::atomic<uint64_t> evaluated_version; // track_version of the latest result
+  std::atomic<int> dropped;
+
+  // Held for a whole evaluation, which uses the members above
+  std::mutex evaluate_lock;
+
+  SalvoEvaluator(const SalvoEvaluator&);
+  SalvoEvaluator& operator=(const SalvoEvaluator&);
+};
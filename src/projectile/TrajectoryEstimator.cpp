@@ -0,0 +1,182 @@
+/**
+* TrajectoryEstimator.cpp
+* -----------------------
+* Implementation of the estimator backends.
+*/
+
+#include <cassert>
+
+#include "TrajectoryEstimator.hpp"
+
+using namespace std;
+
+static const double GRAVITY = -9.81;
+
+// Measurements fitted by the least-squares backends, 1/3 s at 30 Hz
+static const int LSQ_WINDOW = 10;
+
+// ----------------------------
+// KalmanEstimator
+// ----------------------------
+
+void KalmanEstimator::init(const ProjectileMeasurement& m0) {
+
+  double dt = 1.0/30; // Time step
+
+  Eigen::MatrixXd A(n, n); // System dynamics matrix
+  Eigen::MatrixXd C(m, n); // Output matrix
+  Eigen::MatrixXd Q(n, n); // Process noise covariance
+  Eigen::MatrixXd R(m, m); // Measurement noise covariance
+  Eigen::MatrixXd P(n, n); // Estimate error covariance
+
+  // Discrete LTI projectile motion, measuring position only
+  A << 1, dt, 0, 0, 1, dt, 0, 0, 1;
+  C << 1, 0, 0;
+
+  // Reasonable covariance matrices
+  Q << .05, .05, .0, .05, .05, .0, .0, .0, .0;
+  R << 5;
+  P << .1, .1, .1, .1, 10000, 10, .1, 10, 100;
+
+  // Construct an estimator for each axis
+  estimatorX = KalmanFilter(dt, A, C, Q, R, P);
+  estimatorY = KalmanFilter(dt, A, C, Q, R, P);
+  estimatorZ = KalmanFilter(dt, A, C, Q, R, P);
+
+  // Initialize using our first measurement
+  t = m0.t;
+  x = Eigen::Vector3d(m0.x, 0, 0);
+  y = Eigen::Vector3d(m0.y, 0, 0);
+  z = Eigen::Vector3d(m0.z, 0, GRAVITY);
+  estimatorX.init(t, x);
+  estimatorY.init(t, y);
+  estimatorZ.init(t, z);
+
+  p << x[0], y[0], z[0];
+  v << x[1], y[1], z[1];
+  a << x[2], y[2], z[2];
+}
+
+void KalmanEstimator::update(const ProjectileMeasurement& obs) {
+
+  // Time that has passed since last measurement
+  double dt = obs.t - t;
+
+  // A matrix using this dt
+  Eigen::MatrixXd A(n, n);
+  A << 1, dt, 0, 0, 1, dt, 0, 0, 1;
+
+  // Update the estimators
+  Eigen::VectorXd p_x(m), p_y(m), p_z(m);
+  p_x << obs.x;
+  p_y << obs.y;
+  p_z << obs.z;
+  estimatorX.update(p_x, dt, A);
+  estimatorY.update(p_y, dt, A);
+  estimatorZ.update(p_z, dt, A);
+
+  // Get the time, make sure they match up
+  t = estimatorX.time();
+  assert(t == estimatorY.time());
+  assert(t == estimatorZ.time());
+
+  // Read the estimated state
+  x = estimatorX.state();
+  y = estimatorY.state();
+  z = estimatorZ.state();
+
+  // Set the state in pos/vel/acc form
+  p << x[0], y[0], z[0];
+  v << x[1], y[1], z[1];
+  a << x[2], y[2], z[2];
+}
+
+// ----------------------------
+// LeastSquaresEstimator
+// ----------------------------
+
+LeastSquaresEstimator::LeastSquaresEstimator(int window, bool fit_acceleration) :
+    window(window), fit_acceleration(fit_acceleration), history(window), next(0), count(0) {}
+
+const char* LeastSquaresEstimator::getName() const {
+  return fit_acceleration ? "lsq-quadratic" : "lsq-gravity";
+}
+
+void LeastSquaresEstimator::init(const ProjectileMeasurement& m0) {
+  next = 0;
+  count = 0;
+  update(m0);
+}
+
+void LeastSquaresEstimator::update(const ProjectileMeasurement& m) {
+  history[next] = m;
+  next = (next + 1) % window;
+  if(count < window) count++;
+  fit();
+}
+
+void LeastSquaresEstimator::fit() {
+
+  const ProjectileMeasurement& last = history[(next + window - 1) % window];
+  t = last.t;
+
+  // Fit p(tau) = p + v*tau + a*tau^2/2 with tau relative to the last
+  // measurement, so the fitted coefficients are the state at time t
+  Eigen::Vector3d gravity(0, 0, GRAVITY);
+
+  if(fit_acceleration && count >= 3) {
+    Eigen::Matrix3d N = Eigen::Matrix3d::Zero();
+    Eigen::Matrix3d B = Eigen::Matrix3d::Zero();
+    for(int i = 0; i < count; i++) {
+      const ProjectileMeasurement& h = history[i];
+      double tau = h.t - t;
+      Eigen::Vector3d basis(1, tau, 0.5 * tau * tau);
+      N += basis * basis.transpose();
+      B += basis * Eigen::RowVector3d(h.x, h.y, h.z);
+    }
+    Eigen::Matrix3d coeff = N.ldlt().solve(B);
+    p = coeff.row(0).transpose();
+    v = coeff.row(1).transpose();
+    a = coeff.row(2).transpose();
+    return;
+  }
+
+  // Acceleration fixed to gravity: a linear fit per axis
+  double s0 = 0, s1 = 0, s2 = 0;
+  Eigen::Vector3d sy = Eigen::Vector3d::Zero(), sty = Eigen::Vector3d::Zero();
+  for(int i = 0; i < count; i++) {
+    const ProjectileMeasurement& h = history[i];
+    double tau = h.t - t;
+    Eigen::Vector3d y = Eigen::Vector3d(h.x, h.y, h.z) - 0.5 * gravity * tau * tau;
+    s0 += 1;
+    s1 += tau;
+    s2 += tau * tau;
+    sy += y;
+    sty += tau * y;
+  }
+
+  double det = s0 * s2 - s1 * s1;
+  if(count < 2 || det < 1e-12) {
+    p << last.x, last.y, last.z;
+    v.setZero();
+  } else {
+    v = (s0 * sty - s1 * sy) / det;
+    p = (sy - v * s1) / s0;
+  }
+  a = gravity;
+}
+
+// ----------------------------
+// Factory
+// ----------------------------
+
+vector<string> getEstimatorNames() {
+  return {"kalman", "lsq-gravity", "lsq-quadratic"};
+}
+
+TrajectoryEstimator* createEstimator(const string& name) {
+  if(name == "kalman") return new KalmanEstimator();
+  if(name == "lsq-gravity") return new LeastSquaresEstimator(LSQ_WINDOW, false);
+  if(name == "lsq-quadratic") return new LeastSquaresEstimator(LSQ_WINDOW, true);
+  return NULL;
+}
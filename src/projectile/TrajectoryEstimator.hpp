@@ -0,0 +1,129 @@
+/**
+* TrajectoryEstimator.hpp
+* -----------------------
+* Estimators that turn noisy position measurements of a projectile into
+* a position/velocity/acceleration estimate. Projectile uses the per-axis
+* Kalman filter; the other backends exist so they can be compared with it
+* on the same data (see bench/estimator_bench.cpp).
+*
+*   TrajectoryEstimator* e = createEstimator("lsq-gravity");
+*   e->init(m0);
+*   e->update(m1);
+*   Eigen::Vector3d p = e->getPosition();
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "kalman.hpp"
+
+/**
+* One data point for a projectile.
+*/
+class ProjectileMeasurement {
+public:
+  double t; // Measured time
+  double x, y, z; // Measured position
+
+  ProjectileMeasurement() : t(0), x(0), y(0), z(0) {}
+  ProjectileMeasurement(double t, double x, double y, double z) :
+      t(t), x(x), y(y), z(z) {}
+};
+
+/**
+* Interface of an estimator backend. Times are those of the measurements.
+*/
+class TrajectoryEstimator {
+
+public:
+
+  virtual ~TrajectoryEstimator() {}
+
+  virtual const char* getName() const = 0;
+
+  /**
+  * Start a new estimate from the first measurement.
+  */
+  virtual void init(const ProjectileMeasurement& m0) = 0;
+
+  /**
+  * Add a measurement taken after all previous ones.
+  */
+  virtual void update(const ProjectileMeasurement& m) = 0;
+
+  /**
+  * Estimated pos/vel/acc at the time of the estimate.
+  */
+  double getTime() const { return t; }
+  const Eigen::Vector3d& getPosition() const { return p; }
+  const Eigen::Vector3d& getVelocity() const { return v; }
+  const Eigen::Vector3d& getAcceleration() const { return a; }
+
+protected:
+
+  double t;
+  Eigen::Vector3d p, v, a;
+};
+
+/**
+* Three independent constant-acceleration Kalman filters, one per axis.
+*/
+class KalmanEstimator : public TrajectoryEstimator {
+
+public:
+
+  const char* getName() const { return "kalman"; }
+  void init(const ProjectileMeasurement& m0);
+  void update(const ProjectileMeasurement& m);
+
+private:
+
+  const static int n = 3; // Number of states
+  const static int m = 1; // Number of measurements
+
+  // Estimated state, with x, y, z vectors of pos/vel/acc
+  Eigen::Vector3d x, y, z;
+
+  // State estimators
+  KalmanFilter estimatorX, estimatorY, estimatorZ;
+};
+
+/**
+* Least-squares fit of a ballistic trajectory to the last few measurements.
+* With fit_acceleration false, the acceleration is fixed to gravity and
+* only position and velocity are fitted; otherwise all three are, which
+* absorbs drag and calibration errors at the cost of more noise.
+*/
+class LeastSquaresEstimator : public TrajectoryEstimator {
+
+public:
+
+  LeastSquaresEstimator(int window, bool fit_acceleration);
+
+  const char* getName() const;
+  void init(const ProjectileMeasurement& m0);
+  void update(const ProjectileMeasurement& m);
+
+private:
+
+  void fit();
+
+  int window;
+  bool fit_acceleration;
+
+  // Ring buffer of the last window measurements
+  std::vector<ProjectileMeasurement> history;
+  int next;
+  int count;
+};
+
+/**
+* Names of all estimator backends, and a factory for them. Returns NULL
+* for an unknown name.
+*/
+std::vector<std::string> getEstimatorNames();
+TrajectoryEstimator* createEstimator(const std::string& name);
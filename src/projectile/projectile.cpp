@@ -2,22 +2,16 @@
 *
 */
 
-#include <sutil/CSystemClock.hpp>
 #include <iostream>
 #include "../ostreamlock.hpp"
+#include "../AppClock.hpp"
 
 #include "projectile.hpp"
 #include "../lowestRealRoot.hpp"
 
-static const double GRAVITY = -9.81;
-
 // How many observations until we deem the trajectory converged
 static const int CONVERGE_LIMIT = 3;
 
-// When the projectile is due to pass this point, get rid of it
-static const double X_EXPIRATION = -0.3;
-static const double Z_EXPIRATION = 0;
-
 using namespace std;
 
 // ----------------------------
@@ -25,92 +19,84 @@ using namespace std;
 // ----------------------------
 
 Projectile::Projectile(int id, const ProjectileMeasurement& obs) :
-    id(id), converged(false), observations(0) {
-
-  double dt = 1.0/30; // Time step
+    id(id), converged(false), observations(0), data_lock("Projectile::data_lock"),
+    history_start(0), history_count(0) {
 
   // Time offset
-  double now = sutil::CSystemClock::getSysTime();
+  double now = AppClock::now();
   tOffset = now - obs.t;
 
-  Eigen::MatrixXd A(n, n); // System dynamics matrix
-  Eigen::MatrixXd C(m, n); // Output matrix
-  Eigen::MatrixXd Q(n, n); // Process noise covariance
-  Eigen::MatrixXd R(m, m); // Measurement noise covariance
-  Eigen::MatrixXd P(n, n); // Estimate error covariance
-
-  // Discrete LTI projectile motion, measuring position only
-  A << 1, dt, 0, 0, 1, dt, 0, 0, 1;
-  C << 1, 0, 0;
-
-  // Reasonable covariance matrices
-  Q << .05, .05, .0, .05, .05, .0, .0, .0, .0;
-  R << 5;
-  P << .1, .1, .1, .1, 10000, 10, .1, 10, 100;
-
-  // Construct an estimator for each axis
-  estimatorX = KalmanFilter(dt, A, C, Q, R, P);
-  estimatorY = KalmanFilter(dt, A, C, Q, R, P);
-  estimatorZ = KalmanFilter(dt, A, C, Q, R, P);
-
   // Initialize using our first measurement
-  t = obs.t + tOffset;
-  x = Eigen::Vector3d(obs.x, 0, 0);
-  y = Eigen::Vector3d(obs.y, 0, 0);
-  z = Eigen::Vector3d(obs.z, 0, GRAVITY);
-  estimatorX.init(t, x);
-  estimatorY.init(t, y);
-  estimatorZ.init(t, z);
+  estimator.init(ProjectileMeasurement(obs.t + tOffset, obs.x, obs.y, obs.z));
 
   // Set our projectile's state
-  p << x[0], y[0], z[0];
-  v << x[1], y[1], z[1];
-  a << x[2], y[2], z[2];
+  t = estimator.getTime();
+  p = estimator.getPosition();
+  v = estimator.getVelocity();
+  a = estimator.getAcceleration();
+  pObs << obs.x, obs.y, obs.z;
 
+  recordMeasurement(obs);
   observations += 1;
 }
 
-void Projectile::addObservation(const ProjectileMeasurement& obs) {
+Projectile::Projectile(const TrackCheckpoint& saved, double time_shift) :
+    id(saved.id), converged(false), observations(saved.observations),
+    data_lock("Projectile::data_lock"), tOffset(saved.t_offset + time_shift),
+    history_start(0), history_count(0) {
+
+  // Replaying the same measurements gives the same estimate
+  for(int i = 0; i < saved.num_measurements; i++) {
+    const ProjectileMeasurement& obs = saved.measurements[i];
+    ProjectileMeasurement ours(obs.t + tOffset, obs.x, obs.y, obs.z);
+    if(i == 0) estimator.init(ours);
+    else estimator.update(ours);
+    pObs << obs.x, obs.y, obs.z;
+    recordMeasurement(obs);
+  }
 
-  lock_guard<mutex> lg(data_lock);
+  t = estimator.getTime();
+  p = estimator.getPosition();
+  v = estimator.getVelocity();
+  a = estimator.getAcceleration();
+  if(observations >= CONVERGE_LIMIT) converged = true;
+}
 
-  // Measurement timestamp, in our system time
-  double tNew = obs.t + tOffset;
+void Projectile::getCheckpoint(TrackCheckpoint& saved) {
+  lock_guard<ProfiledMutex> lg(data_lock);
+  saved.id = id;
+  saved.observations = observations;
+  saved.num_measurements = history_count;
+  saved.t_offset = tOffset;
+  for(int i = 0; i < history_count; i++)
+    saved.measurements[i] = history[(history_start + i) % MAX_TRACK_HISTORY];
+}
 
-  // Time that has passed since last measurement
-  double dt = tNew - t;
-  //cout << oslock << "Time between measurements: " << dt << endl << osunlock;
+void Projectile::recordMeasurement(const ProjectileMeasurement& obs) {
+  if(history_count < MAX_TRACK_HISTORY) {
+    history[(history_start + history_count++) % MAX_TRACK_HISTORY] = obs;
+  } else {
+    history[history_start] = obs;
+    history_start = (history_start + 1) % MAX_TRACK_HISTORY;
+  }
+}
 
-  // A matrix using this dt
-  Eigen::MatrixXd A(n, n);
-  A << 1, dt, 0, 0, 1, dt, 0, 0, 1;
+void Projectile::addObservation(const ProjectileMeasurement& obs) {
 
-  // Update the estimators
-  Eigen::VectorXd p_x(m), p_y(m), p_z(m);
-  p_x << obs.x;
-  p_y << obs.y;
-  p_z << obs.z;
-  estimatorX.update(p_x, dt, A);
-  estimatorY.update(p_y, dt, A);
-  estimatorZ.update(p_z, dt, A);
+  lock_guard<ProfiledMutex> lg(data_lock);
 
-  // Get the time, make sure they match up
-  t = estimatorX.time();
-  assert(t == estimatorY.time());
-  assert(t == estimatorZ.time());
+  // Update the estimator with the measurement in our system time
+  estimator.update(ProjectileMeasurement(obs.t + tOffset, obs.x, obs.y, obs.z));
 
   // Read the estimated state
-  x = estimatorX.state();
-  y = estimatorY.state();
-  z = estimatorZ.state();
-
-  // Set our projectile's state in pos/vel/acc form
-  p << x[0], y[0], z[0];
-  v << x[1], y[1], z[1];
-  a << x[2], y[2], z[2];
+  t = estimator.getTime();
+  p = estimator.getPosition();
+  v = estimator.getVelocity();
+  a = estimator.getAcceleration();
 
   // Save the last observation
   pObs << obs.x, obs.y, obs.z;
+  recordMeasurement(obs);
 
   observations += 1;
   if(observations >= CONVERGE_LIMIT) converged = true;
@@ -118,56 +104,85 @@ void Projectile::addObservation(const ProjectileMeasurement& obs) {
 }
 
 double Projectile::getEstimateTime() {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return t;
 }
 
 const Eigen::Vector3d& Projectile::getPositionEstimate() {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return p;
 }
 
 const Eigen::Vector3d& Projectile::getVelocityEstimate() {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return v;
 }
 
 const Eigen::Vector3d& Projectile::getAccelerationEstimate() {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return a;
 }
 
 const Eigen::Vector3d& Projectile::getLastObservedPosition() {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return pObs;
 }
 
 Eigen::Vector3d Projectile::getPosition(double t1) {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return p + v*(t1-t) + 0.5 * a*(t1-t)*(t1-t);
 }
 
 Eigen::Vector3d Projectile::getVelocity(double t1) {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return v + a*(t1-t);
 }
 
 Eigen::Vector3d Projectile::getAcceleration(double t1) {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return a;
 }
 
 bool Projectile::isConverged() {
-  lock_guard<mutex> lg(data_lock);
+  lock_guard<ProfiledMutex> lg(data_lock);
   return converged;
 }
 
 double Projectile::getIntersectionTime(const Eigen::Vector3d& origin, double radius) {
+  return getSnapshot().getIntersectionTime(origin, radius);
+}
+
+ProjectileSnapshot Projectile::getSnapshot() {
+  lock_guard<ProfiledMutex> lg(data_lock);
+  ProjectileSnapshot s;
+  s.id = id;
+  s.converged = converged;
+  s.observations = observations;
+  s.t = t;
+  s.p = p;
+  s.v = v;
+  s.a = a;
+  s.pObs = pObs;
+  return s;
+}
+
+// ----------------------------
+// ProjectileSnapshot
+// ----------------------------
+
+Eigen::Vector3d ProjectileSnapshot::getPosition(double t1) const {
+  return p + v*(t1-t) + 0.5 * a*(t1-t)*(t1-t);
+}
+
+Eigen::Vector3d ProjectileSnapshot::getVelocity(double t1) const {
+  return v + a*(t1-t);
+}
+
+double ProjectileSnapshot::getIntersectionTime(const Eigen::Vector3d& origin, double radius) const {
 
   // Polynomial coefficients
   Eigen::VectorXd coeff(5);
 
-  data_lock.lock();
   double x0 = p(0) - origin(0);
   double y0 = p(1) - origin(1);
   double z0 = p(2) - origin(2);
@@ -176,7 +191,6 @@ double Projectile::getIntersectionTime(const Eigen::Vector3d& origin, double rad
   double vz = v(2);
   double g = a(2);
   double R = radius;
-  data_lock.unlock();
 
   coeff[4] = g*g/4;
   coeff[3] = g*vz;
@@ -195,11 +209,18 @@ double Projectile::getIntersectionTime(const Eigen::Vector3d& origin, double rad
 // Projectile Manager
 // ----------------------------
 
-ProjectileManager::ProjectileManager() {}
+ProjectileManager::ProjectileManager() :
+    projectile_lock("ProjectileManager::projectile_lock"), version(0), notifier(NULL) {}
+
+ProjectileManager::~ProjectileManager() {
+  // converged_projectiles holds a subset of the same pointers
+  for(pair<const int, Projectile*>& p : projectiles)
+    delete p.second;
+}
 
 void ProjectileManager::addObservation(int id, double t, double x, double y, double z) {
 
-  lock_guard<mutex> lg(projectile_lock);
+  lock_guard<ProfiledMutex> lg(projectile_lock);
 
   ProjectileMeasurement obs(t, x, y, z);
 
@@ -215,6 +236,8 @@ void ProjectileManager::addObservation(int id, double t, double x, double y, dou
     converged_projectiles[id] = projectiles[id];
   }
 
+  tracksChanged();
+
 //  cout << oslock
 //       << "Updated projectile " << id << " at t = " << t << ":\n"
 //       << "p = " << projectiles[id].p.transpose() << "\n"
@@ -225,9 +248,10 @@ void ProjectileManager::addObservation(int id, double t, double x, double y, dou
 
 void ProjectileManager::updateActiveProjectiles() {
 
-  lock_guard<mutex> lg(projectile_lock);
+  lock_guard<ProfiledMutex> lg(projectile_lock);
 
-  double now = sutil::CSystemClock::getSysTime();
+  double now = AppClock::now();
+  bool changed = false;
 
   // Get rid of expired projectiles
   // Special method of iteration because we are deleting
@@ -236,6 +260,7 @@ void ProjectileManager::updateActiveProjectiles() {
     bool expired = (pos[0] < X_EXPIRATION) || (pos[2] < Z_EXPIRATION);
     if (expired) {
       converged_projectiles.erase(it++);
+      changed = true;
     } else {
       ++it;
     }
@@ -250,13 +275,78 @@ void ProjectileManager::updateActiveProjectiles() {
       //cout << "Removing expired projectile " << (*it).first << "\n";
       delete (*it).second;
       projectiles.erase(it++);
+      changed = true;
     } else {
       ++it;
     }
   }
+
+  if(changed) tracksChanged();
+}
+
+void ProjectileManager::tracksChanged() {
+  version.fetch_add(1, memory_order_release);
+  if(notifier) notifier->notify();
 }
 
 std::map<int, Projectile*>& ProjectileManager::getActiveProjectiles() {
-  lock_guard<mutex> lg(projectile_lock);
+  lock_guard<ProfiledMutex> lg(projectile_lock);
   return converged_projectiles;
 }
+
+int ProjectileManager::getNumTracked() {
+  lock_guard<ProfiledMutex> lg(projectile_lock);
+  return projectiles.size();
+}
+
+vector<ProjectileSnapshot> ProjectileManager::getSnapshots() {
+  lock_guard<ProfiledMutex> lg(projectile_lock);
+  vector<ProjectileSnapshot> snapshots;
+  snapshots.reserve(projectiles.size());
+  for(pair<const int, Projectile*>& p : projectiles)
+    snapshots.push_back(p.second->getSnapshot());
+  return snapshots;
+}
+
+int ProjectileManager::getConvergedSnapshots(ProjectileSnapshot* snapshots, int max, int* total) {
+  lock_guard<ProfiledMutex> lg(projectile_lock);
+  if(total) *total = converged_projectiles.size();
+  int n = 0;
+  for(pair<const int, Projectile*>& p : converged_projectiles) {
+    if(n == max) break;
+    snapshots[n++] = p.second->getSnapshot();
+  }
+  return n;
+}
+
+int ProjectileManager::getCheckpoints(TrackCheckpoint* saved, int max) {
+  lock_guard<ProfiledMutex> lg(projectile_lock);
+  int n = 0;
+  for(pair<const int, Projectile*>& p : projectiles) {
+    if(n == max) break;
+    p.second->getCheckpoint(saved[n++]);
+  }
+  return n;
+}
+
+void ProjectileManager::restoreCheckpoints(const TrackCheckpoint* saved, int n, double time_shift) {
+
+  lock_guard<ProfiledMutex> lg(projectile_lock);
+
+  for(int i = 0; i < n; i++) {
+    if(saved[i].num_measurements < 1) continue;
+    int id = saved[i].id;
+
+    auto it = projectiles.find(id);
+    if(it != projectiles.end()) {
+      converged_projectiles.erase(id);
+      delete it->second;
+    }
+
+    Projectile* proj = new Projectile(saved[i], time_shift);
+    projectiles[id] = proj;
+    if(proj->isConverged()) converged_projectiles[id] = proj;
+  }
+
+  tracksChanged();
+}
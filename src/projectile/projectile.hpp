@@ -4,25 +4,65 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
+#include <vector>
 #include <string>
 #include <fstream>
 #include <mutex>
 
 #include <Eigen/Dense>
 
-#include "kalman.hpp"
+#include "TrajectoryEstimator.hpp"
+#include "../concurrency/EventNotifier.hpp"
+#include "../profiling/ProfiledMutex.hpp"
 
 /**
-* One data point for a projectile.
+* Consistent copy of a projectile's estimated state, for readers that
+* should not hold the projectile's lock while they work with it.
 */
-class ProjectileMeasurement {
+class ProjectileSnapshot {
 public:
-  double t; // Measured time
-  double x, y, z; // Measured position
+  int id;
+  bool converged;
+  int observations;
+  double t; // Time of the estimate
+  Eigen::Vector3d p, v, a; // Estimated pos/vel/acc at time t
+  Eigen::Vector3d pObs; // Last measured position
+
+  /**
+  * Extrapolate the estimated state to time t1.
+  */
+  Eigen::Vector3d getPosition(double t1) const;
+  Eigen::Vector3d getVelocity(double t1) const;
 
-  ProjectileMeasurement(double t, double x, double y, double z) :
-      t(t), x(x), y(y), z(z) {}
+  /**
+  * Get the time the projectile will first intersect with a
+  * sphere at the given origin and radius, or -1 if it will
+  * not happen.
+  */
+  double getIntersectionTime(const Eigen::Vector3d& origin, double radius) const;
+};
+
+// When a projectile is due to pass this point, it is expired
+static const double X_EXPIRATION = -0.3;
+static const double Z_EXPIRATION = 0;
+
+// Measurements each projectile keeps for checkpoints, over 2 s at 30 Hz
+static const int MAX_TRACK_HISTORY = 64;
+
+/**
+* What a checkpoint keeps of a projectile: its measurements, which
+* rebuild the same estimate when replayed through a new estimator.
+* Plain data, so it can be written to a file as is.
+*/
+class TrackCheckpoint {
+public:
+  int id;
+  int observations;     // Total, which may exceed the ones kept
+  int num_measurements;
+  double t_offset;      // Our time minus the reporting program's time
+  ProjectileMeasurement measurements[MAX_TRACK_HISTORY]; // Oldest first
 };
 
 /**
@@ -35,7 +75,18 @@ class Projectile {
 public:
 
   Projectile(int id, const ProjectileMeasurement& m0);
-  Projectile() : id(-1) {};
+  Projectile() : id(-1), data_lock("Projectile::data_lock") {};
+
+  /**
+  * Rebuild a projectile from a checkpoint taken by another run of the
+  * program, whose clock read time_shift less than ours.
+  */
+  Projectile(const TrackCheckpoint& saved, double time_shift);
+
+  /**
+  * Copy what a checkpoint needs under the projectile's lock.
+  */
+  void getCheckpoint(TrackCheckpoint& saved);
 
   /**
   * Add a measured value to the estimator.
@@ -64,13 +115,15 @@ public:
 
   int getID() const { return id; };
 
+  /**
+  * Copy the estimated state under the projectile's lock.
+  */
+  ProjectileSnapshot getSnapshot();
+
   bool isConverged();
 
 private:
 
-  const static int n = 3; // Number of states
-  const static int m = 1; // Number of measurements
-
   // ID number
   int id;
 
@@ -83,11 +136,8 @@ private:
   // Last measurement
   Eigen::Vector3d pObs;
 
-  // Estimated state, with x, y, z vectors of pos/vel/acc
-  Eigen::Vector3d x, y, z;
-
-  // State estimators
-  KalmanFilter estimatorX, estimatorY, estimatorZ;
+  // State estimator, in our system time
+  KalmanEstimator estimator;
 
   // Whether we have enough data to consider this projectile 'converged'
   bool converged;
@@ -96,11 +146,17 @@ private:
   int observations;
 
   // Used to prevent concurrent access to variables
-  std::mutex data_lock;
+  ProfiledMutex data_lock;
 
   // Offset between this program's time and the reporting
   // program's time (t0 - tObs0)
   double tOffset;
+
+  // Ring of the latest measurements, in the reporting program's time
+  ProjectileMeasurement history[MAX_TRACK_HISTORY];
+  int history_start, history_count;
+
+  void recordMeasurement(const ProjectileMeasurement& obs);
 };
 
 // ----------------------------
@@ -113,6 +169,7 @@ class ProjectileManager {
 public:
 
   ProjectileManager();
+  ~ProjectileManager();
 
   /**
   * Add a measurement to the given projectile ID, or register
@@ -130,12 +187,64 @@ public:
   */
   std::map<int, Projectile*>& getActiveProjectiles();
 
+  /**
+  * Number of projectiles being tracked, converged or not.
+  */
+  int getNumTracked();
+
+  /**
+  * Snapshots of all tracked projectiles, converged or not, ordered
+  * by ID.
+  */
+  std::vector<ProjectileSnapshot> getSnapshots();
+
+  /**
+  * Snapshots of up to max converged projectiles, ordered by ID, into
+  * snapshots. Returns how many were written, and sets total, if given,
+  * to how many there are. Does not allocate.
+  */
+  int getConvergedSnapshots(ProjectileSnapshot* snapshots, int max, int* total = NULL);
+
+  /**
+  * Checkpoints of up to max projectiles, converged or not, ordered by
+  * ID. Returns how many were written. Does not allocate.
+  */
+  int getCheckpoints(TrackCheckpoint* saved, int max);
+
+  /**
+  * Track the n checkpointed projectiles again, taken by a run whose
+  * clock read time_shift less than ours. Replaces tracks with the same
+  * IDs.
+  */
+  void restoreCheckpoints(const TrackCheckpoint* saved, int n, double time_shift);
+
+  /**
+  * Count of changes to the tracks: every observation, and every
+  * projectile that expires. Equal versions mean the same estimates.
+  */
+  uint64_t getVersion() const { return version.load(std::memory_order_acquire); }
+
+  /**
+  * Notify notifier on every change to the tracks, or stop if NULL.
+  * Set it before observations arrive.
+  */
+  void setNotifier(EventNotifier* notifier) { this->notifier = notifier; }
+
 private:
 
+  /**
+  * Bump the version and wake whoever is waiting for changes. Call with
+  * projectile_lock held.
+  */
+  void tracksChanged();
+
   // List of active projectiles
   std::map<int, Projectile*> projectiles;
   std::map<int, Projectile*> converged_projectiles;
 
   // Used to prevent concurrent access to projectile vectors
-  std::mutex projectile_lock;
+  ProfiledMutex projectile_lock;
+
+  std::atomic<uint64_t> version;
+  EventNotifier* notifier;
 };
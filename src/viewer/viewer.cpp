@@ -0,0 +1,192 @@
+/**
+* viewer.cpp
+* ----------
+* Renders a running Iron Dome app from the state it publishes to shared
+* memory, in a process of its own, so a slow frame or a stalled GPU
+* driver never reaches the control loop. Any number of viewers can
+* attach to one app.
+*
+*   ./iron_dome --no-graphics --viewer-shm /iron_dome_state
+*   ./viewer --robot iiwa --shm /iron_dome_state
+*
+* The viewer waits for the app to start, and reattaches if it restarts.
+* It draws nothing from an app driving a robot other than its own.
+*/
+
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <GL/freeglut.h>
+#include <scl/DataTypes.hpp>
+#include <scl/parser/sclparser/CParserScl.hpp>
+#include <scl/graphics/chai/CGraphicsChai.hpp>
+#include <scl/graphics/chai/ChaiGlutHandlers.hpp>
+
+#include "../RobotProfile.hpp"
+#include "../graphics/ProjectileMarkers.hpp"
+#include "../ipc/SharedSnapshot.hpp"
+#include "../ipc/ViewerState.hpp"
+
+using namespace std;
+
+// Period of redrawing
+static const double FRAME_DT = 0.020;
+
+// Reattach when nothing new was published for this long
+static const double STALE_TIMEOUT = 1.0;
+
+static double secondsSince(const timespec& start) {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+/**
+* Unpack the published tracks into what ProjectileMarkers draws from.
+*/
+static void unpackTracks(const ViewerState& state, ProjectileSnapshot* snapshots,
+                         SalvoResult& salvo) {
+
+  salvo.t = state.t;
+  salvo.count = state.num_tracks;
+  for(int k = 0; k < state.num_tracks; k++) {
+    const ViewerTrack& vt = state.tracks[k];
+
+    ProjectileSnapshot& s = snapshots[k];
+    s.id = vt.id;
+    s.converged = true;
+    s.observations = 0;
+    s.t = vt.t;
+    s.p = Eigen::Map<const Eigen::Vector3d>(vt.p);
+    s.v = Eigen::Map<const Eigen::Vector3d>(vt.v);
+    s.a = Eigen::Map<const Eigen::Vector3d>(vt.a);
+    s.pObs = Eigen::Map<const Eigen::Vector3d>(vt.p_obs);
+
+    TrackEvaluation& eval = salvo.tracks[k];
+    eval.id = vt.id;
+    eval.intersects = vt.intersects;
+    eval.selectable = false;
+    eval.t_intersect = vt.t_intersect;
+    eval.collision_pos = Eigen::Map<const Eigen::Vector3d>(vt.collision_pos);
+    eval.collision_vel.setZero();
+  }
+}
+
+int main(int argc, char* argv[]) {
+
+  string robot_name = "iiwa";
+  string shm_name = DEFAULT_VIEWER_SHM;
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "--robot") && i + 1 < argc) robot_name = argv[++i];
+    else if(!strcmp(argv[i], "--shm") && i + 1 < argc) shm_name = argv[++i];
+    else {
+      cerr << "Usage: " << argv[0] << " [--robot name] [--shm name]" << endl;
+      return 1;
+    }
+  }
+
+  const RobotProfile& robot = RobotProfile::get(robot_name);
+
+  // Load the robot and its graphics, as the app does
+  scl::CParserScl parser;
+  scl::SRobotParsed rds;
+  scl::SGraphicsParsed rgr;
+  scl::SRobotIO rio;
+  scl::CGraphicsChai rchai;
+
+  int zero = 0;
+  glutInit(&zero, NULL);
+  bool flag = parser.readRobotFromFile(robot.config_file, robot.spec_dir, robot.robot_name, rds);
+  flag = flag && rio.init(rds.name_, rds.dof_);
+  flag = flag && parser.readGraphicsFromFile(robot.config_file, robot.graphics_name, rgr);
+  flag = flag && rchai.initGraphics(&rgr);
+  flag = flag && rchai.addRobotToRender(&rds, &rio);
+  flag = flag && scl_chai_glut_interface::initializeGlutForChai(&rgr, &rchai);
+  if(!flag) {
+    cerr << "Could not initialize graphics for robot " << robot_name << "!" << endl;
+    return 1;
+  }
+  chai3d::cWorld* chai_world = rchai.getChaiData()->chai_world_;
+
+  // Current position
+  chai3d::cMaterial x_c_mat;
+  x_c_mat.setBlueMediumSlate();
+  chai3d::cMesh x_c_sphere(&x_c_mat);
+  chai3d::cCreateSphere(&x_c_sphere, 0.02);
+  chai_world->addChild(&x_c_sphere);
+
+  // Desired position
+  chai3d::cMaterial x_d_mat;
+  x_d_mat.setBlue();
+  chai3d::cMesh x_d_sphere(&x_d_mat);
+  x_d_sphere.setUseTransparency(true);
+  x_d_sphere.setTransparencyLevel(0.5);
+  chai3d::cCreateSphere(&x_d_sphere, 0.03);
+  chai_world->addChild(&x_d_sphere);
+
+  ProjectileMarkers projectile_markers(chai_world);
+
+  SharedSnapshot<ViewerState> in;
+  ViewerState state;
+  vector<ProjectileSnapshot> snapshots(MAX_SALVO_TRACKS);
+  SalvoResult salvo;
+
+  uint64_t last_version = 0;
+  timespec last_update;
+  clock_gettime(CLOCK_MONOTONIC, &last_update);
+  bool waiting = false;
+  bool wrong_robot = false;
+
+  long nanosec = static_cast<long>(FRAME_DT * 1e9);
+  const timespec ts = {0, nanosec};
+  while(scl_chai_glut_interface::CChaiGlobals::getData()->chai_glut_running) {
+
+    // A restarted app publishes to a new object; the old one stays mapped
+    if(in.isOpen() && secondsSince(last_update) > STALE_TIMEOUT) in.close();
+
+    if(!in.isOpen()) {
+      if(in.open(shm_name, VIEWER_STATE_LAYOUT)) {
+        cout << "Attached to " << shm_name << "." << endl;
+        waiting = false;
+        wrong_robot = false;
+        last_version = 0;
+        clock_gettime(CLOCK_MONOTONIC, &last_update);
+      } else if(!waiting) {
+        cout << "Waiting for an app publishing to " << shm_name << "..." << endl;
+        waiting = true;
+      }
+    }
+
+    if(in.isOpen() && in.version() != last_version) {
+      last_version = in.version();
+      clock_gettime(CLOCK_MONOTONIC, &last_update);
+      in.read(state);
+
+      // Another robot's joints would pose this model wrongly, so leave it
+      // as it is
+      if(strncmp(state.robot, robot.name.c_str(), sizeof(state.robot) - 1)) {
+        if(!wrong_robot) {
+          string app_robot(state.robot, strnlen(state.robot, sizeof(state.robot)));
+          cerr << "The app at " << shm_name << " drives " << app_robot << ", not "
+               << robot.name << "; restart with --robot " << app_robot << "." << endl;
+          wrong_robot = true;
+        }
+      } else {
+        for(int i = 0; i < state.dof && i < (int)rds.dof_; i++) rio.sensors_.q_(i) = state.q[i];
+        x_c_sphere.setLocalPos(state.x_c[0], state.x_c[1], state.x_c[2]);
+        x_d_sphere.setLocalPos(state.x_d[0], state.x_d[1], state.x_d[2]);
+
+        unpackTracks(state, snapshots.data(), salvo);
+        projectile_markers.update(snapshots.data(), state.num_tracks, salvo, state.t);
+      }
+    }
+
+    glutMainLoopEvent();
+    nanosleep(&ts, NULL);
+  }
+
+  return 0;
+}